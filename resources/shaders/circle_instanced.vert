@@ -0,0 +1,28 @@
+#version 330 core
+// Per instance attributes
+layout (location = 0) in vec4 a_color;
+layout (location = 1) in vec2 a_pos;
+layout (location = 2) in float a_radius;
+// Static quad in range [-1, 1]
+layout (location = 3) in vec2 a_corner;
+
+// Same interface as circle.geom output, so circle.frag can be reused
+out GS_OUT {
+    vec4 color;
+    vec2 cur_pt;
+    vec2 center;
+    float radius;
+} vs_out;
+
+layout (std140) uniform MatrixBlock {
+    mat4 proj_view;
+};
+
+void main() {
+    vec2 point = a_pos + a_corner * a_radius;
+    gl_Position = proj_view * vec4(point, 0.2, 1.0);
+    vs_out.color = a_color;
+    vs_out.cur_pt = point;
+    vs_out.center = a_pos;
+    vs_out.radius = a_radius;
+}
\ No newline at end of file
@@ -0,0 +1,24 @@
+#version 330 core
+out vec4 frag_color;
+
+in VS_OUT {
+    vec2 uv;
+} fs_in;
+
+uniform sampler2D density;
+uniform float max_density;
+
+void main() {
+    float value = texture(density, fs_in.uv).r;
+    if (value <= 0.0) {
+        discard;
+    }
+
+    // Logarithmic scale, otherwise single hot spot makes everything else invisible
+    float t = clamp(log(1.0 + value) / log(1.0 + max_density), 0.0, 1.0);
+    // Blue -> cyan -> yellow -> red
+    vec3 color = mix(vec3(0.0, 0.2, 1.0), vec3(0.0, 1.0, 1.0), smoothstep(0.0, 0.33, t));
+    color = mix(color, vec3(1.0, 1.0, 0.0), smoothstep(0.33, 0.66, t));
+    color = mix(color, vec3(1.0, 0.0, 0.0), smoothstep(0.66, 1.0, t));
+    frag_color = vec4(color, 0.35 + 0.65 * t);
+}
\ No newline at end of file
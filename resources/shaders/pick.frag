@@ -0,0 +1,7 @@
+#version 330 core
+flat in vec4 v_id;
+out vec4 frag_color;
+
+void main() {
+    frag_color = v_id;
+}
@@ -0,0 +1,15 @@
+#version 330 core
+// Primitive id encoded as color, the same for all vertices of primitive
+layout (location = 0) in vec4 a_id;
+layout (location = 1) in vec2 a_pos;
+
+flat out vec4 v_id;
+
+layout (std140) uniform MatrixBlock {
+    mat4 proj_view;
+};
+
+void main() {
+    gl_Position = proj_view * vec4(a_pos, 0.2, 1.0);
+    v_id = a_id;
+}
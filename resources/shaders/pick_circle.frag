@@ -0,0 +1,32 @@
+#version 330 core
+out vec4 frag_color;
+
+in VS_OUT {
+    vec2 cur_pt;
+    vec2 center;
+    float radius;
+    flat uint id;
+} fs_in;
+
+//Zero line width mean filled circle
+uniform uint line_width;
+
+// Thin circle is hard to hit exactly, so its ring is wider than drawn one (in pixels)
+const float RING_WIDTH = 4.0;
+
+vec4 encode_id(uint id) {
+    return vec4(float(id & 0xFFu), float((id >> 8) & 0xFFu), float((id >> 16) & 0xFFu),
+                float((id >> 24) & 0xFFu)) / 255.0;
+}
+
+void main() {
+    float dist = distance(fs_in.cur_pt, fs_in.center);
+    float delta = fwidth(dist);
+    if (dist > fs_in.radius) {
+        discard;
+    }
+    if (line_width > 0u && dist < fs_in.radius - delta * RING_WIDTH) {
+        discard;
+    }
+    frag_color = encode_id(fs_in.id);
+}
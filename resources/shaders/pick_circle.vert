@@ -0,0 +1,29 @@
+#version 330 core
+// Per instance attributes
+layout (location = 1) in vec2 a_pos;
+layout (location = 2) in float a_radius;
+// Static quad in range [-1, 1]
+layout (location = 3) in vec2 a_corner;
+
+out VS_OUT {
+    vec2 cur_pt;
+    vec2 center;
+    float radius;
+    flat uint id;
+} vs_out;
+
+layout (std140) uniform MatrixBlock {
+    mat4 proj_view;
+};
+
+// Id of the first circle of draw call, zero is background
+uniform uint id_base;
+
+void main() {
+    vec2 point = a_pos + a_corner * a_radius;
+    gl_Position = proj_view * vec4(point, 0.2, 1.0);
+    vs_out.cur_pt = point;
+    vs_out.center = a_pos;
+    vs_out.radius = a_radius;
+    vs_out.id = id_base + uint(gl_InstanceID);
+}
@@ -0,0 +1,226 @@
+//
+// Created by valdemar on 18.10.26.
+//
+
+#include "Corpus.h"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace corpus {
+
+namespace {
+
+/// Layers used by typical strategy, numbered from one as in protocol
+constexpr int BUILDINGS_LAYER = 2;
+constexpr int UNITS_LAYER = 3;
+constexpr int PATHS_LAYER = 4;
+
+constexpr float PATH_STEP = 20.0f;
+
+/// Opaque team colors, units and paths use them, buildings are gray
+const uint32_t COLORS[] = {0xFFE53935, 0xFF1E88E5, 0xFF43A047, 0xFFFDD835};
+
+template <typename... Args>
+void append(std::string &out, const char *fmt, Args... args) {
+    char buf[512];
+    const int len = snprintf(buf, sizeof(buf), fmt, args...);
+    out.append(buf, static_cast<size_t>(std::min<int>(len, sizeof(buf) - 1)));
+}
+
+glm::vec4 to_vec4(uint32_t argb) {
+    return {static_cast<float>((argb >> 16) & 0xFF) / 255.0f,
+            static_cast<float>((argb >> 8) & 0xFF) / 255.0f,
+            static_cast<float>(argb & 0xFF) / 255.0f,
+            static_cast<float>((argb >> 24) & 0xFF) / 255.0f};
+}
+
+/// Shapes of one frame, generated once and then either formatted or added directly
+struct shapes_t {
+    struct circle_t {
+        glm::vec2 center;
+        float radius;
+        uint32_t color;
+        bool fill;
+        int hp;
+    };
+    struct rect_t {
+        glm::vec2 top_left;
+        glm::vec2 bottom_right;
+        uint32_t color;
+    };
+    struct triangle_t {
+        glm::vec2 points[3];
+        uint32_t color;
+    };
+    struct path_t {
+        std::vector<glm::vec2> points;
+        uint32_t color;
+    };
+
+    std::vector<circle_t> units;
+    std::vector<rect_t> buildings;
+    std::vector<triangle_t> triangles;
+    std::vector<path_t> paths;
+    std::vector<std::string> messages;
+};
+
+shapes_t make_shapes(const params_t &params, std::mt19937 &rng) {
+    std::uniform_real_distribution<float> coord{0.0f, params.world_size};
+    std::uniform_real_distribution<float> offset{-1.0f, 1.0f};
+    std::uniform_int_distribution<size_t> team{0, 3};
+    std::uniform_int_distribution<int> hp{1, 100};
+    const auto point = [&] { return params.origin + glm::vec2{coord(rng), coord(rng)}; };
+
+    shapes_t shapes;
+    for (size_t i = 0; i < params.buildings; ++i) {
+        const glm::vec2 top_left = point();
+        shapes.buildings.push_back(
+            {top_left, top_left + glm::vec2{params.building_size}, 0xFF757575});
+    }
+    for (size_t i = 0; i < params.units; ++i) {
+        shapes.units.push_back(
+            {point(), params.unit_radius, COLORS[team(rng)], i % 4 != 0, hp(rng)});
+    }
+    for (size_t i = 0; i < params.triangles; ++i) {
+        const glm::vec2 center = point();
+        shapes.triangles.push_back({{center + glm::vec2{-6.0f, 6.0f},
+                                     center + glm::vec2{6.0f, 6.0f},
+                                     center + glm::vec2{0.0f, -6.0f}},
+                                    COLORS[team(rng)]});
+    }
+    // Random walk, like path planned across the map
+    for (size_t i = 0; i < params.paths; ++i) {
+        shapes_t::path_t path{{point()}, COLORS[team(rng)]};
+        for (size_t j = 1; j < params.path_points; ++j) {
+            path.points.push_back(path.points.back() +
+                                  glm::vec2{offset(rng), offset(rng)} * PATH_STEP);
+        }
+        shapes.paths.push_back(std::move(path));
+    }
+    for (size_t i = 0; i < params.messages; ++i) {
+        shapes.messages.push_back("Tick state: " + std::to_string(params.units) +
+                                  " units alive, target cell " + std::to_string(hp(rng)) +
+                                  ", decision took " + std::to_string(hp(rng)) + " ms");
+    }
+    return shapes;
+}
+
+}  // anonymous namespace
+
+std::string make_frame(const params_t &params, std::mt19937 &rng) {
+    const shapes_t shapes = make_shapes(params, rng);
+    std::string out;
+    const auto options = [&out](int layer) {
+        append(out, R"({"type": "options", "layer": %i, "permanent": %s})", layer, "false");
+    };
+
+    options(BUILDINGS_LAYER);
+    for (const auto &rect : shapes.buildings) {
+        append(out,
+               R"({"type": "rectangle", "tl": [%lf, %lf], "br": [%lf, %lf], )"
+               R"("color": %u, "fill": %s})",
+               rect.top_left.x, rect.top_left.y, rect.bottom_right.x, rect.bottom_right.y,
+               rect.color, "true");
+        append(out, R"({"type": "popup", "tl": [%lf, %lf], "br": [%lf, %lf], "text": "%s"})",
+               rect.top_left.x, rect.top_left.y, rect.bottom_right.x, rect.bottom_right.y,
+               "Building, production queue 3");
+    }
+
+    options(UNITS_LAYER);
+    for (const auto &unit : shapes.units) {
+        append(out, R"({"type": "circle", "p": [%lf, %lf], "r": %lf, "color": %u, "fill": %s})",
+               unit.center.x, unit.center.y, unit.radius, unit.color,
+               unit.fill ? "true" : "false");
+        append(out, R"({"type": "popup", "p": [%lf, %lf], "r": %lf, "text": "Unit hp %d/100"})",
+               unit.center.x, unit.center.y, unit.radius, unit.hp);
+    }
+    for (const auto &tri : shapes.triangles) {
+        append(out,
+               R"({"type": "triangle", "points": [%lf, %lf, %lf, %lf, %lf, %lf], )"
+               R"("color": %u, "fill": %s})",
+               tri.points[0].x, tri.points[0].y, tri.points[1].x, tri.points[1].y,
+               tri.points[2].x, tri.points[2].y, tri.color, "true");
+    }
+
+    options(PATHS_LAYER);
+    for (const auto &path : shapes.paths) {
+        out += R"({"type": "polyline", "points": [)";
+        for (size_t i = 0; i < path.points.size(); ++i) {
+            append(out, i == 0 ? "%lf,%lf" : ",%lf,%lf", path.points[i].x, path.points[i].y);
+        }
+        append(out, R"(], "color": %u})", path.color);
+    }
+
+    for (const auto &msg : shapes.messages) {
+        append(out, R"({"type": "message", "message": "%s"})", msg.c_str());
+    }
+    out += R"({"type": "end"})";
+    return out;
+}
+
+std::vector<std::string> split_stream(const std::string &stream, size_t chunk_size) {
+    std::vector<std::string> chunks;
+    for (size_t pos = 0; pos < stream.size(); pos += chunk_size) {
+        chunks.push_back(stream.substr(pos, chunk_size));
+    }
+    return chunks;
+}
+
+void fill_context(const params_t &params, std::mt19937 &rng, RenderContext &ctx) {
+    const shapes_t shapes = make_shapes(params, rng);
+    for (const auto &rect : shapes.buildings) {
+        ctx.add_rectangle(rect.top_left, rect.bottom_right, to_vec4(rect.color), true);
+    }
+    for (const auto &unit : shapes.units) {
+        ctx.add_circle(unit.center, unit.radius, to_vec4(unit.color), unit.fill);
+    }
+    for (const auto &tri : shapes.triangles) {
+        ctx.add_triangle(tri.points[0], tri.points[1], tri.points[2], to_vec4(tri.color), true);
+    }
+    for (const auto &path : shapes.paths) {
+        ctx.add_polyline(path.points, to_vec4(path.color));
+    }
+}
+
+void fill_frame(const params_t &params, std::mt19937 &rng, FrameEditor &frame) {
+    const shapes_t shapes = make_shapes(params, rng);
+
+    frame.set_layer_id(BUILDINGS_LAYER - 1);
+    for (const auto &rect : shapes.buildings) {
+        frame.context().add_rectangle(rect.top_left, rect.bottom_right, to_vec4(rect.color),
+                                      true);
+        frame.add_box_popup((rect.top_left + rect.bottom_right) * 0.5f,
+                            rect.bottom_right - rect.top_left, "Building, production queue 3");
+    }
+
+    frame.set_layer_id(UNITS_LAYER - 1);
+    for (const auto &unit : shapes.units) {
+        frame.context().add_circle(unit.center, unit.radius, to_vec4(unit.color), unit.fill);
+        frame.add_round_popup(unit.center, unit.radius,
+                              "Unit hp " + std::to_string(unit.hp) + "/100");
+    }
+    for (const auto &tri : shapes.triangles) {
+        frame.context().add_triangle(tri.points[0], tri.points[1], tri.points[2],
+                                     to_vec4(tri.color), true);
+    }
+
+    frame.set_layer_id(PATHS_LAYER - 1);
+    for (const auto &path : shapes.paths) {
+        frame.context().add_polyline(path.points, to_vec4(path.color));
+    }
+    for (const auto &msg : shapes.messages) {
+        frame.add_user_text(msg);
+    }
+}
+
+std::vector<float> make_points(size_t count, float world_size, std::mt19937 &rng) {
+    std::uniform_real_distribution<float> coord{0.0f, world_size};
+    std::vector<float> points(count * 2);
+    for (auto &value : points) {
+        value = coord(rng);
+    }
+    return points;
+}
+
+}  // namespace corpus
@@ -0,0 +1,55 @@
+//
+// Created by valdemar on 18.10.26.
+//
+
+#pragma once
+
+#include <viewer/FrameEditor.h>
+#include <viewer/RenderContext.h>
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+/**
+ * Synthetic strategy output for benchmarks. Shapes follow what a typical bot draws each tick:
+ * units as circles with popups, buildings as rectangles, planned paths as polylines, few
+ * triangles and log messages, spread over several layers. Messages are formatted exactly as
+ * the bundled C++ client does.
+ */
+namespace corpus {
+
+struct params_t {
+    /// Circles, each one with round popup
+    size_t units = 200;
+    float unit_radius = 4.0f;
+    /// Rectangles, each one with box popup
+    size_t buildings = 40;
+    float building_size = 32.0f;
+    size_t paths = 30;
+    size_t path_points = 12;
+    size_t triangles = 20;
+    size_t messages = 5;
+    /// World area side, as in default scene config
+    float world_size = 1024.0f;
+    /// Corner of area shapes placed in
+    glm::vec2 origin{0.0f};
+};
+
+/// Messages of one frame as sent by strategy, ends with end message
+std::string make_frame(const params_t &params, std::mt19937 &rng);
+
+/// Stream split into pieces the way socket reads return it
+std::vector<std::string> split_stream(const std::string &stream, size_t chunk_size);
+
+/// Same primitives as make_frame() produces, added to context directly
+void fill_context(const params_t &params, std::mt19937 &rng, RenderContext &ctx);
+
+/// Same primitives and popups as make_frame() produces, spread over layers the same way
+void fill_frame(const params_t &params, std::mt19937 &rng, FrameEditor &frame);
+
+/// Random coordinates [x1, y1, x2, y2, ...] of given points count
+std::vector<float> make_points(size_t count, float world_size, std::mt19937 &rng);
+
+}  // namespace corpus
@@ -0,0 +1,212 @@
+//
+// Created by valdemar on 18.10.26.
+//
+
+#include "Corpus.h"
+
+#include <benchmark/benchmark.h>
+
+namespace {
+
+enum Primitive : int64_t { CIRCLES, RECTANGLES, TRIANGLES, POLYLINES };
+
+/// Thousand primitives of one kind into empty context, arg is primitive kind
+void BM_ContextAdd(benchmark::State &state) {
+    constexpr size_t COUNT = 1000;
+    std::mt19937 rng{42};
+    const auto points = corpus::make_points(COUNT * 3, 1024.0f, rng);
+    const auto at = [&points](size_t idx) {
+        return glm::vec2{points[idx * 2], points[idx * 2 + 1]};
+    };
+    // Twelve points, as planned paths of typical bot
+    std::vector<std::vector<glm::vec2>> paths(COUNT);
+    for (size_t i = 0; i < COUNT; ++i) {
+        for (size_t j = 0; j < 12; ++j) {
+            paths[i].push_back(at((i + j) % (COUNT * 3)));
+        }
+    }
+    const glm::vec4 color{0.9f, 0.2f, 0.2f, 1.0f};
+
+    RenderContext ctx;
+    for (auto _ : state) {
+        ctx.clear();
+        switch (state.range(0)) {
+            case CIRCLES:
+                for (size_t i = 0; i < COUNT; ++i) {
+                    ctx.add_circle(at(i), 4.0f, color, i % 4 != 0);
+                }
+                break;
+            case RECTANGLES:
+                for (size_t i = 0; i < COUNT; ++i) {
+                    ctx.add_rectangle(at(i), at(i) + glm::vec2{32.0f, 32.0f}, color, true);
+                }
+                break;
+            case TRIANGLES:
+                for (size_t i = 0; i < COUNT; ++i) {
+                    ctx.add_triangle(at(i * 3), at(i * 3 + 1), at(i * 3 + 2), color, true);
+                }
+                break;
+            case POLYLINES:
+                for (const auto &path : paths) {
+                    ctx.add_polyline(path, color);
+                }
+                break;
+        }
+        benchmark::DoNotOptimize(ctx.vertices_count());
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * COUNT));
+}
+BENCHMARK(BM_ContextAdd)
+    ->ArgName("kind")
+    ->Arg(CIRCLES)
+    ->Arg(RECTANGLES)
+    ->Arg(TRIANGLES)
+    ->Arg(POLYLINES);
+
+/// Copy of typical frame layer appended to empty context
+void BM_ContextUpdateFrom(benchmark::State &state) {
+    std::mt19937 rng{42};
+    RenderContext from;
+    corpus::fill_context({}, rng, from);
+    for (auto _ : state) {
+        RenderContext ctx;
+        ctx.update_from(from);
+        benchmark::DoNotOptimize(ctx.vertices_count());
+    }
+}
+BENCHMARK(BM_ContextUpdateFrom);
+
+/**
+ * Layers of frame queued to batch, without uploading. Args are visible part of the world side
+ * in percent and whether layers are placed apart, as units of different teams. Tags are not
+ * set, as when GPU timing is off. View is shown on full HD screen, without levels of detail
+ */
+void BM_BatchAdd(benchmark::State &state) {
+    constexpr size_t LAYERS = 8;
+    constexpr float WORLD_SIZE = 1024.0f;
+    std::mt19937 rng{42};
+    std::vector<RenderContext> layers(LAYERS);
+    for (size_t i = 0; i < LAYERS; ++i) {
+        corpus::params_t params;
+        params.units = 1000;
+        params.buildings = 300;
+        if (state.range(1)) {
+            // Each layer in its own cell of 4x2 grid, with gap between cells
+            constexpr float CELL_SIZE = WORLD_SIZE / 4;
+            params.world_size = CELL_SIZE / 2;
+            params.origin = glm::vec2{static_cast<float>(i % 4), static_cast<float>(i / 4)} *
+                            CELL_SIZE;
+        }
+        corpus::fill_context(params, rng, layers[i]);
+        layers[i].build_index();
+    }
+    const float view = WORLD_SIZE * static_cast<float>(state.range(0)) / 100.0f;
+    constexpr float SCREEN_WIDTH = 1920.0f;
+
+    RenderContext::Batch batch;
+    batch.set_pixel_size(view / SCREEN_WIDTH);
+    batch.set_lod_enabled(false);
+    RenderContext::Batch::draw_stats_t stats;
+    for (auto _ : state) {
+        batch.clear();
+        batch.set_visible_area({0.0f, 0.0f}, {view, view});
+        for (const auto &ctx : layers) {
+            batch.add(ctx);
+        }
+        stats = batch.queued_stats();
+    }
+    state.counters["draw_calls"] = static_cast<double>(stats.draw_calls);
+    state.counters["vertex_bytes"] = static_cast<double>(stats.vertex_bytes);
+    state.counters["elements"] = static_cast<double>(stats.elements);
+}
+BENCHMARK(BM_BatchAdd)
+    ->ArgNames({"view", "apart"})
+    ->Args({100, 0})
+    ->Args({25, 0})
+    ->Args({100, 1})
+    ->Args({25, 1})
+    ->Unit(benchmark::kMicrosecond);
+
+/**
+ * Dense swarms of small units and buildings queued to batch with levels of detail on or off.
+ * Args are visible part of the world side in percent, on full HD screen, and whether levels of
+ * detail are used. At 3200% the world takes 60 pixels and the coarsest level applies
+ */
+void BM_BatchAddZoomedOut(benchmark::State &state) {
+    constexpr size_t LAYERS = 8;
+    constexpr float WORLD_SIZE = 1024.0f;
+    std::mt19937 rng{42};
+    std::vector<RenderContext> layers(LAYERS);
+    for (auto &layer : layers) {
+        corpus::params_t params;
+        params.units = 4000;
+        params.unit_radius = 1.0f;
+        params.buildings = 2000;
+        params.building_size = 4.0f;
+        params.paths = 100;
+        corpus::fill_context(params, rng, layer);
+        layer.build_index();
+    }
+    const float view = WORLD_SIZE * static_cast<float>(state.range(0)) / 100.0f;
+    constexpr float SCREEN_WIDTH = 1920.0f;
+
+    RenderContext::Batch batch;
+    batch.set_pixel_size(view / SCREEN_WIDTH);
+    batch.set_lod_enabled(state.range(1) != 0);
+    RenderContext::Batch::draw_stats_t stats;
+    for (auto _ : state) {
+        batch.clear();
+        batch.set_visible_area({0.0f, 0.0f}, {view, view});
+        for (const auto &ctx : layers) {
+            batch.add(ctx);
+        }
+        stats = batch.queued_stats();
+    }
+    state.counters["draw_calls"] = static_cast<double>(stats.draw_calls);
+    state.counters["elements"] = static_cast<double>(stats.elements);
+}
+BENCHMARK(BM_BatchAddZoomedOut)
+    ->ArgNames({"view", "lod"})
+    ->Args({100, 0})
+    ->Args({100, 1})
+    ->Args({3200, 0})
+    ->Args({3200, 1})
+    ->Unit(benchmark::kMicrosecond);
+
+/// Immediate mode path: published frame copied and extended with newly sent data
+void BM_FrameUpdateFrom(benchmark::State &state) {
+    std::mt19937 rng{42};
+    FrameEditor base;
+    corpus::fill_frame({}, rng, base);
+    base.seal();
+    corpus::params_t small;
+    small.units = 20;
+    small.buildings = 4;
+    small.paths = 3;
+    small.triangles = 2;
+    small.messages = 1;
+    FrameEditor update;
+    corpus::fill_frame(small, rng, update);
+
+    for (auto _ : state) {
+        Frame frame{base};
+        frame.update_from(update);
+        benchmark::DoNotOptimize(frame.stats().vertex_bytes);
+    }
+}
+BENCHMARK(BM_FrameUpdateFrom)->Unit(benchmark::kMicrosecond);
+
+/// Editor reused by protocol handler after each frame, filling is not measured
+void BM_FrameEditorClear(benchmark::State &state) {
+    std::mt19937 rng{42};
+    FrameEditor frame;
+    for (auto _ : state) {
+        state.PauseTiming();
+        corpus::fill_frame({}, rng, frame);
+        state.ResumeTiming();
+        frame.clear();
+    }
+}
+BENCHMARK(BM_FrameEditorClear);
+
+}  // anonymous namespace
@@ -0,0 +1,105 @@
+//
+// Created by valdemar on 18.10.26.
+//
+
+#include "Corpus.h"
+
+#include <net/PrimitiveType.h>
+#include <net/json_handler/JsonHandler.h>
+#include <viewer/FrameSink.h>
+
+#include <benchmark/benchmark.h>
+
+namespace {
+
+/// Distinct frames fed in a loop, enough to not hit the same cache lines every time
+constexpr size_t CORPUS_FRAMES = 16;
+/// Frames are dropped periodically, otherwise they pile up in memory
+constexpr size_t FRAMES_BEFORE_CLEAR = 256;
+
+/// Keeps and seals frames as scene does, without search index, timelines and drawing
+class FrameStore : public FrameSink {
+ public:
+    void add_frame(std::shared_ptr<Frame> frame) override {
+        frame->seal();
+        frames_.push_back(std::move(frame));
+    }
+
+    void add_frame_data(const Frame &data, bool complete) override {
+        frames_.back()->update_from(data);
+        if (complete) {
+            frames_.back()->seal();
+        }
+    }
+
+    void add_permanent_frame_data(const Frame &data) override {
+        permanent_.update_from(data.all_contexts());
+    }
+
+    void clear_data() override {
+        frames_.clear();
+        permanent_.clear();
+    }
+
+ private:
+    std::vector<std::shared_ptr<Frame>> frames_;
+    FrameEditor permanent_;
+};
+
+/// Whole frame stream through protocol handler into frames, arg is socket read size
+void BM_HandleMessage(benchmark::State &state) {
+    const auto chunk_size = static_cast<size_t>(state.range(0));
+    std::mt19937 rng{42};
+    std::vector<std::vector<std::string>> frames;
+    size_t frame_bytes = 0;
+    for (size_t i = 0; i < CORPUS_FRAMES; ++i) {
+        const std::string frame = corpus::make_frame({}, rng);
+        frame_bytes += frame.size();
+        frames.push_back(corpus::split_stream(frame, chunk_size));
+    }
+
+    FrameStore store;
+    JsonHandler handler(&store);
+    handler.on_new_connection();
+
+    size_t frame_idx = 0;
+    for (auto _ : state) {
+        for (const auto &chunk : frames[frame_idx % CORPUS_FRAMES]) {
+            handler.handle_message(reinterpret_cast<const uint8_t *>(chunk.data()),
+                                   static_cast<uint32_t>(chunk.size()));
+        }
+        if (++frame_idx % FRAMES_BEFORE_CLEAR == 0) {
+            state.PauseTiming();
+            store.clear_data();
+            state.ResumeTiming();
+        }
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * frame_bytes /
+                                                 CORPUS_FRAMES));
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+// Socket read size of viewer, then heavily fragmented stream
+BENCHMARK(BM_HandleMessage)->Arg(1024)->Arg(64)->Unit(benchmark::kMicrosecond);
+
+/// Geopoints of polyline to points, arg is points count
+void BM_ConvertCheck(benchmark::State &state) {
+    std::mt19937 rng{42};
+    const auto points = corpus::make_points(static_cast<size_t>(state.range(0)), 1024.0f, rng);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(pod::convert_check(points));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ConvertCheck)->Arg(1)->Arg(12)->Arg(1024);
+
+void BM_PrimitiveTypeFromStr(benchmark::State &state) {
+    const std::vector<std::string> types = {"circle",  "rectangle", "triangle", "polyline",
+                                            "message", "popup",     "options",  "end"};
+    size_t idx = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(primitve_type_from_str(types[idx++ % types.size()]));
+    }
+}
+BENCHMARK(BM_PrimitiveTypeFromStr);
+
+}  // anonymous namespace
@@ -0,0 +1,48 @@
+//
+// Created by valdemar on 18.10.26.
+//
+
+#include <viewer/Popup.h>
+
+#include <benchmark/benchmark.h>
+
+#include <random>
+#include <vector>
+
+namespace {
+
+/// Linear scan of popups under cursor, as done without spatial index, arg is popups count
+void BM_PopupHitTestScan(benchmark::State &state) {
+    constexpr float WORLD_SIZE = 1024.0f;
+    std::mt19937 rng{42};
+    std::uniform_real_distribution<float> coord{0.0f, WORLD_SIZE};
+
+    // Units with round popups and every fifth a building with box one
+    std::vector<Popup> popups;
+    for (int64_t i = 0; i < state.range(0); ++i) {
+        const glm::vec2 center{coord(rng), coord(rng)};
+        if (i % 5 == 0) {
+            popups.push_back(Popup::create_rect(center, {32.0f, 32.0f}, "Building"));
+        } else {
+            popups.push_back(Popup::create_circle(center, 4.0f, "Unit"));
+        }
+    }
+    std::vector<glm::vec2> cursor(256);
+    for (auto &point : cursor) {
+        point = {coord(rng), coord(rng)};
+    }
+
+    size_t idx = 0;
+    for (auto _ : state) {
+        const glm::vec2 point = cursor[idx++ % cursor.size()];
+        size_t hits = 0;
+        for (const auto &popup : popups) {
+            hits += popup.hit_test(point);
+        }
+        benchmark::DoNotOptimize(hits);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_PopupHitTestScan)->Arg(240)->Arg(4096)->Arg(65536);
+
+}  // anonymous namespace
@@ -0,0 +1,8 @@
+//
+// Created by valdemar on 18.10.26.
+//
+
+#include <benchmark/benchmark.h>
+
+// Results are exported with --benchmark_out=<file> --benchmark_out_format=json
+BENCHMARK_MAIN();
@@ -28,11 +28,19 @@ Camera::Camera(const Config::CameraConf &conf)
     update_matrix();
 }
 
+Camera::Camera(const Config::CameraConf &conf, glm::ivec2 screen_size)
+    : conf_(conf)
+    , pos_{conf.start_position}
+    , viewport_size_{conf.start_viewport_size}
+    , screen_size_(screen_size) {
+    update_matrix();
+}
+
 const glm::mat4 &Camera::proj_view() const {
     return pr_view_;
 }
 
-void Camera::update() {
+bool Camera::update() {
     const auto &io = ImGui::GetIO();
     static const float zoom_speed = 0.1;
 
@@ -51,8 +59,9 @@ void Camera::update() {
 
         // Map dragging
         if (ImGui::IsMouseDragging(ImGuiMouseButton_Left)) {
-            int width, height;
-            glfwGetWindowSize(glfwGetCurrentContext(), &width, &height);
+            const auto size = window_size();
+            const int width = size.x;
+            const int height = size.y;
 
             const int min_size = std::min(width, height);
 
@@ -63,12 +72,15 @@ void Camera::update() {
             pos_ += delta;
         }
     }
+    const glm::mat4 prev_pr_view = pr_view_;
     update_matrix();
+    return prev_pr_view != pr_view_;
 }
 
 glm::vec2 Camera::screen2world(const glm::vec2 &coord) const {
-    int width, height;
-    glfwGetWindowSize(glfwGetCurrentContext(), &width, &height);
+    const auto size = window_size();
+    const int width = size.x;
+    const int height = size.y;
 
     const float half_view = viewport_size_ * 0.5f;
     const float min_size = std::min<float>(width, height);
@@ -90,8 +102,9 @@ void Camera::update_matrix() {
         viewport_size_ = VIEWPORT_MIN_SIZE;
     }
 
-    int width, height;
-    glfwGetFramebufferSize(glfwGetCurrentContext(), &width, &height);
+    const auto size = framebuffer_size();
+    const int width = size.x;
+    const int height = size.y;
 
     const float half_view = viewport_size_ * 0.5f;
     const float min_size = std::min<float>(width, height);
@@ -102,3 +115,21 @@ void Camera::update_matrix() {
                           pos_.y - y_half_view * y_axes_invert(),
                           pos_.y + y_half_view * y_axes_invert(), -1.0f, 1.0f);
 }
+
+glm::ivec2 Camera::framebuffer_size() const {
+    if (screen_size_.x > 0 && screen_size_.y > 0) {
+        return screen_size_;
+    }
+    glm::ivec2 size;
+    glfwGetFramebufferSize(glfwGetCurrentContext(), &size.x, &size.y);
+    return size;
+}
+
+glm::ivec2 Camera::window_size() const {
+    if (screen_size_.x > 0 && screen_size_.y > 0) {
+        return screen_size_;
+    }
+    glm::ivec2 size;
+    glfwGetWindowSize(glfwGetCurrentContext(), &size.x, &size.y);
+    return size;
+}
@@ -13,11 +13,15 @@ class Camera {
     friend class UIController;
 
     explicit Camera(const Config::CameraConf &conf);
+    /// Camera for offscreen rendering, screen size is fixed and no window needed
+    Camera(const Config::CameraConf &conf, glm::ivec2 screen_size);
     ~Camera() = default;
 
     const glm::mat4 &proj_view() const;
 
-    void update();
+    /// Handle user input and recalculate matrix
+    /// @return true if camera moved or viewport changed since last update
+    bool update();
 
     glm::vec2 screen2world(const glm::vec2 &coord) const;
 
@@ -27,9 +31,15 @@ class Camera {
  private:
     void update_matrix();
 
+    /// Fixed size if set, window framebuffer size otherwise
+    glm::ivec2 framebuffer_size() const;
+    glm::ivec2 window_size() const;
+
     const Config::CameraConf &conf_;
 
     glm::mat4 pr_view_{};
     glm::vec2 pos_{};
     float viewport_size_{};
+    /// Zero if camera follows current window
+    glm::ivec2 screen_size_{};
 };
@@ -34,6 +34,13 @@ GLuint ResourceManager::gen_buffer() {
     return buf;
 }
 
+GLuint ResourceManager::gen_texture() {
+    GLuint tex;
+    glGenTextures(1, &tex);
+    textures_.push_back(tex);
+    return tex;
+}
+
 GLuint ResourceManager::load_texture(const std::string &path_to_texture, bool gen_mipmap,
                                      GLint wrap_s, GLint wrap_t, GLint flt_min, GLint flt_mag) {
     int width;
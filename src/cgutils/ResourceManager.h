@@ -20,6 +20,7 @@ class ResourceManager {
 
     GLuint gen_vertex_array();
     GLuint gen_buffer();
+    GLuint gen_texture();
     GLuint load_texture(const std::string &path_to_texture, bool gen_mipmap = true,
                         GLint wrap_s = GL_CLAMP_TO_EDGE, GLint wrap_t = GL_CLAMP_TO_EDGE,
                         GLint flt_min = GL_LINEAR, GLint flt_mag = GL_LINEAR);
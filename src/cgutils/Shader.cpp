@@ -8,12 +8,20 @@
 
 #include <glm/gtc/type_ptr.hpp>
 
+#include <cstring>
 #include <stdexcept>
+#include <vector>
 
 #ifdef __APPLE__
 #include <cerrno>
 #endif
 
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
 namespace {
 
 std::string load_file(const std::string &file_path) {
@@ -31,9 +39,51 @@ std::string load_file(const std::string &file_path) {
         buf[sz] = '\0';
         content += buf;
     }
+    fclose(fd);
     return content;
 }
 
+/// ARB_get_program_binary, loaded by glad along with other functions, so any loader works
+bool program_binary_supported() {
+    static const bool supported = [] {
+        const bool loaded = GLAD_GL_ARB_get_program_binary && glGetProgramBinary &&
+                            glProgramBinary && glProgramParameteri;
+        if (!loaded) {
+            LOG_INFO("Program binaries not supported by driver, shader cache disabled");
+        }
+        return loaded;
+    }();
+    return supported;
+}
+
+/// FNV-1a, stable between runs unlike std::hash
+uint64_t hash_string(const std::string &data, uint64_t hash = 14695981039346656037ULL) {
+    for (unsigned char c : data) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+/// Binaries are valid only for the same driver, so it's part of the key
+std::string cache_key(const std::string &vs_src, const std::string &fs_src,
+                      const std::string &gs_src) {
+    std::string driver;
+    for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+        driver += reinterpret_cast<const char *>(glGetString(name));
+        driver += '\n';
+    }
+    uint64_t hash = hash_string(driver);
+    for (const auto *src : {&vs_src, &fs_src, &gs_src}) {
+        // Separator, so moving text between stages changes hash
+        hash = hash_string(*src + '\0', hash);
+    }
+
+    char buf[17];
+    snprintf(buf, sizeof(buf), "%016llx", static_cast<unsigned long long>(hash));
+    return buf;
+}
+
 bool validate_shader(GLuint shader) {
     GLint success;
     glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
@@ -73,8 +123,12 @@ GLuint create_shader(GLenum type, const std::string &source) {
     return shader;
 }
 
-GLuint create_shader_program(GLuint vert_shader, GLuint frag_shader, GLuint geom_shader) {
+GLuint create_shader_program(GLuint vert_shader, GLuint frag_shader, GLuint geom_shader,
+                             bool retrievable) {
     GLuint program = glCreateProgram();
+    if (retrievable) {
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
     glAttachShader(program, vert_shader);
     if (geom_shader != 0) {
         glAttachShader(program, geom_shader);
@@ -100,7 +154,25 @@ void Shader::set_shaders_folder(const std::string &path) {
     }
 }
 
+void Shader::set_cache_folder(const std::string &path) {
+    if (path.empty()) {
+        LOG_WARN("set_cache_folder called with empty path");
+        return;
+    }
+    path_to_cache_ = path;
+    if (path_to_cache_.back() != '/') {
+        path_to_cache_ += '/';
+    }
+    // Error ignored, folder may already exist
+#ifdef _WIN32
+    _mkdir(path_to_cache_.c_str());
+#else
+    mkdir(path_to_cache_.c_str(), 0755);
+#endif
+}
+
 std::string Shader::path_to_shaders_;
+std::string Shader::path_to_cache_;
 
 Shader::Shader(const std::string &vertex, const std::string &fragment,
                const std::string &geom /*=""*/) {
@@ -112,32 +184,46 @@ Shader::Shader(const std::string &vertex, const std::string &fragment,
                  path_to_shaders_.c_str(), vertex.c_str(), fragment.c_str());
     }
 
-    LOG_INFO("Load Vertex shader");
+    LOG_INFO("Load shader sources");
     const auto vs_src = load_file(path_to_shaders_ + vertex);
+    const auto fs_src = load_file(path_to_shaders_ + fragment);
+    const auto geom_src = geom.empty() ? std::string{} : load_file(path_to_shaders_ + geom);
+
+    std::string cache_file;
+    if (!path_to_cache_.empty() && program_binary_supported()) {
+        cache_file = path_to_cache_ + cache_key(vs_src, fs_src, geom_src) + ".bin";
+        if (load_binary(cache_file)) {
+            LOG_INFO("Program loaded from cache %s", cache_file.c_str());
+            cache_uniforms();
+            return;
+        }
+    }
+
     LOG_INFO("Compile Vertex shader");
     auto v_shader = create_shader(GL_VERTEX_SHADER, vs_src);
 
-    LOG_INFO("Load Fragment shader");
-    const auto fs_src = load_file(path_to_shaders_ + fragment);
     LOG_INFO("Compile Fragment shader");
     auto f_shader = create_shader(GL_FRAGMENT_SHADER, fs_src);
 
     GLuint geom_shader = 0;
     if (!geom.empty()) {
-        LOG_INFO("Load Geometry shader");
-        const auto geom_src = load_file(path_to_shaders_ + geom);
         LOG_INFO("Compile Geometry shader");
         geom_shader = create_shader(GL_GEOMETRY_SHADER, geom_src);
     }
 
     LOG_INFO("Link shader program");
-    program_ = create_shader_program(v_shader, f_shader, geom_shader);
+    program_ = create_shader_program(v_shader, f_shader, geom_shader, !cache_file.empty());
 
     glDeleteShader(v_shader);
     glDeleteShader(f_shader);
     if (geom_shader != 0) {
         glDeleteShader(geom_shader);
     }
+
+    if (!cache_file.empty()) {
+        save_binary(cache_file);
+    }
+    cache_uniforms();
 }
 
 Shader::~Shader() {
@@ -153,11 +239,12 @@ GLuint Shader::id() const {
 }
 
 GLint Shader::uniform(const std::string &name) const {
-    GLint loc = glGetUniformLocation(program_, name.c_str());
-    if (loc == -1) {
+    const auto it = uniforms_.find(name);
+    if (it == uniforms_.end()) {
         LOG_WARN("No such uniform:: %s", name.c_str());
+        return -1;
     }
-    return loc;
+    return it->second;
 }
 
 void Shader::set_mat4(const std::string &name, const glm::mat4 &v) const {
@@ -200,3 +287,92 @@ void Shader::set_int(const std::string &name, GLint val) const {
 void Shader::set_uint(const std::string &name, GLuint val) const {
     glUniform1ui(uniform(name), val);
 }
+
+bool Shader::load_binary(const std::string &cache_file) {
+    FILE *fd = fopen(cache_file.c_str(), "rb");
+    if (!fd) {
+        return false;
+    }
+
+    GLenum format = 0;
+    std::vector<char> binary;
+    if (fread(&format, sizeof(format), 1, fd) == 1) {
+        constexpr size_t CHUNK_SIZE = 4096;
+        char buf[CHUNK_SIZE];
+        while (size_t sz = fread(buf, 1, CHUNK_SIZE, fd)) {
+            binary.insert(binary.end(), buf, buf + sz);
+        }
+    }
+    fclose(fd);
+    if (binary.empty()) {
+        return false;
+    }
+
+    program_ = glCreateProgram();
+    glProgramBinary(program_, format, binary.data(), static_cast<GLsizei>(binary.size()));
+    GLint success;
+    glGetProgramiv(program_, GL_LINK_STATUS, &success);
+    if (!success) {
+        // Driver updated or binary corrupted
+        LOG_WARN("Cached program %s rejected by driver, recompile", cache_file.c_str());
+        glDeleteProgram(program_);
+        program_ = 0;
+        return false;
+    }
+    return true;
+}
+
+void Shader::save_binary(const std::string &cache_file) const {
+    GLint length = 0;
+    glGetProgramiv(program_, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) {
+        return;
+    }
+
+    std::vector<char> binary(static_cast<size_t>(length));
+    GLenum format = 0;
+    GLsizei written = 0;
+    glGetProgramBinary(program_, length, &written, &format, binary.data());
+    if (written <= 0) {
+        return;
+    }
+
+    FILE *fd = fopen(cache_file.c_str(), "wb");
+    if (!fd) {
+        LOG_WARN("Cannot write shader cache %s: %s", cache_file.c_str(), strerror(errno));
+        return;
+    }
+    fwrite(&format, sizeof(format), 1, fd);
+    fwrite(binary.data(), 1, static_cast<size_t>(written), fd);
+    fclose(fd);
+}
+
+void Shader::cache_uniforms() {
+    GLint count = 0;
+    GLint max_length = 0;
+    glGetProgramiv(program_, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(program_, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_length);
+
+    std::vector<GLchar> buf(static_cast<size_t>(max_length) + 1);
+    for (GLint idx = 0; idx < count; ++idx) {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(program_, static_cast<GLuint>(idx), static_cast<GLsizei>(buf.size()),
+                           &length, &size, &type, buf.data());
+        std::string name(buf.data(), static_cast<size_t>(length));
+        const GLint loc = glGetUniformLocation(program_, name.c_str());
+        if (loc == -1) {
+            // Uniform block member
+            continue;
+        }
+        // Arrays reported as name[0], but usually accessed by plain name
+        const std::string array_suffix = "[0]";
+        if (name.size() > array_suffix.size() &&
+            name.compare(name.size() - array_suffix.size(), array_suffix.size(), array_suffix) ==
+                0) {
+            name.resize(name.size() - array_suffix.size());
+        }
+        uniforms_[name] = loc;
+    }
+}
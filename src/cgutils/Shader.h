@@ -8,6 +8,7 @@
 #include <glm/glm.hpp>
 
 #include <string>
+#include <unordered_map>
 
 /**
  * Class representing ShaderProgram
@@ -16,6 +17,10 @@ class Shader {
  public:
     static void set_shaders_folder(const std::string &path);
 
+    /// Folder for linked program binaries, keyed by driver and sources hash.
+    /// Cache is not used until folder is set or if driver can't retrieve program binaries
+    static void set_cache_folder(const std::string &path);
+
     Shader(const std::string &vertex, const std::string &fragment, const std::string &geom = "");
     ~Shader();
 
@@ -23,6 +28,7 @@ class Shader {
 
     GLuint id() const;
 
+    /// Location cached at link time, -1 if program has no such active uniform
     GLint uniform(const std::string &name) const;
 
     void set_mat4(const std::string &name, const glm::mat4 &v) const;
@@ -37,7 +43,14 @@ class Shader {
     void bind_uniform_block(const std::string &name, GLuint binding_point) const;
 
  private:
+    /// Try to load program from cache, return false if there is no valid binary
+    bool load_binary(const std::string &cache_file);
+    void save_binary(const std::string &cache_file) const;
+    void cache_uniforms();
+
     static std::string path_to_shaders_;
+    static std::string path_to_cache_;
 
     GLuint program_ = 0;
+    std::unordered_map<std::string, GLint> uniforms_;
 };
@@ -6,6 +6,7 @@
 
 #include <glad/glad.h>
 
+#include <cstddef>
 #include <cstdint>
 
 namespace cg {
@@ -16,7 +17,7 @@ void gl_check_error(const char *file, int line);
 }  // namespace details
 
 template <typename T>
-constexpr void *offset(uint16_t shift) {
+constexpr void *offset(size_t shift) {
     return reinterpret_cast<void *>(shift * sizeof(T));
 }
 
@@ -0,0 +1,286 @@
+//
+// Created by valdemar on 18.10.26.
+//
+
+#include "JobSystem.h"
+
+#include <common/Profiler.h>
+#include <common/logger.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using clock_t_ = std::chrono::steady_clock;
+
+/// Pool and worker index of current thread, used to submit jobs into own queue
+thread_local const void *tls_pool = nullptr;
+thread_local size_t tls_worker = 0;
+
+}  // anonymous namespace
+
+struct JobSystem::Group::group_state_t {
+    std::atomic<size_t> pending{0};
+    std::mutex mutex;
+    std::condition_variable cv;
+
+    void finish_job() {
+        if (--pending == 0) {
+            // Waiter checks counter under this mutex, so wakeup is never lost
+            std::lock_guard<std::mutex> lock(mutex);
+            cv.notify_all();
+        }
+    }
+};
+
+struct JobSystem::job_t {
+    std::function<void()> fn;
+    std::shared_ptr<Group::group_state_t> group;
+    std::shared_ptr<std::atomic<bool>> cancelled;
+    clock_t_::time_point submitted;
+    size_t priority = 0;
+};
+
+struct JobSystem::worker_t {
+    std::mutex mutex;
+    std::array<std::deque<job_t>, PRIORITIES_COUNT> queues;
+};
+
+struct JobSystem::pool_state_t {
+    std::vector<std::unique_ptr<worker_t>> workers;
+    std::vector<std::thread> threads;
+
+    std::mutex sleep_mutex;
+    std::condition_variable cv;
+    bool stop = false;
+
+    std::array<std::atomic<size_t>, PRIORITIES_COUNT> queued{};
+    std::atomic<size_t> next_worker{0};
+
+    std::array<std::atomic<uint64_t>, PRIORITIES_COUNT> executed{};
+    std::array<std::atomic<uint64_t>, PRIORITIES_COUNT> cancelled{};
+    std::array<std::atomic<uint64_t>, PRIORITIES_COUNT> latency_ns{};
+    std::array<std::atomic<uint64_t>, PRIORITIES_COUNT> max_latency_ns{};
+
+    bool has_jobs() const {
+        for (const auto &count : queued) {
+            if (count.load() > 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+JobSystem::CancelToken::CancelToken() : flag_(std::make_shared<std::atomic<bool>>(false)) {}
+
+void JobSystem::CancelToken::cancel() {
+    flag_->store(true);
+}
+
+bool JobSystem::CancelToken::cancelled() const {
+    return flag_->load();
+}
+
+JobSystem::Group::Group() : state_(std::make_shared<group_state_t>()) {}
+
+bool JobSystem::Group::done() const {
+    return state_->pending.load() == 0;
+}
+
+JobSystem::JobSystem(size_t threads) {
+    state_ = std::make_unique<pool_state_t>();
+    if (threads == 0) {
+        // Render thread is busy on its own
+        threads = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+    }
+    for (size_t idx = 0; idx < threads; ++idx) {
+        state_->workers.push_back(std::make_unique<worker_t>());
+    }
+    for (size_t idx = 0; idx < threads; ++idx) {
+        state_->threads.emplace_back([this, idx] { worker_loop(idx); });
+    }
+}
+
+JobSystem::~JobSystem() {
+    {
+        std::lock_guard<std::mutex> lock(state_->sleep_mutex);
+        state_->stop = true;
+    }
+    state_->cv.notify_all();
+    for (auto &thread : state_->threads) {
+        thread.join();
+    }
+    // Nobody runs dropped jobs, but groups should not wait for them
+    for (auto &worker : state_->workers) {
+        for (auto &queue : worker->queues) {
+            for (auto &job : queue) {
+                if (job.group) {
+                    job.group->finish_job();
+                }
+            }
+        }
+    }
+}
+
+JobSystem &JobSystem::shared() {
+    static JobSystem pool;
+    return pool;
+}
+
+size_t JobSystem::threads_count() const {
+    return state_->threads.size();
+}
+
+void JobSystem::submit(Priority priority, std::function<void()> job, Group *group,
+                       const CancelToken *token) {
+    auto &st = *state_;
+    job_t item;
+    item.fn = std::move(job);
+    item.priority = static_cast<size_t>(priority);
+    item.submitted = clock_t_::now();
+    if (group) {
+        item.group = group->state_;
+        ++item.group->pending;
+    }
+    if (token) {
+        item.cancelled = token->flag_;
+    }
+
+    // Worker keeps own jobs close, others are spread evenly
+    const size_t idx = tls_pool == &st ? tls_worker : st.next_worker++ % st.workers.size();
+    {
+        std::lock_guard<std::mutex> lock(st.workers[idx]->mutex);
+        st.workers[idx]->queues[item.priority].push_back(std::move(item));
+    }
+    ++st.queued[static_cast<size_t>(priority)];
+    {
+        // Sleeping worker checks queued counters under this mutex, so wakeup is never lost
+        std::lock_guard<std::mutex> lock(st.sleep_mutex);
+    }
+    st.cv.notify_one();
+}
+
+void JobSystem::wait(const Group &group) {
+    const size_t own_idx = tls_pool == state_.get() ? tls_worker : state_->workers.size();
+    auto &group_state = *group.state_;
+    job_t job;
+    while (take_job(own_idx, job, &group_state)) {
+        execute(job);
+    }
+    // Remaining jobs are running on workers. Ones they submit into group are left for them too
+    std::unique_lock<std::mutex> lock(group_state.mutex);
+    group_state.cv.wait(lock, [&group_state] { return group_state.pending.load() == 0; });
+}
+
+JobSystem::stats_t JobSystem::stats() const {
+    const auto &st = *state_;
+    stats_t stats;
+    for (size_t p = 0; p < PRIORITIES_COUNT; ++p) {
+        auto &queue = stats[p];
+        queue.executed = st.executed[p];
+        queue.cancelled = st.cancelled[p];
+        queue.queued = st.queued[p];
+        if (queue.executed > 0) {
+            queue.avg_latency_ms = static_cast<double>(st.latency_ns[p]) * 1e-6 / queue.executed;
+        }
+        queue.max_latency_ms = static_cast<double>(st.max_latency_ns[p]) * 1e-6;
+    }
+    return stats;
+}
+
+void JobSystem::worker_loop(size_t idx) {
+    auto &st = *state_;
+    tls_pool = &st;
+    tls_worker = idx;
+    Profiler::set_thread_name("worker " + std::to_string(idx));
+
+    job_t job;
+    while (true) {
+        if (take_job(idx, job)) {
+            execute(job);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(st.sleep_mutex);
+        st.cv.wait(lock, [&st] { return st.stop || st.has_jobs(); });
+        if (st.stop) {
+            break;
+        }
+    }
+}
+
+bool JobSystem::take_job(size_t own_idx, job_t &job,
+                         const Group::group_state_t *only_group) {
+    auto &st = *state_;
+    const size_t count = st.workers.size();
+    for (size_t p = 0; p < PRIORITIES_COUNT; ++p) {
+        if (st.queued[p].load() == 0) {
+            continue;
+        }
+        // Own queue from the front, the oldest job first, stolen from the back. Thread helping
+        // in wait() takes the oldest job of its group from any queue
+        for (size_t k = 0; k < count; ++k) {
+            const size_t idx = (own_idx + k) % count;
+            auto &worker = *st.workers[idx];
+            std::lock_guard<std::mutex> lock(worker.mutex);
+            auto &queue = worker.queues[p];
+            if (queue.empty()) {
+                continue;
+            }
+            if (only_group) {
+                const auto it =
+                    std::find_if(queue.begin(), queue.end(), [only_group](const job_t &item) {
+                        return item.group.get() == only_group;
+                    });
+                if (it == queue.end()) {
+                    continue;
+                }
+                job = std::move(*it);
+                queue.erase(it);
+            } else if (idx == own_idx) {
+                job = std::move(queue.front());
+                queue.pop_front();
+            } else {
+                job = std::move(queue.back());
+                queue.pop_back();
+            }
+            --st.queued[p];
+            return true;
+        }
+    }
+    return false;
+}
+
+void JobSystem::execute(job_t &job) {
+    auto &st = *state_;
+    const size_t p = job.priority;
+    if (job.cancelled && job.cancelled->load()) {
+        ++st.cancelled[p];
+    } else {
+        const auto latency = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(clock_t_::now() - job.submitted)
+                .count());
+        st.latency_ns[p] += latency;
+        uint64_t prev_max = st.max_latency_ns[p];
+        while (prev_max < latency &&
+               !st.max_latency_ns[p].compare_exchange_weak(prev_max, latency)) {
+        }
+        try {
+            job.fn();
+        } catch (const std::exception &ex) {
+            LOG_ERROR("Job Exception:: %s", ex.what());
+        }
+        ++st.executed[p];
+    }
+    if (job.group) {
+        job.group->finish_job();
+    }
+    job = job_t{};
+}
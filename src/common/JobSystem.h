@@ -0,0 +1,105 @@
+//
+// Created by valdemar on 18.10.26.
+//
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+/**
+ * Shared pool of worker threads executing short jobs.
+ * Each worker has own queues, jobs submitted from worker go to its queues, other jobs are
+ * spread between workers. Idle worker steals from others, so load evens out.
+ * Jobs of higher priority always start first, regardless of queue they are in.
+ */
+class JobSystem {
+ public:
+    enum class Priority {
+        /// Somebody waits for result right now
+        INTERACTIVE = 0,
+        /// Result will be needed soon, e.g. upcoming frames during playback
+        PREFETCH,
+        /// Nice to have, e.g. timeline thumbnails
+        BACKGROUND,
+    };
+    static constexpr size_t PRIORITIES_COUNT = 3;
+
+    /// Shared flag of related jobs, jobs cancelled before start are dropped
+    class CancelToken {
+     public:
+        CancelToken();
+        void cancel();
+        bool cancelled() const;
+
+     private:
+        friend class JobSystem;
+        std::shared_ptr<std::atomic<bool>> flag_;
+    };
+
+    /// Counter of unfinished jobs submitted with group
+    class Group {
+     public:
+        Group();
+        /// True if all jobs finished or were dropped
+        bool done() const;
+
+     private:
+        friend class JobSystem;
+        struct group_state_t;
+        std::shared_ptr<group_state_t> state_;
+    };
+
+    struct queue_stats_t {
+        uint64_t executed = 0;
+        uint64_t cancelled = 0;
+        /// Jobs waiting for start right now
+        uint64_t queued = 0;
+        /// Time from submit to start
+        double avg_latency_ms = 0.0;
+        double max_latency_ms = 0.0;
+    };
+    using stats_t = std::array<queue_stats_t, PRIORITIES_COUNT>;
+
+    /// @param threads - workers count, zero means one less than hardware threads
+    explicit JobSystem(size_t threads = 0);
+    /// Queued jobs are dropped, running ones finished
+    ~JobSystem();
+
+    JobSystem(const JobSystem &) = delete;
+    JobSystem &operator=(const JobSystem &) = delete;
+
+    /// Pool used by viewer, created on first call
+    static JobSystem &shared();
+
+    size_t threads_count() const;
+
+    /// Queue job, exceptions thrown by job are logged
+    /// @note May be called from any thread, including workers
+    void submit(Priority priority, std::function<void()> job, Group *group = nullptr,
+                const CancelToken *token = nullptr);
+
+    /// Block until all jobs of group done, calling thread executes queued jobs of that group
+    /// meanwhile. Other jobs are never taken, so waiter isn't delayed by long background ones.
+    /// Once none of group jobs left in queues, waiter sleeps until running ones finish
+    void wait(const Group &group);
+
+    /// Cumulative since pool creation
+    stats_t stats() const;
+
+ private:
+    struct job_t;
+    struct worker_t;
+
+    void worker_loop(size_t idx);
+    /// Take job of the highest priority, own queue of worker first
+    /// @param only_group - group to take jobs from, any job if null
+    bool take_job(size_t own_idx, job_t &job, const Group::group_state_t *only_group = nullptr);
+    void execute(job_t &job);
+
+    struct pool_state_t;
+    std::unique_ptr<pool_state_t> state_;
+};
@@ -0,0 +1,167 @@
+//
+// Created by valdemar on 18.10.26.
+//
+
+#include "Profiler.h"
+
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <mutex>
+
+namespace {
+
+/// Samples of one thread, written by owner thread only
+struct ring_t {
+    struct slot_t {
+        std::atomic<int64_t> start_ns{0};
+        /// Duration in low 56 bits, stage in high 8 bits
+        std::atomic<uint64_t> packed{0};
+        std::atomic<int64_t> arg{0};
+    };
+
+    explicit ring_t(uint32_t thread_idx) : thread(thread_idx) {}
+
+    std::array<slot_t, Profiler::RING_SIZE> slots;
+    /// Samples ever written
+    std::atomic<uint64_t> head{0};
+    const uint32_t thread;
+    /// Guarded by registry mutex
+    std::string name;
+};
+
+constexpr int DURATION_BITS = 56;
+constexpr uint64_t DURATION_MASK = (uint64_t{1} << DURATION_BITS) - 1;
+
+/// Rings outlive their threads, thread count of viewer is small and fixed
+struct registry_t {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<ring_t>> rings;
+    size_t readers = 0;
+};
+
+registry_t &registry() {
+    // Never destroyed, detached threads may record during exit
+    static auto *instance = new registry_t;
+    return *instance;
+}
+
+thread_local ring_t *tls_ring = nullptr;
+
+ring_t *own_ring() {
+    if (!tls_ring) {
+        auto &reg = registry();
+        std::lock_guard<std::mutex> lock{reg.mutex};
+        reg.rings.push_back(std::make_unique<ring_t>(static_cast<uint32_t>(reg.rings.size())));
+        tls_ring = reg.rings.back().get();
+    }
+    return tls_ring;
+}
+
+}  // anonymous namespace
+
+std::atomic<bool> Profiler::enabled_{false};
+
+Profiler::Reader::Reader() {
+    auto &reg = registry();
+    std::lock_guard<std::mutex> lock{reg.mutex};
+    for (const auto &ring : reg.rings) {
+        positions_.push_back(ring->head.load(std::memory_order_acquire));
+    }
+    if (reg.readers++ == 0) {
+        enabled_.store(true, std::memory_order_relaxed);
+    }
+}
+
+Profiler::Reader::~Reader() {
+    auto &reg = registry();
+    std::lock_guard<std::mutex> lock{reg.mutex};
+    if (--reg.readers == 0) {
+        enabled_.store(false, std::memory_order_relaxed);
+    }
+}
+
+const char *Profiler::stage_name(Profiler::Stage stage) {
+    static const char *names[STAGES_COUNT] = {"receive", "parse",  "commit",   "seal",
+                                              "upload",  "draw",   "ui build", "swap"};
+    return stage < STAGES_COUNT ? names[stage] : "unknown";
+}
+
+void Profiler::record(Profiler::Stage stage, clock_t::time_point start, clock_t::time_point end,
+                      int64_t arg) {
+    ring_t *ring = own_ring();
+    const uint64_t idx = ring->head.load(std::memory_order_relaxed);
+    const auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start);
+    const auto since_epoch =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(start.time_since_epoch());
+
+    // Reader which sees any of slot stores also sees head of previous record, so it can tell
+    // the slot is being overwritten
+    std::atomic_thread_fence(std::memory_order_release);
+    auto &slot = ring->slots[idx % RING_SIZE];
+    slot.start_ns.store(since_epoch.count(), std::memory_order_relaxed);
+    slot.packed.store((static_cast<uint64_t>(duration.count()) & DURATION_MASK) |
+                          (static_cast<uint64_t>(stage) << DURATION_BITS),
+                      std::memory_order_relaxed);
+    slot.arg.store(arg, std::memory_order_relaxed);
+    ring->head.store(idx + 1, std::memory_order_release);
+}
+
+void Profiler::Reader::drain(std::vector<Profiler::sample_t> &out) {
+    // Rings are never removed, so only the list itself needs lock
+    std::vector<ring_t *> rings;
+    {
+        auto &reg = registry();
+        std::lock_guard<std::mutex> lock{reg.mutex};
+        for (const auto &ring : reg.rings) {
+            rings.push_back(ring.get());
+        }
+    }
+    // Threads registered after reader creation are read from the start
+    positions_.resize(rings.size(), 0);
+
+    for (size_t ring_idx = 0; ring_idx < rings.size(); ++ring_idx) {
+        const ring_t *ring = rings[ring_idx];
+        const uint64_t head = ring->head.load(std::memory_order_acquire);
+        uint64_t from = positions_[ring_idx];
+        if (head - from > RING_SIZE) {
+            dropped_ += head - from - RING_SIZE;
+            from = head - RING_SIZE;
+        }
+        const size_t first_out = out.size();
+        for (uint64_t idx = from; idx < head; ++idx) {
+            const auto &slot = ring->slots[idx % RING_SIZE];
+            const uint64_t packed = slot.packed.load(std::memory_order_relaxed);
+            out.push_back({static_cast<Stage>(packed >> DURATION_BITS), ring->thread,
+                           slot.start_ns.load(std::memory_order_relaxed),
+                           static_cast<int64_t>(packed & DURATION_MASK),
+                           slot.arg.load(std::memory_order_relaxed)});
+        }
+
+        // Slots the writer got back to while they were copied are torn, drop them
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const uint64_t new_head = ring->head.load(std::memory_order_relaxed);
+        if (new_head + 1 > from + RING_SIZE) {
+            const uint64_t torn = std::min(new_head + 1 - RING_SIZE - from, head - from);
+            out.erase(out.begin() + first_out, out.begin() + first_out + torn);
+            dropped_ += torn;
+        }
+        positions_[ring_idx] = head;
+    }
+}
+
+void Profiler::set_thread_name(std::string name) {
+    ring_t *ring = own_ring();
+    std::lock_guard<std::mutex> lock{registry().mutex};
+    ring->name = std::move(name);
+}
+
+std::vector<std::string> Profiler::thread_names() {
+    auto &reg = registry();
+    std::lock_guard<std::mutex> lock{reg.mutex};
+    std::vector<std::string> names;
+    for (const auto &ring : reg.rings) {
+        names.push_back(ring->name);
+    }
+    return names;
+}
@@ -0,0 +1,130 @@
+//
+// Created by valdemar on 18.10.26.
+//
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Wall time of viewer pipeline stages across threads.
+ * Each thread writes finished scopes into own ring buffer without locks, readers drain all
+ * rings from time to time. Timing is enabled while any reader exists, otherwise a scope costs
+ * one relaxed load.
+ * Nested stages are included into enclosing ones, e.g. parse includes commit and seal.
+ * Samples are shown by ui and written to trace file, see TraceWriter.
+ */
+class Profiler {
+ public:
+    enum Stage : uint8_t {
+        /// Socket read, includes waiting for data, arg is bytes count
+        RECEIVE = 0,
+        /// Arg is bytes count
+        PARSE,
+        /// Complete frame handed over to scene
+        COMMIT,
+        /// Frame indexed and published, arg is frame index
+        SEAL,
+        /// Vertex data transferred to GPU buffers, arg is elements count
+        UPLOAD,
+        /// Arg is elements count
+        DRAW,
+        /// ImGui widgets and draw lists
+        UI_BUILD,
+        /// Buffer swap, includes waiting for vsync
+        SWAP,
+    };
+    static constexpr size_t STAGES_COUNT = SWAP + 1;
+    /// Samples per thread, unread ones are overwritten when reader falls behind
+    static constexpr size_t RING_SIZE = 4096;
+
+    using clock_t = std::chrono::steady_clock;
+
+    /// Sample without argument
+    static constexpr int64_t NO_ARG = -1;
+
+    struct sample_t {
+        Stage stage;
+        /// Registration order of writing thread
+        uint32_t thread;
+        /// Since clock epoch
+        int64_t start_ns;
+        int64_t duration_ns;
+        /// Stage specific, e.g. frame index
+        int64_t arg;
+    };
+
+    /// Times enclosing block if profiler was enabled at block start
+    class Scope {
+     public:
+        explicit Scope(Stage stage, int64_t arg = NO_ARG)
+            : stage_(stage), active_(enabled()), arg_(arg) {
+            if (active_) {
+                start_ = clock_t::now();
+            }
+        }
+        ~Scope() {
+            if (active_) {
+                record(stage_, start_, clock_t::now(), arg_);
+            }
+        }
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+        /// Argument may become known only at the end of block
+        void set_arg(int64_t arg) {
+            arg_ = arg;
+        }
+
+     private:
+        Stage stage_;
+        bool active_;
+        int64_t arg_;
+        clock_t::time_point start_;
+    };
+
+    /// Consumer of samples written after its creation, each reader sees all of them
+    class Reader {
+     public:
+        Reader();
+        ~Reader();
+        Reader(const Reader &) = delete;
+        Reader &operator=(const Reader &) = delete;
+
+        /// Append samples written since previous call, in per thread order
+        /// @note Not thread safe, but different readers may drain concurrently
+        void drain(std::vector<sample_t> &out);
+
+        /// Samples overwritten before this reader drained them
+        uint64_t dropped() const {
+            return dropped_;
+        }
+
+     private:
+        /// Read position in each ring
+        std::vector<uint64_t> positions_;
+        uint64_t dropped_ = 0;
+    };
+
+    static bool enabled() {
+        return enabled_.load(std::memory_order_relaxed);
+    }
+
+    static const char *stage_name(Stage stage);
+
+    /// Append sample to ring of calling thread, never blocks
+    static void record(Stage stage, clock_t::time_point start, clock_t::time_point end,
+                       int64_t arg = NO_ARG);
+
+    /// Name shown for calling thread in traces
+    static void set_thread_name(std::string name);
+    /// Names indexed by sample_t::thread, empty for unnamed threads
+    static std::vector<std::string> thread_names();
+
+ private:
+    static std::atomic<bool> enabled_;
+};
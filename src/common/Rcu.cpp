@@ -0,0 +1,88 @@
+//
+// Created by valdemar on 18.10.26.
+//
+
+#include "Rcu.h"
+
+#include <algorithm>
+#include <limits>
+#include <thread>
+
+EpochDomain::ReadGuard::ReadGuard(EpochDomain *domain) : domain_(domain) {
+    domain_->read_sections_.fetch_add(1, std::memory_order_relaxed);
+    while (true) {
+        // Epoch read before announcing is never newer than actual one, so reader only holds
+        // objects a bit longer. Announce happens before any load of published pointers
+        const uint64_t epoch = domain_->epoch_.load();
+        for (slot_ = 0; slot_ < MAX_READERS; ++slot_) {
+            uint64_t expected = 0;
+            if (domain_->readers_[slot_].compare_exchange_strong(expected, epoch)) {
+                return;
+            }
+        }
+        // More simultaneous readers than slots, never happens with viewer threads
+        std::this_thread::yield();
+    }
+}
+
+EpochDomain::ReadGuard::~ReadGuard() {
+    domain_->readers_[slot_].store(0);
+}
+
+void EpochDomain::ReadGuard::refresh() {
+    domain_->read_sections_.fetch_add(1, std::memory_order_relaxed);
+    domain_->readers_[slot_].store(domain_->epoch_.load());
+}
+
+EpochDomain::~EpochDomain() {
+    for (const auto &item : retired_) {
+        item.deleter(item.ptr);
+    }
+}
+
+void EpochDomain::retire_impl(void *ptr, deleter_t deleter) {
+    if (!ptr) {
+        return;
+    }
+    // Readers which could load object have announced epoch not newer than that
+    const uint64_t epoch = epoch_.fetch_add(1);
+    std::lock_guard<std::mutex> lock(retired_mutex_);
+    retired_.push_back({epoch, ptr, deleter});
+    ++retired_count_;
+}
+
+void EpochDomain::reclaim() {
+    uint64_t min_active = std::numeric_limits<uint64_t>::max();
+    for (const auto &reader : readers_) {
+        const uint64_t epoch = reader.load();
+        if (epoch != 0) {
+            min_active = std::min(min_active, epoch);
+        }
+    }
+
+    std::vector<retired_t> expired;
+    {
+        std::lock_guard<std::mutex> lock(retired_mutex_);
+        const auto it = std::partition(retired_.begin(), retired_.end(),
+                                       [min_active](const retired_t &item) {
+                                           return item.epoch >= min_active;
+                                       });
+        expired.assign(it, retired_.end());
+        retired_.erase(it, retired_.end());
+        reclaimed_count_ += expired.size();
+    }
+    // Deleters may be slow, e.g. whole frames history after clear
+    for (const auto &item : expired) {
+        item.deleter(item.ptr);
+    }
+}
+
+EpochDomain::stats_t EpochDomain::stats() const {
+    stats_t stats;
+    stats.read_sections = read_sections_.load(std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(retired_mutex_);
+    stats.retired = retired_count_;
+    stats.reclaimed = reclaimed_count_;
+    stats.pending = retired_.size();
+    return stats;
+}
@@ -0,0 +1,117 @@
+//
+// Created by valdemar on 18.10.26.
+//
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * Epoch based reclamation of objects published by atomic pointer swap.
+ * Readers announce current epoch when entering read section and never wait for anyone.
+ * Writers retire replaced objects, which are deleted once no reader section started before
+ * replacement is alive.
+ */
+class EpochDomain {
+ public:
+    /// Maximum simultaneously alive read sections
+    static constexpr size_t MAX_READERS = 32;
+
+    struct stats_t {
+        uint64_t read_sections = 0;
+        uint64_t retired = 0;
+        uint64_t reclaimed = 0;
+        /// Retired objects still reachable by some reader
+        uint64_t pending = 0;
+    };
+
+    /// Read section, objects loaded from cells of domain stay alive until guard destroyed
+    class ReadGuard {
+     public:
+        explicit ReadGuard(EpochDomain *domain);
+        ~ReadGuard();
+        ReadGuard(const ReadGuard &) = delete;
+        ReadGuard &operator=(const ReadGuard &) = delete;
+
+        /// Start new read section in the same slot, objects loaded before may be deleted
+        void refresh();
+
+     private:
+        EpochDomain *domain_;
+        size_t slot_;
+    };
+
+    EpochDomain() = default;
+    /// All read sections should be finished, retired objects are deleted
+    ~EpochDomain();
+
+    /// Delete object once readers can't see it anymore, object should be unreachable already
+    template <typename T>
+    void retire(const T *ptr) {
+        retire_impl(const_cast<T *>(ptr), [](void *p) { delete static_cast<T *>(p); });
+    }
+
+    /// Delete retired objects not visible to any reader
+    void reclaim();
+
+    stats_t stats() const;
+
+ private:
+    using deleter_t = void (*)(void *);
+    void retire_impl(void *ptr, deleter_t deleter);
+
+    struct retired_t {
+        uint64_t epoch;
+        void *ptr;
+        deleter_t deleter;
+    };
+
+    // Starts from one, zero slot value means free slot
+    std::atomic<uint64_t> epoch_{1};
+    std::array<std::atomic<uint64_t>, MAX_READERS> readers_{};
+    std::atomic<uint64_t> read_sections_{0};
+
+    mutable std::mutex retired_mutex_;
+    std::vector<retired_t> retired_;
+    uint64_t retired_count_ = 0;
+    uint64_t reclaimed_count_ = 0;
+};
+
+/**
+ * Pointer to immutable object replaced as a whole by writers.
+ * Load is valid inside read section of the same domain, writers should be serialized by caller.
+ */
+template <typename T>
+class RcuCell {
+ public:
+    RcuCell(EpochDomain *domain, std::unique_ptr<T> initial)
+        : domain_(domain), ptr_(initial.release()) {}
+
+    ~RcuCell() {
+        delete ptr_.load();
+    }
+
+    RcuCell(const RcuCell &) = delete;
+    RcuCell &operator=(const RcuCell &) = delete;
+
+    /// @note Call only with alive EpochDomain::ReadGuard
+    const T *load() const {
+        return ptr_.load();
+    }
+
+    /// Replace object, previous one is deleted when readers are done with it
+    void publish(std::unique_ptr<T> value) {
+        const T *old = ptr_.exchange(value.release());
+        domain_->retire(old);
+        domain_->reclaim();
+    }
+
+ private:
+    EpochDomain *domain_;
+    std::atomic<T *> ptr_;
+};
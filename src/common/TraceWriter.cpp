@@ -0,0 +1,138 @@
+//
+// Created by valdemar on 18.10.26.
+//
+
+#include "TraceWriter.h"
+
+#include <common/Profiler.h>
+#include <common/logger.h>
+
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace {
+
+/// Rings hold 4096 samples per thread, so drain often enough to not lose them on bursts
+constexpr auto DRAIN_PERIOD = std::chrono::milliseconds(20);
+
+const char *arg_name(Profiler::Stage stage) {
+    switch (stage) {
+        case Profiler::RECEIVE:
+        case Profiler::PARSE:
+            return "bytes";
+        case Profiler::SEAL:
+            return "frame";
+        case Profiler::UPLOAD:
+        case Profiler::DRAW:
+            return "elements";
+        default:
+            return nullptr;
+    }
+}
+
+/// Thread names are set by the viewer, only quotes and backslashes need escaping
+std::string escape(const std::string &str) {
+    std::string result;
+    for (char c : str) {
+        if (c == '"' || c == '\\') {
+            result.push_back('\\');
+        }
+        result.push_back(c);
+    }
+    return result;
+}
+
+}  // anonymous namespace
+
+struct TraceWriter::state_t {
+    FILE *fd = nullptr;
+    Profiler::Reader reader;
+    std::vector<Profiler::sample_t> samples;
+    /// Timestamps are relative to trace start, keeps them short
+    int64_t origin_ns = 0;
+    size_t written = 0;
+
+    std::mutex mutex;
+    std::condition_variable wakeup;
+    bool stop = false;
+    std::thread thread;
+
+    void write_samples() {
+        samples.clear();
+        reader.drain(samples);
+        for (const auto &sample : samples) {
+            fprintf(fd,
+                    "%s\n{\"name\":\"%s\",\"cat\":\"viewer\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,"
+                    "\"ts\":%.3f,\"dur\":%.3f",
+                    written == 0 ? "" : ",", Profiler::stage_name(sample.stage), sample.thread,
+                    static_cast<double>(sample.start_ns - origin_ns) * 1e-3,
+                    static_cast<double>(sample.duration_ns) * 1e-3);
+            const char *arg = arg_name(sample.stage);
+            if (arg && sample.arg != Profiler::NO_ARG) {
+                fprintf(fd, ",\"args\":{\"%s\":%lld}", arg, static_cast<long long>(sample.arg));
+            }
+            fputc('}', fd);
+            ++written;
+        }
+    }
+
+    void write_thread_names() {
+        const auto names = Profiler::thread_names();
+        for (size_t idx = 0; idx < names.size(); ++idx) {
+            if (names[idx].empty()) {
+                continue;
+            }
+            fprintf(fd,
+                    "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%zu,"
+                    "\"args\":{\"name\":\"%s\"}}",
+                    written == 0 ? "" : ",", idx, escape(names[idx]).c_str());
+            ++written;
+        }
+    }
+
+    void run() {
+        std::unique_lock<std::mutex> lock{mutex};
+        while (!stop) {
+            wakeup.wait_for(lock, DRAIN_PERIOD);
+            lock.unlock();
+            write_samples();
+            lock.lock();
+        }
+    }
+};
+
+TraceWriter::TraceWriter(const std::string &path) : state_(std::make_unique<state_t>()) {
+    state_->fd = fopen(path.c_str(), "wb");
+    if (!state_->fd) {
+        throw std::runtime_error("Cannot open trace file " + path);
+    }
+    state_->origin_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            Profiler::clock_t::now().time_since_epoch())
+                            .count();
+    fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", state_->fd);
+    state_->thread = std::thread([this] { state_->run(); });
+    LOG_INFO("Writing trace to %s", path.c_str());
+}
+
+TraceWriter::~TraceWriter() {
+    {
+        std::lock_guard<std::mutex> lock{state_->mutex};
+        state_->stop = true;
+    }
+    state_->wakeup.notify_one();
+    state_->thread.join();
+
+    state_->write_samples();
+    state_->write_thread_names();
+    fputs("\n]}\n", state_->fd);
+    fclose(state_->fd);
+    LOG_INFO("Trace finished, %zu events", state_->written);
+    if (state_->reader.dropped() > 0) {
+        LOG_WARN("Trace lost %llu samples, writer didn't keep up",
+                 static_cast<unsigned long long>(state_->reader.dropped()));
+    }
+}
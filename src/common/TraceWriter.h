@@ -0,0 +1,28 @@
+//
+// Created by valdemar on 18.10.26.
+//
+
+#pragma once
+
+#include <memory>
+#include <string>
+
+/**
+ * Streams profiler samples of all threads to file in Chrome trace event format, which opens in
+ * chrome://tracing and Perfetto UI. Samples are drained and written by own thread, traced
+ * threads never wait for disk.
+ */
+class TraceWriter {
+ public:
+    /// @throws std::runtime_error if file can't be created
+    explicit TraceWriter(const std::string &path);
+    /// Writes samples recorded so far and closes file
+    ~TraceWriter();
+
+    TraceWriter(const TraceWriter &) = delete;
+    TraceWriter &operator=(const TraceWriter &) = delete;
+
+ private:
+    struct state_t;
+    std::unique_ptr<state_t> state_;
+};
@@ -0,0 +1,135 @@
+//
+// Created by valdemar on 18.10.26.
+//
+
+#include "EglContext.h"
+
+#include <common/logger.h>
+
+#include <glad/glad.h>
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+std::runtime_error egl_error(const char *call) {
+    char buf[128];
+    snprintf(buf, sizeof(buf), "%s failed, EGL error 0x%x", call, eglGetError());
+    return std::runtime_error(buf);
+}
+
+bool has_extension(const char *extensions, const char *name) {
+    if (!extensions) {
+        return false;
+    }
+    const size_t len = strlen(name);
+    for (const char *pos = strstr(extensions, name); pos; pos = strstr(pos + len, name)) {
+        const bool starts = pos == extensions || pos[-1] == ' ';
+        const bool ends = pos[len] == ' ' || pos[len] == '\0';
+        if (starts && ends) {
+            return true;
+        }
+    }
+    return false;
+}
+
+EGLDisplay open_display() {
+    const char *client_extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    if (has_extension(client_extensions, "EGL_MESA_platform_surfaceless")) {
+        const auto get_platform_display = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+            eglGetProcAddress("eglGetPlatformDisplayEXT"));
+        if (get_platform_display) {
+            EGLDisplay display =
+                get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+            if (display != EGL_NO_DISPLAY) {
+                LOG_INFO("Use Mesa surfaceless platform");
+                return display;
+            }
+        }
+    }
+    return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+}
+
+}  // anonymous namespace
+
+struct EglContext::egl_state_t {
+    EGLDisplay display = EGL_NO_DISPLAY;
+    EGLContext context = EGL_NO_CONTEXT;
+};
+
+EglContext::EglContext() {
+    impl_ = std::make_unique<egl_state_t>();
+
+    auto &display = impl_->display;
+    display = open_display();
+    if (display == EGL_NO_DISPLAY) {
+        throw std::runtime_error("No EGL display available");
+    }
+    EGLint major;
+    EGLint minor;
+    if (!eglInitialize(display, &major, &minor)) {
+        throw egl_error("eglInitialize");
+    }
+    LOG_INFO("EGL %d.%d, vendor %s", major, minor, eglQueryString(display, EGL_VENDOR));
+
+    if (!has_extension(eglQueryString(display, EGL_EXTENSIONS), "EGL_KHR_surfaceless_context")) {
+        eglTerminate(display);
+        throw std::runtime_error("EGL_KHR_surfaceless_context is not supported");
+    }
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+        eglTerminate(display);
+        throw egl_error("eglBindAPI");
+    }
+
+    //@formatter:off
+    const EGLint config_attribs[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE, 8,
+        EGL_GREEN_SIZE, 8,
+        EGL_BLUE_SIZE, 8,
+        EGL_ALPHA_SIZE, 8,
+        EGL_NONE
+    };
+    const EGLint context_attribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION_KHR, 3,
+        EGL_CONTEXT_MINOR_VERSION_KHR, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK_KHR, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT_KHR,
+        EGL_NONE
+    };
+    //@formatter:on
+    EGLConfig config;
+    EGLint configs_cnt = 0;
+    if (!eglChooseConfig(display, config_attribs, &config, 1, &configs_cnt) || configs_cnt == 0) {
+        eglTerminate(display);
+        throw egl_error("eglChooseConfig");
+    }
+    impl_->context = eglCreateContext(display, config, EGL_NO_CONTEXT, context_attribs);
+    if (impl_->context == EGL_NO_CONTEXT) {
+        eglTerminate(display);
+        throw egl_error("eglCreateContext");
+    }
+    if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, impl_->context)) {
+        eglDestroyContext(display, impl_->context);
+        eglTerminate(display);
+        throw egl_error("eglMakeCurrent");
+    }
+
+    if (!gladLoadGLLoader(reinterpret_cast<GLADloadproc>(eglGetProcAddress))) {
+        eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        eglDestroyContext(display, impl_->context);
+        eglTerminate(display);
+        throw std::runtime_error("Failed to load OpenGL functions");
+    }
+}
+
+EglContext::~EglContext() {
+    eglMakeCurrent(impl_->display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    eglDestroyContext(impl_->display, impl_->context);
+    eglTerminate(impl_->display);
+}
@@ -0,0 +1,26 @@
+//
+// Created by valdemar on 18.10.26.
+//
+
+#pragma once
+
+#include <memory>
+
+/**
+ * OpenGL 3.3 core context without window or surface, draws to framebuffer objects only.
+ * Prefers Mesa surfaceless platform, so works without display server, e.g. on CI machines.
+ * Context made current and OpenGL functions loaded on construction
+ */
+class EglContext {
+ public:
+    /// @throws std::runtime_error if context cannot be created
+    EglContext();
+    ~EglContext();
+
+    EglContext(const EglContext &) = delete;
+    EglContext &operator=(const EglContext &) = delete;
+
+ private:
+    struct egl_state_t;
+    std::unique_ptr<egl_state_t> impl_;
+};
@@ -0,0 +1,305 @@
+//
+// Created by valdemar on 18.10.26.
+//
+
+#include "HeadlessRender.h"
+#include "EglContext.h"
+#include "PngWriter.h"
+
+#include <cgutils/Camera.h>
+#include <cgutils/ResourceManager.h>
+#include <cgutils/Shader.h>
+#include <cgutils/utils.h>
+#include <common/logger.h>
+#include <net/json_handler/JsonHandler.h>
+#include <viewer/Scene.h>
+#include <viewer/SoftwareRenderer.h>
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+namespace {
+
+constexpr size_t RECORDING_CHUNK_SIZE = 64 * 1024;
+
+const char *USAGE =
+    "Usage: rewindviewer --headless --render <recording> [--out frames/%06d.png] "
+    "[--frames first:last] [--size 1280x720] [--threads N] [--software] [--trace trace.json]";
+
+struct headless_options_t {
+    std::string recording;
+    // Printf pattern, formatted with zero based frame index
+    std::string out_pattern = "frames/%06d.png";
+    int first_frame = 0;
+    // Inclusive, negative means last available
+    int last_frame = -1;
+    glm::ivec2 size{1280, 720};
+    // Encoder threads, zero means hardware concurrency
+    size_t threads = 0;
+    // Draw on CPU even if OpenGL is available
+    bool software = false;
+};
+
+headless_options_t parse_options(int argc, char **argv) {
+    headless_options_t opts;
+    for (int idx = 1; idx < argc; ++idx) {
+        const std::string arg = argv[idx];
+        const auto value = [&]() -> const char * {
+            if (idx + 1 >= argc) {
+                throw std::runtime_error("Missing value for " + arg);
+            }
+            return argv[++idx];
+        };
+
+        if (arg == "--headless") {
+            continue;
+        } else if (arg == "--render") {
+            opts.recording = value();
+        } else if (arg == "--out") {
+            opts.out_pattern = value();
+        } else if (arg == "--frames") {
+            const char *range = value();
+            if (sscanf(range, "%d:%d", &opts.first_frame, &opts.last_frame) != 2 &&
+                sscanf(range, "%d:", &opts.first_frame) != 1) {
+                throw std::runtime_error(std::string("Bad frames range: ") + range);
+            }
+        } else if (arg == "--size") {
+            const char *size = value();
+            if (sscanf(size, "%dx%d", &opts.size.x, &opts.size.y) != 2 || opts.size.x <= 0 ||
+                opts.size.y <= 0) {
+                throw std::runtime_error(std::string("Bad image size: ") + size);
+            }
+        } else if (arg == "--threads") {
+            opts.threads = static_cast<size_t>(std::max(atoi(value()), 0));
+        } else if (arg == "--software") {
+            opts.software = true;
+        } else if (arg == "--trace") {
+            // Handled by main
+            value();
+        } else {
+            throw std::runtime_error("Unknown argument " + arg);
+        }
+    }
+
+    if (opts.recording.empty()) {
+        throw std::runtime_error("Recording is not set");
+    }
+    if (std::count(opts.out_pattern.begin(), opts.out_pattern.end(), '%') != 1) {
+        throw std::runtime_error("Output pattern should contain exactly one format specifier");
+    }
+    if (opts.threads == 0) {
+        opts.threads = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    return opts;
+}
+
+/// Feed recording to protocol handler the same way as network listener does
+void load_recording(const std::string &path, Scene &scene) {
+    FILE *fd = fopen(path.c_str(), "rb");
+    if (!fd) {
+        char err_buf[512];
+        snprintf(err_buf, sizeof(err_buf), "Load file(%s): %s", path.c_str(), strerror(errno));
+        throw std::runtime_error(err_buf);
+    }
+
+    JsonHandler handler(&scene);
+    handler.on_new_connection();
+    std::vector<uint8_t> buf(RECORDING_CHUNK_SIZE);
+    while (size_t sz = fread(buf.data(), 1, buf.size(), fd)) {
+        handler.handle_message(buf.data(), static_cast<uint32_t>(sz));
+    }
+    fclose(fd);
+}
+
+std::string frame_path(const std::string &pattern, int frame_idx) {
+    char buf[1024];
+    snprintf(buf, sizeof(buf), pattern.c_str(), frame_idx);
+    return buf;
+}
+
+/// Clamp requested inclusive range to loaded frames
+void frames_range(const headless_options_t &opts, int frames_cnt, int &first, int &last) {
+    first = std::max(opts.first_frame, 0);
+    last = opts.last_frame < 0 ? frames_cnt - 1 : std::min(opts.last_frame, frames_cnt - 1);
+    LOG_INFO("Recording has %d frames, render [%d, %d] to %s", frames_cnt, first, last,
+             opts.out_pattern.c_str());
+}
+
+int report_result(std::chrono::steady_clock::time_point start, size_t rendered, size_t failed) {
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    LOG_INFO("Rendered %zu frames in %.2fs, %zu failed", rendered, elapsed.count(), failed);
+    return failed == 0 ? 0 : -4;
+}
+
+/// Same output without OpenGL, frames are rasterized on CPU
+int render_frames_software(const headless_options_t &opts, Config &conf) {
+    const auto start = std::chrono::steady_clock::now();
+    size_t rendered = 0;
+    size_t failed = 0;
+    try {
+        // Frames are only rendered, nobody searches them
+        conf.scene.search_index = false;
+        Scene scene(nullptr, &conf.scene);
+        Camera cam(conf.camera, opts.size);
+
+        LOG_INFO("Load recording %s", opts.recording.c_str());
+        load_recording(opts.recording, scene);
+
+        // Frames count updated on render
+        SoftwareRenderer target(opts.size);
+        scene.render_software(target, cam);
+        int first;
+        int last;
+        frames_range(opts, scene.get_frames_count(), first, last);
+
+        PngWriterPool writer(opts.threads, opts.threads * 2);
+        for (int idx = first; idx <= last; ++idx) {
+            scene.set_frame_index(idx);
+            scene.render_software(target, cam);
+            writer.push(frame_path(opts.out_pattern, idx), static_cast<uint32_t>(opts.size.x),
+                        static_cast<uint32_t>(opts.size.y), target.pixels());
+            ++rendered;
+        }
+        failed += writer.finish();
+    } catch (const std::exception &ex) {
+        LOG_ERROR("Software render:: %s", ex.what());
+        return -3;
+    }
+    return report_result(start, rendered, failed);
+}
+
+}  // anonymous namespace
+
+int run_headless(int argc, char **argv, Config &conf) {
+    headless_options_t opts;
+    try {
+        opts = parse_options(argc, argv);
+    } catch (const std::exception &ex) {
+        LOG_ERROR("%s", ex.what());
+        LOG_ERROR("%s", USAGE);
+        return -1;
+    }
+
+    std::unique_ptr<EglContext> context;
+    if (!opts.software) {
+        try {
+            LOG_INFO("Create offscreen OpenGL context");
+            context = std::make_unique<EglContext>();
+        } catch (const std::exception &ex) {
+            LOG_WARN("Cannot create offscreen context: %s", ex.what());
+        }
+    }
+    if (!context) {
+        LOG_INFO("Render frames with software rasterizer");
+        return render_frames_software(opts, conf);
+    }
+    LOG_INFO("OpenGL %s, Renderer %s", glGetString(GL_VERSION), glGetString(GL_RENDERER));
+
+    // Everything below uses GL objects, so should be destroyed before context
+    const auto start = std::chrono::steady_clock::now();
+    size_t rendered = 0;
+    size_t failed = 0;
+    try {
+        ResourceManager res("resources/textures/");
+        Shader::set_shaders_folder("resources/shaders/");
+
+        // No shared window context available, frames are drawn in order anyway
+        conf.scene.prefetch_frames = 0;
+        conf.scene.search_index = false;
+        Scene scene(&res, &conf.scene);
+        Camera cam(conf.camera, opts.size);
+
+        LOG_INFO("Load recording %s", opts.recording.c_str());
+        load_recording(opts.recording, scene);
+
+        // Render target
+        const GLsizei width = opts.size.x;
+        const GLsizei height = opts.size.y;
+        GLuint fbo;
+        GLuint color_rbo;
+        glGenFramebuffers(1, &fbo);
+        glGenRenderbuffers(1, &color_rbo);
+        glBindRenderbuffer(GL_RENDERBUFFER, color_rbo);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER,
+                                  color_rbo);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            throw std::runtime_error("Offscreen framebuffer is incomplete");
+        }
+        glViewport(0, 0, width, height);
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+        // Frames count updated on render
+        scene.update_and_render(cam);
+        int first;
+        int last;
+        frames_range(opts, scene.get_frames_count(), first, last);
+
+        // Read pixels of previous frame while current one is drawn
+        const size_t image_size = static_cast<size_t>(width) * height * 4;
+        GLuint pbo[2];
+        glGenBuffers(2, pbo);
+        for (GLuint buffer : pbo) {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer);
+            glBufferData(GL_PIXEL_PACK_BUFFER, image_size, nullptr, GL_STREAM_READ);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        PngWriterPool writer(opts.threads, opts.threads * 2);
+        const auto flush_pixels = [&](GLuint buffer, int frame_idx) {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer);
+            const auto mapped = static_cast<const uint8_t *>(
+                glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, image_size, GL_MAP_READ_BIT));
+            if (mapped) {
+                std::vector<uint8_t> pixels(mapped, mapped + image_size);
+                writer.push(frame_path(opts.out_pattern, frame_idx), width, height,
+                            std::move(pixels));
+            } else {
+                LOG_ERROR("Cannot map pixels of frame %d", frame_idx);
+                ++failed;
+            }
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        };
+
+        for (int idx = first; idx <= last; ++idx) {
+            scene.set_frame_index(idx);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            scene.update_and_render(cam);
+            glBindVertexArray(0);
+            glUseProgram(0);
+
+            const size_t slot = static_cast<size_t>(idx - first) % 2;
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo[slot]);
+            glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+            if (idx > first) {
+                flush_pixels(pbo[1 - slot], idx - 1);
+            }
+            ++rendered;
+        }
+        if (last >= first) {
+            flush_pixels(pbo[(last - first) % 2], last);
+        }
+        failed += writer.finish();
+
+        glDeleteBuffers(2, pbo);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glDeleteRenderbuffers(1, &color_rbo);
+        glDeleteFramebuffers(1, &fbo);
+        glCheckError();
+    } catch (const std::exception &ex) {
+        LOG_ERROR("Headless render:: %s", ex.what());
+        return -3;
+    }
+    return report_result(start, rendered, failed);
+}
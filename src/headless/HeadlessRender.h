@@ -0,0 +1,19 @@
+//
+// Created by valdemar on 18.10.26.
+//
+
+#pragma once
+
+#include <viewer/Config.h>
+
+/**
+ * Render recorded game to image sequence without any window.
+ * Recording is raw data stream as sent by strategy to viewer.
+ * Command line:
+ *   --headless --render <recording> [--out frames/%06d.png] [--frames first:last]
+ *   [--size 1280x720] [--threads N] [--software]
+ * Frame range is inclusive and zero based, so several processes may render parts of one game.
+ * Frames are rasterized on CPU if offscreen OpenGL context cannot be created or --software set.
+ * @return process exit code
+ */
+int run_headless(int argc, char **argv, Config &conf);
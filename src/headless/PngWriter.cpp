@@ -0,0 +1,171 @@
+//
+// Created by valdemar on 18.10.26.
+//
+
+#include "PngWriter.h"
+
+#include <common/logger.h>
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+
+void put_u32(std::vector<uint8_t> &to, uint32_t value) {
+    to.push_back(static_cast<uint8_t>(value >> 24));
+    to.push_back(static_cast<uint8_t>(value >> 16));
+    to.push_back(static_cast<uint8_t>(value >> 8));
+    to.push_back(static_cast<uint8_t>(value));
+}
+
+void put_chunk(std::vector<uint8_t> &to, const char *type, const uint8_t *data, size_t size) {
+    put_u32(to, static_cast<uint32_t>(size));
+    const size_t type_pos = to.size();
+    to.insert(to.end(), type, type + 4);
+    to.insert(to.end(), data, data + size);
+    // Crc covers type and data
+    const auto crc = crc32(0, &to[type_pos], static_cast<uInt>(size + 4));
+    put_u32(to, static_cast<uint32_t>(crc));
+}
+
+}  // anonymous namespace
+
+void write_png(const std::string &path, uint32_t width, uint32_t height, const uint8_t *pixels) {
+    // Each row prefixed with filter type, 'Up' filter works well for flat colored pictures
+    constexpr uint8_t FILTER_UP = 2;
+    const size_t stride = static_cast<size_t>(width) * 4;
+    std::vector<uint8_t> filtered((stride + 1) * height);
+    for (uint32_t row = 0; row < height; ++row) {
+        // Flip vertically, OpenGL rows go from bottom to top
+        const uint8_t *cur = pixels + (height - 1 - row) * stride;
+        const uint8_t *prev = row > 0 ? cur + stride : nullptr;
+        uint8_t *out = &filtered[row * (stride + 1)];
+        *out++ = FILTER_UP;
+        for (size_t i = 0; i < stride; ++i) {
+            out[i] = static_cast<uint8_t>(cur[i] - (prev ? prev[i] : 0));
+        }
+    }
+
+    uLongf compressed_size = compressBound(static_cast<uLong>(filtered.size()));
+    std::vector<uint8_t> compressed(compressed_size);
+    if (compress2(compressed.data(), &compressed_size, filtered.data(),
+                  static_cast<uLong>(filtered.size()), Z_BEST_SPEED) != Z_OK) {
+        throw std::runtime_error("Cannot compress image " + path);
+    }
+
+    static const uint8_t SIGNATURE[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    std::vector<uint8_t> png(std::begin(SIGNATURE), std::end(SIGNATURE));
+    std::vector<uint8_t> header;
+    put_u32(header, width);
+    put_u32(header, height);
+    // 8 bit depth, RGBA color, deflate compression, adaptive filtering, no interlace
+    header.insert(header.end(), {8, 6, 0, 0, 0});
+    put_chunk(png, "IHDR", header.data(), header.size());
+    put_chunk(png, "IDAT", compressed.data(), compressed_size);
+    put_chunk(png, "IEND", nullptr, 0);
+
+    FILE *fd = fopen(path.c_str(), "wb");
+    if (!fd) {
+        char err_buf[512];
+        snprintf(err_buf, sizeof(err_buf), "Write file(%s): %s", path.c_str(), strerror(errno));
+        throw std::runtime_error(err_buf);
+    }
+    const size_t written = fwrite(png.data(), 1, png.size(), fd);
+    fclose(fd);
+    if (written != png.size()) {
+        throw std::runtime_error("Write file(" + path + "): incomplete write");
+    }
+}
+
+struct PngWriterPool::pool_state_t {
+    struct image_t {
+        std::string path;
+        uint32_t width;
+        uint32_t height;
+        std::vector<uint8_t> pixels;
+    };
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<image_t> queue;
+    size_t max_queued;
+    // Images taken by workers but not written yet
+    size_t in_progress = 0;
+    size_t failed = 0;
+    bool stop = false;
+
+    std::vector<std::thread> workers;
+};
+
+PngWriterPool::PngWriterPool(size_t threads, size_t max_queued) {
+    state_ = std::make_unique<pool_state_t>();
+    state_->max_queued = std::max<size_t>(max_queued, 1);
+    for (size_t idx = 0; idx < std::max<size_t>(threads, 1); ++idx) {
+        state_->workers.emplace_back([this] { worker_loop(); });
+    }
+}
+
+PngWriterPool::~PngWriterPool() {
+    finish();
+    {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        state_->stop = true;
+    }
+    state_->cv.notify_all();
+    for (auto &worker : state_->workers) {
+        worker.join();
+    }
+}
+
+void PngWriterPool::push(std::string path, uint32_t width, uint32_t height,
+                         std::vector<uint8_t> pixels) {
+    std::unique_lock<std::mutex> lock(state_->mutex);
+    state_->cv.wait(lock, [this] { return state_->queue.size() < state_->max_queued; });
+    state_->queue.push_back({std::move(path), width, height, std::move(pixels)});
+    lock.unlock();
+    state_->cv.notify_all();
+}
+
+size_t PngWriterPool::finish() {
+    std::unique_lock<std::mutex> lock(state_->mutex);
+    state_->cv.wait(lock, [this] { return state_->queue.empty() && state_->in_progress == 0; });
+    return state_->failed;
+}
+
+void PngWriterPool::worker_loop() {
+    std::unique_lock<std::mutex> lock(state_->mutex);
+    while (true) {
+        state_->cv.wait(lock, [this] { return state_->stop || !state_->queue.empty(); });
+        if (state_->queue.empty()) {
+            // Stop requested and nothing left
+            return;
+        }
+        auto image = std::move(state_->queue.front());
+        state_->queue.pop_front();
+        ++state_->in_progress;
+        lock.unlock();
+        // Queue has free place now
+        state_->cv.notify_all();
+
+        bool ok = true;
+        try {
+            write_png(image.path, image.width, image.height, image.pixels.data());
+        } catch (const std::exception &ex) {
+            LOG_ERROR("PngWriter:: %s", ex.what());
+            ok = false;
+        }
+
+        lock.lock();
+        --state_->in_progress;
+        state_->failed += !ok;
+        state_->cv.notify_all();
+    }
+}
@@ -0,0 +1,40 @@
+//
+// Created by valdemar on 18.10.26.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * Write RGBA image as PNG file
+ * @param pixels - width * height * 4 bytes, rows from bottom to top as read by glReadPixels
+ * @throws std::runtime_error if file cannot be written
+ */
+void write_png(const std::string &path, uint32_t width, uint32_t height, const uint8_t *pixels);
+
+/**
+ * Encodes images on several threads, so rendering is not blocked by compression
+ */
+class PngWriterPool {
+ public:
+    /// @param max_queued - push() blocks while that many images wait for encoding
+    PngWriterPool(size_t threads, size_t max_queued);
+    /// Waits until every queued image written
+    ~PngWriterPool();
+
+    void push(std::string path, uint32_t width, uint32_t height, std::vector<uint8_t> pixels);
+
+    /// Wait until every queued image written
+    /// @return number of images failed to write
+    size_t finish();
+
+ private:
+    void worker_loop();
+
+    struct pool_state_t;
+    std::unique_ptr<pool_state_t> state_;
+};
@@ -0,0 +1,361 @@
+//
+// Created by valdemar on 18.10.26.
+//
+
+#include "LoadGenerator.h"
+
+#include <common/logger.h>
+
+#include <csimplesocket/ActiveSocket.h>
+#include <json.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+constexpr float WORLD_SIZE = 1024.0f;
+/// Acks still on the way after last tick are awaited that long
+constexpr auto ACK_WAIT_TIMEOUT = std::chrono::seconds(5);
+
+const char *KIND_NAMES[LoadGenerator::KINDS_COUNT] = {"circle", "rectangle", "triangle",
+                                                      "polyline", "popup"};
+
+const uint32_t COLORS[] = {0xFFE53935, 0xFF1E88E5, 0xFF43A047, 0xFFFDD835, 0x80757575};
+
+template <typename... Args>
+void append(std::string &out, const char *fmt, Args... args) {
+    char buf[512];
+    const int len = snprintf(buf, sizeof(buf), fmt, args...);
+    out.append(buf, static_cast<size_t>(std::min<int>(len, sizeof(buf) - 1)));
+}
+
+/// Part of total which falls to idx-th of parts with given weights, parts sum exactly to total
+size_t share(size_t total, const size_t *weights, size_t count, size_t idx) {
+    const size_t sum = std::accumulate(weights, weights + count, size_t{0});
+    if (sum == 0) {
+        return 0;
+    }
+    const size_t before = std::accumulate(weights, weights + idx, size_t{0});
+    return total * (before + weights[idx]) / sum - total * before / sum;
+}
+
+std::array<size_t, LoadGenerator::KINDS_COUNT> parse_mix(const std::string &str) {
+    std::array<size_t, LoadGenerator::KINDS_COUNT> mix{};
+    size_t pos = 0;
+    while (pos < str.size()) {
+        size_t next = str.find(',', pos);
+        if (next == std::string::npos) {
+            next = str.size();
+        }
+        const std::string item = str.substr(pos, next - pos);
+        const size_t eq = item.find('=');
+        const auto it = std::find(std::begin(KIND_NAMES), std::end(KIND_NAMES), item.substr(0, eq));
+        if (eq == std::string::npos || it == std::end(KIND_NAMES)) {
+            throw std::runtime_error("Bad mix item '" + item +
+                                     "', should be kind=weight, where kind is one of circle, "
+                                     "rectangle, triangle, polyline, popup");
+        }
+        mix[it - std::begin(KIND_NAMES)] = static_cast<size_t>(atoll(item.c_str() + eq + 1));
+        pos = next + 1;
+    }
+    return mix;
+}
+
+double percentile(const std::vector<double> &sorted, double p) {
+    const auto idx = static_cast<size_t>(p * static_cast<double>(sorted.size() - 1) + 0.5);
+    return sorted[idx];
+}
+
+}  // anonymous namespace
+
+const char *LoadGenerator::usage() {
+    return "Usage: rewind-loadgen [--host 127.0.0.1] [--port 9111] [--ticks 1000] [--rate 60] "
+           "[--primitives 1000] [--mix circle=10,rectangle=2,triangle=1,polyline=3,popup=4] "
+           "[--points 12] [--layers 3] [--messages 5] [--message-size 64] [--ack-every 1] "
+           "[--seed 42]";
+}
+
+LoadGenerator::options_t LoadGenerator::parse_options(int argc, char **argv) {
+    options_t opts;
+    for (int idx = 1; idx < argc; ++idx) {
+        const std::string arg = argv[idx];
+        const auto value = [&]() -> const char * {
+            if (idx + 1 >= argc) {
+                throw std::runtime_error("Missing value for " + arg);
+            }
+            return argv[++idx];
+        };
+        const auto count = [&]() { return static_cast<size_t>(std::max(atoll(value()), 0LL)); };
+
+        if (arg == "--host") {
+            opts.host = value();
+        } else if (arg == "--port") {
+            opts.port = static_cast<uint16_t>(atoi(value()));
+        } else if (arg == "--ticks") {
+            opts.ticks = count();
+        } else if (arg == "--rate") {
+            opts.tick_rate = std::max(atof(value()), 0.0);
+        } else if (arg == "--primitives") {
+            opts.primitives = count();
+        } else if (arg == "--mix") {
+            opts.mix = parse_mix(value());
+        } else if (arg == "--points") {
+            opts.polyline_points = count();
+        } else if (arg == "--layers") {
+            opts.layers = count();
+        } else if (arg == "--messages") {
+            opts.messages = count();
+        } else if (arg == "--message-size") {
+            opts.message_size = count();
+        } else if (arg == "--ack-every") {
+            opts.ack_every = count();
+        } else if (arg == "--seed") {
+            opts.seed = static_cast<uint32_t>(atoll(value()));
+        } else {
+            throw std::runtime_error("Unknown argument " + arg);
+        }
+    }
+
+    if (opts.ticks == 0) {
+        throw std::runtime_error("Ticks count should be positive");
+    }
+    // Layers are numbered from one in protocol, last one is 10
+    if (opts.layers < 1 || opts.layers > 10) {
+        throw std::runtime_error("Layers should be in range 1-10");
+    }
+    if (opts.polyline_points < 2) {
+        throw std::runtime_error("Polyline needs at least 2 points");
+    }
+    return opts;
+}
+
+LoadGenerator::LoadGenerator(const options_t &opts) : opts_(opts) {
+    for (size_t kind = 0; kind < KINDS_COUNT; ++kind) {
+        counts_[kind] = share(opts_.primitives, opts_.mix.data(), KINDS_COUNT, kind);
+    }
+    // Generated beforehand, so formatting cost doesn't limit send rate
+    const size_t distinct = std::min(opts_.distinct_ticks, opts_.ticks);
+    for (size_t i = 0; i < distinct; ++i) {
+        ticks_.push_back(make_tick(opts_.seed + static_cast<uint32_t>(i)));
+    }
+}
+
+std::string LoadGenerator::make_tick(uint32_t seed) const {
+    std::mt19937 rng{seed};
+    std::uniform_real_distribution<double> coord{0.0, WORLD_SIZE};
+    std::uniform_real_distribution<double> offset{-20.0, 20.0};
+    std::uniform_real_distribution<double> size{2.0, 32.0};
+    std::uniform_int_distribution<size_t> color_idx{0, sizeof(COLORS) / sizeof(COLORS[0]) - 1};
+    std::uniform_int_distribution<int> fill{0, 1};
+    const auto color = [&] { return COLORS[color_idx(rng)]; };
+    const auto boolean = [&] { return fill(rng) ? "true" : "false"; };
+
+    std::string out;
+    const std::vector<size_t> layer_weights(opts_.layers, 1);
+    for (size_t layer = 0; layer < opts_.layers; ++layer) {
+        append(out, R"({"type": "options", "layer": %zu})", layer + 1);
+        for (size_t kind = 0; kind < KINDS_COUNT; ++kind) {
+            const size_t count = share(counts_[kind], layer_weights.data(), opts_.layers, layer);
+            for (size_t i = 0; i < count; ++i) {
+                const double x = coord(rng);
+                const double y = coord(rng);
+                switch (kind) {
+                    case CIRCLE:
+                        append(out,
+                               R"({"type": "circle", "p": [%lf, %lf], "r": %lf, "color": %u, )"
+                               R"("fill": %s})",
+                               x, y, size(rng) * 0.5, color(), boolean());
+                        break;
+                    case RECTANGLE:
+                        append(out,
+                               R"({"type": "rectangle", "tl": [%lf, %lf], "br": [%lf, %lf], )"
+                               R"("color": %u, "fill": %s})",
+                               x, y, x + size(rng), y + size(rng), color(), boolean());
+                        break;
+                    case TRIANGLE:
+                        append(out,
+                               R"({"type": "triangle", "points": [%lf, %lf, %lf, %lf, %lf, )"
+                               R"(%lf], "color": %u, "fill": %s})",
+                               x, y, x + offset(rng), y + offset(rng), x + offset(rng),
+                               y + offset(rng), color(), boolean());
+                        break;
+                    case POLYLINE: {
+                        // Random walk, like planned path
+                        double px = x;
+                        double py = y;
+                        append(out, R"({"type": "polyline", "points": [%lf,%lf)", px, py);
+                        for (size_t pt = 1; pt < opts_.polyline_points; ++pt) {
+                            px += offset(rng);
+                            py += offset(rng);
+                            append(out, ",%lf,%lf", px, py);
+                        }
+                        append(out, R"(], "color": %u})", color());
+                        break;
+                    }
+                    case POPUP:
+                        append(out,
+                               R"({"type": "popup", "p": [%lf, %lf], "r": %lf, )"
+                               R"("text": "Unit %zu\nhp %d/100"})",
+                               x, y, size(rng) * 0.5, i, fill(rng) ? 100 : 42);
+                        break;
+                    default: break;
+                }
+            }
+        }
+    }
+
+    std::string text;
+    for (size_t i = 0; i < opts_.message_size; ++i) {
+        text += static_cast<char>('a' + i % 26);
+    }
+    for (size_t i = 0; i < opts_.messages; ++i) {
+        out += R"({"type": "message", "message": ")" + text + "\"}";
+    }
+    return out;
+}
+
+bool LoadGenerator::run() {
+    CActiveSocket socket;
+    if (!socket.Initialize()) {
+        LOG_ERROR("LoadGenerator:: Cannot initialize socket: %d", errno);
+        return false;
+    }
+    socket.DisableNagleAlgoritm();
+    if (!socket.Open(reinterpret_cast<const uint8_t *>(opts_.host.c_str()),
+                     static_cast<int16_t>(opts_.port))) {
+        LOG_ERROR("LoadGenerator:: Cannot connect to %s:%u: %d", opts_.host.c_str(), opts_.port,
+                  errno);
+        return false;
+    }
+    LOG_INFO("Connected to %s:%u, %zu primitives and %zu messages per tick, tick payload %zu bytes",
+             opts_.host.c_str(), opts_.port, opts_.primitives, opts_.messages, ticks_[0].size());
+
+    // Send time of each tick, written before send and read by ack receiver
+    std::unique_ptr<std::atomic<int64_t>[]> sent_at(new std::atomic<int64_t>[opts_.ticks]());
+    std::atomic<size_t> acks_received{0};
+    std::vector<double> latencies_ms;
+    const auto now_ns = [] {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   clock_type::now().time_since_epoch())
+            .count();
+    };
+
+    // Plain recv on descriptor, socket object itself is used by sending thread
+    std::thread ack_receiver([&, fd = socket.GetSocketDescriptor()] {
+        std::string pending;
+        char buf[1024];
+        while (true) {
+            const auto nbytes = ::recv(fd, buf, sizeof(buf), 0);
+            if (nbytes <= 0) {
+                break;
+            }
+            const int64_t received_at = now_ns();
+            pending.append(buf, static_cast<size_t>(nbytes));
+            size_t eol;
+            while ((eol = pending.find('\n')) != std::string::npos) {
+                try {
+                    const auto j = nlohmann::json::parse(pending.begin(), pending.begin() + eol);
+                    const auto tick = j.at("ack").get<size_t>();
+                    if (tick < opts_.ticks) {
+                        const auto ns = received_at - sent_at[tick].load();
+                        latencies_ms.push_back(static_cast<double>(ns) * 1e-6);
+                        ++acks_received;
+                    }
+                } catch (const std::exception &ex) {
+                    LOG_WARN("LoadGenerator:: Bad reply from viewer: %s", ex.what());
+                }
+                pending.erase(0, eol + 1);
+            }
+        }
+    });
+
+    const auto start = clock_type::now();
+    const auto period = opts_.tick_rate > 0.0
+                            ? std::chrono::duration_cast<clock_type::duration>(
+                                  std::chrono::duration<double>(1.0 / opts_.tick_rate))
+                            : clock_type::duration::zero();
+    std::string payload;
+    size_t acks_requested = 0;
+    size_t sent_ticks = 0;
+    size_t sent_bytes = 0;
+    for (; sent_ticks < opts_.ticks; ++sent_ticks) {
+        if (opts_.tick_rate > 0.0) {
+            // No catch up sleep, falling behind shows in achieved rate
+            std::this_thread::sleep_until(start + period * static_cast<int64_t>(sent_ticks));
+        }
+        payload = ticks_[sent_ticks % ticks_.size()];
+        if (opts_.ack_every > 0 && sent_ticks % opts_.ack_every == 0) {
+            append(payload, R"({"type": "end", "ack": %zu})", sent_ticks);
+            ++acks_requested;
+        } else {
+            payload += R"({"type": "end"})";
+        }
+
+        // Includes time blocked on full socket, viewer not keeping up is part of latency
+        sent_at[sent_ticks] = now_ns();
+        size_t offset = 0;
+        while (offset < payload.size()) {
+            const int32_t nbytes =
+                socket.Send(reinterpret_cast<const uint8_t *>(payload.data()) + offset,
+                            payload.size() - offset);
+            if (nbytes <= 0) {
+                break;
+            }
+            offset += static_cast<size_t>(nbytes);
+        }
+        sent_bytes += offset;
+        if (offset < payload.size()) {
+            LOG_ERROR("LoadGenerator:: Connection lost after %zu ticks: %d", sent_ticks, errno);
+            break;
+        }
+    }
+    const std::chrono::duration<double> elapsed = clock_type::now() - start;
+
+    const auto ack_deadline = clock_type::now() + ACK_WAIT_TIMEOUT;
+    while (acks_received < acks_requested && clock_type::now() < ack_deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    socket.Shutdown(CSimpleSocket::Both);
+    ack_receiver.join();
+    socket.Close();
+
+    const double seconds = std::max(elapsed.count(), 1e-9);
+    char target[32] = "flat out";
+    if (opts_.tick_rate > 0.0) {
+        snprintf(target, sizeof(target), "%.1f", opts_.tick_rate);
+    }
+    LOG_INFO("Sent %zu ticks in %.2fs: %.1f ticks/s (target %s), %.0f primitives/s, %.2f MB/s",
+             sent_ticks, seconds, sent_ticks / seconds, target,
+             sent_ticks * opts_.primitives / seconds, sent_bytes / seconds / (1024.0 * 1024.0));
+    for (size_t kind = 0; kind < KINDS_COUNT; ++kind) {
+        LOG_INFO("  %-9s %zu per tick", KIND_NAMES[kind], counts_[kind]);
+    }
+
+    if (acks_requested == 0) {
+        return sent_ticks == opts_.ticks;
+    }
+    if (latencies_ms.empty()) {
+        LOG_WARN("No acks received, viewer is probably older than ack support");
+        return sent_ticks == opts_.ticks;
+    }
+    std::sort(latencies_ms.begin(), latencies_ms.end());
+    LOG_INFO("Ack latency over %zu frames: p50 %.2fms, p95 %.2fms, p99 %.2fms, max %.2fms",
+             latencies_ms.size(), percentile(latencies_ms, 0.5), percentile(latencies_ms, 0.95),
+             percentile(latencies_ms, 0.99), latencies_ms.back());
+    if (latencies_ms.size() < acks_requested) {
+        LOG_WARN("%zu acks missing", acks_requested - latencies_ms.size());
+    }
+    return sent_ticks == opts_.ticks;
+}
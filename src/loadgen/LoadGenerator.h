@@ -0,0 +1,61 @@
+//
+// Created by valdemar on 18.10.26.
+//
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Synthetic strategy to stress the viewer repeatably, without running real bots.
+ * Connects the same way as bundled clients do and sends configured primitive mix each tick,
+ * either at target tick rate or as fast as socket accepts. Every frame end asks viewer for
+ * acknowledgement, so latency between sent frame and frame added to scene is measured too.
+ */
+class LoadGenerator {
+ public:
+    enum Kind { CIRCLE, RECTANGLE, TRIANGLE, POLYLINE, POPUP, KINDS_COUNT };
+
+    struct options_t {
+        std::string host = "127.0.0.1";
+        uint16_t port = 9111;
+        size_t ticks = 1000;
+        /// Ticks per second, zero means flat out
+        double tick_rate = 60.0;
+        /// Primitives per tick, split between kinds proportionally to mix
+        size_t primitives = 1000;
+        std::array<size_t, KINDS_COUNT> mix{{10, 2, 1, 3, 4}};
+        size_t polyline_points = 12;
+        /// Primitives spread evenly over layers starting from first
+        size_t layers = 3;
+        size_t messages = 5;
+        size_t message_size = 64;
+        /// Ask acknowledgement every N ticks, zero disables latency measurement
+        size_t ack_every = 1;
+        /// Distinct ticks generated beforehand and sent in a loop
+        size_t distinct_ticks = 16;
+        uint32_t seed = 42;
+    };
+
+    /// Parse command line, throws std::runtime_error on bad arguments
+    static options_t parse_options(int argc, char **argv);
+
+    static const char *usage();
+
+    explicit LoadGenerator(const options_t &opts);
+
+    /// Connect, send all ticks, wait for outstanding acks and log report
+    /// @return false if viewer is unreachable or connection lost
+    bool run();
+
+ private:
+    std::string make_tick(uint32_t seed) const;
+
+    options_t opts_;
+    std::vector<std::string> ticks_;
+    /// Per tick count of each primitive kind
+    std::array<size_t, KINDS_COUNT> counts_;
+};
@@ -0,0 +1,31 @@
+//
+// Created by valdemar on 18.10.26.
+//
+
+#include "LoadGenerator.h"
+
+#include <common/logger.h>
+
+#include <csignal>
+#include <exception>
+
+int main(int argc, char **argv) {
+    loguru::g_stderr_verbosity = loguru::Verbosity_INFO;
+    loguru::init(argc, argv);
+#ifndef _WIN32
+    // Viewer closing connection should end up in send error, not kill the process
+    signal(SIGPIPE, SIG_IGN);
+#endif
+
+    LoadGenerator::options_t opts;
+    try {
+        opts = LoadGenerator::parse_options(argc, argv);
+    } catch (const std::exception &ex) {
+        LOG_ERROR("%s", ex.what());
+        LOG_ERROR("%s", LoadGenerator::usage());
+        return -1;
+    }
+
+    LoadGenerator generator(opts);
+    return generator.run() ? 0 : -2;
+}
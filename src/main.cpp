@@ -4,6 +4,8 @@
 
 #include <cgutils/ResourceManager.h>
 #include <cgutils/Shader.h>
+#include <common/Profiler.h>
+#include <common/TraceWriter.h>
 #include <common/logger.h>
 #include <net/json_handler/JsonHandler.h>
 #include <viewer/Config.h>
@@ -11,6 +13,12 @@
 
 #include <stb_image.h>
 
+#ifdef REWIND_HEADLESS
+#include <headless/HeadlessRender.h>
+#endif
+
+#include <algorithm>
+#include <cstring>
 #include <exception>
 #include <thread>
 
@@ -19,10 +27,24 @@ constexpr size_t DEFAULT_WIN_HEIGHT = 800;
 
 constexpr const char *WINDOW_TITLE = "Rewind viewer for Russian AI Cup";
 constexpr const char *CONF_FILENAME = "rewindviewer.ini";
+constexpr const char *SHADER_CACHE_DIR = "shader_cache/";
 
 static const char *NETWORK_HOST = "127.0.0.1";
 static const uint16_t NETWORK_PORT = 9111;
 
+/// Safety net wakeup period while nothing changes, to catch up missed state changes
+constexpr double IDLE_WAIT_TIMEOUT_SEC = 0.5;
+/// ImGui needs couple of frames after input to settle down hovered items and popups
+constexpr int REDRAW_FRAMES_AFTER_INPUT = 3;
+
+/// Frames left to draw after last input event
+/// @note Accessed only from main thread
+static int redraw_frames_left = REDRAW_FRAMES_AFTER_INPUT;
+
+void request_redraw() {
+    redraw_frames_left = REDRAW_FRAMES_AFTER_INPUT;
+}
+
 GLFWwindow *setup_window();
 void prepare_and_run_game_loop(GLFWwindow *window);
 
@@ -30,6 +52,34 @@ int main(int argc, char **argv) {
     loguru::g_stderr_verbosity = loguru::Verbosity_INFO;
     loguru::init(argc, argv);
     loguru::add_file("rewindviewer.log", loguru::Truncate, loguru::g_stderr_verbosity);
+    Profiler::set_thread_name("render");
+
+    // Recorded until exit from main
+    std::unique_ptr<TraceWriter> trace;
+    for (int idx = 1; idx + 1 < argc; ++idx) {
+        if (strcmp(argv[idx], "--trace") == 0) {
+            try {
+                trace = std::make_unique<TraceWriter>(argv[idx + 1]);
+            } catch (const std::exception &ex) {
+                LOG_ERROR("%s", ex.what());
+                return -5;
+            }
+        }
+    }
+
+    for (int idx = 1; idx < argc; ++idx) {
+        if (strcmp(argv[idx], "--headless") == 0) {
+#ifdef REWIND_HEADLESS
+            auto conf = Config::init_with_imgui(CONF_FILENAME);
+            // Read only, window settings of interactive viewer should stay untouched
+            ImGui::GetIO().IniFilename = nullptr;
+            return run_headless(argc, argv, *conf);
+#else
+            LOG_ERROR("Viewer built without headless rendering support, EGL and zlib required");
+            return -4;
+#endif
+        }
+    }
 
     // Init GLFW
     LOG_INFO("Init GLFW");
@@ -116,8 +166,19 @@ GLFWwindow *setup_window() {
     glfwSetWindowIcon(window, 1, &icon);
 
     glfwMakeContextCurrent(window);
-    glfwSetFramebufferSizeCallback(
-        window, [](GLFWwindow *, int width, int height) { glViewport(0, 0, width, height); });
+    glfwSetFramebufferSizeCallback(window, [](GLFWwindow *, int width, int height) {
+        glViewport(0, 0, width, height);
+        request_redraw();
+    });
+
+    // Any input should trigger redraw. Installed before ImGui, it will chain these callbacks
+    glfwSetKeyCallback(window, [](GLFWwindow *, int, int, int, int) { request_redraw(); });
+    glfwSetCharCallback(window, [](GLFWwindow *, unsigned int) { request_redraw(); });
+    glfwSetMouseButtonCallback(window, [](GLFWwindow *, int, int, int) { request_redraw(); });
+    glfwSetScrollCallback(window, [](GLFWwindow *, double, double) { request_redraw(); });
+    glfwSetCursorPosCallback(window, [](GLFWwindow *, double, double) { request_redraw(); });
+    glfwSetWindowFocusCallback(window, [](GLFWwindow *, int) { request_redraw(); });
+    glfwSetWindowRefreshCallback(window, [](GLFWwindow *) { request_redraw(); });
 
     return window;
 }
@@ -134,9 +195,12 @@ void prepare_and_run_game_loop(GLFWwindow *window) {
     LOG_INFO("Create Resource manager");
     ResourceManager res("resources/textures/");
     Shader::set_shaders_folder("resources/shaders/");
+    Shader::set_cache_folder(SHADER_CACHE_DIR);
 
     LOG_INFO("Create Scene");
     Scene scene(&res, &conf.scene);
+    // Wake up render loop waiting for events, safe to call from any thread
+    scene.set_data_changed_callback([] { glfwPostEmptyEvent(); });
 
     LOG_INFO("Create GUI controller");
     UIController ui(&cam, &conf);
@@ -154,6 +218,7 @@ void prepare_and_run_game_loop(GLFWwindow *window) {
     LOG_INFO("Start networking thread");
     NetListener net(NETWORK_HOST, NETWORK_PORT, std::move(proto_handler));
     std::thread network_thread([&net] {
+        Profiler::set_thread_name("network");
         try {
             net.run();
         } catch (const std::exception &ex) {
@@ -165,23 +230,34 @@ void prepare_and_run_game_loop(GLFWwindow *window) {
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     LOG_INFO("Start render loop");
-    while (!glfwWindowShouldClose(window)) {
-        // Read window events
-        glfwPollEvents();
-
+    auto last_net_status = net.connection_status();
+    auto should_draw = [&] {
         if (!conf.ui.update_unfocused && !glfwGetWindowAttrib(window, GLFW_FOCUSED)) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
-            continue;
+            return false;
         }
-
-        // Swap buffers
-        glfwSwapBuffers(window);
+        return redraw_frames_left > 0 || ui.wants_redraw() || scene.needs_redraw() ||
+               net.connection_status() != last_net_status;
+    };
+    while (!glfwWindowShouldClose(window)) {
+        // Read window events, sleep until something happens if nothing to redraw
+        if (should_draw()) {
+            glfwPollEvents();
+        } else {
+            glfwWaitEventsTimeout(IDLE_WAIT_TIMEOUT_SEC);
+            if (!should_draw()) {
+                continue;
+            }
+        }
+        redraw_frames_left = std::max(redraw_frames_left - 1, 0);
+        last_net_status = net.connection_status();
 
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
         // Updates
-        ui.next_frame(&scene, net.connection_status());
-        cam.update();
+        ui.next_frame(&scene, last_net_status);
+        if (cam.update()) {
+            request_redraw();
+        }
 
         if (ui.close_requested()) {
             glfwSetWindowShouldClose(window, true);
@@ -199,6 +275,12 @@ void prepare_and_run_game_loop(GLFWwindow *window) {
 
         // Render UI
         ui.frame_end();
+
+        // Swap buffers
+        {
+            Profiler::Scope swap{Profiler::SWAP};
+            glfwSwapBuffers(window);
+        }
     }
 
     net.stop();
@@ -1,6 +1,7 @@
 #include "NetListener.h"
 #include "ProtoHandler.h"
 
+#include <common/Profiler.h>
 #include <common/logger.h>
 #include <net/PrimitiveType.h>
 
@@ -67,17 +68,25 @@ void NetListener::stop() {
 }
 
 void NetListener::serve_connection(CActiveSocket *client) {
+    handler_->set_reply_callback([client](const std::string &msg) {
+        if (client->Send(reinterpret_cast<const uint8_t *>(msg.data()), msg.size()) < 0) {
+            LOG_WARN("NetListener:: Cannot send reply: %d", errno);
+        }
+    });
     while (!stop_) {
-        const int32_t nbytes = client->Receive(1024);
+        int32_t nbytes;
+        {
+            Profiler::Scope receive{Profiler::RECEIVE};
+            nbytes = client->Receive(1024);
+            receive.set_arg(nbytes);
+        }
         if (stop_) {
             break;
         }
         if (nbytes > 0) {
             auto data = client->GetData();
-            // todo: Maybe remove that zero, because it doesn't make sense in case of binary data
-            //  same for debug print
-            data[nbytes] = '\0';
-            LOG_V9("NetClient:: Message %d bytes, '%s'", nbytes, data);
+            // Buffer is exactly the requested size, so data is not null terminated when full
+            LOG_V9("NetClient:: Message %d bytes, '%.*s'", nbytes, nbytes, data);
             handler_->set_immediate_mode(immediate_mode_.load());
             // Strategy can send several messages in one block
             handler_->handle_message(data, static_cast<uint32_t>(nbytes));
@@ -87,4 +96,5 @@ void NetListener::serve_connection(CActiveSocket *client) {
             break;
         }
     }
+    handler_->set_reply_callback(nullptr);
 }
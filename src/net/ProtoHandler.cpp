@@ -1,11 +1,12 @@
 #include "ProtoHandler.h"
 
+#include <common/Profiler.h>
 #include <common/logger.h>
 
-ProtoHandler::ProtoHandler(Scene *scene) : scene_(scene) {}
+ProtoHandler::ProtoHandler(FrameSink *sink) : sink_(sink) {}
 
 void ProtoHandler::on_new_connection() {
-    scene_->clear_data();
+    sink_->clear_data();
     reset_state();
 }
 
@@ -13,21 +14,26 @@ void ProtoHandler::set_immediate_mode(bool enabled) {
     send_mode_ = enabled ? Mode::IMMEDIATE : Mode::BATCH;
 }
 
+void ProtoHandler::set_reply_callback(reply_fn_t reply) {
+    reply_ = std::move(reply);
+}
+
 void ProtoHandler::on_message_processed(bool end_frame) {
     if (send_mode_ == Mode::BATCH && !end_frame) {
         return;
     }
+    Profiler::Scope commit{Profiler::COMMIT};
 
     if (immediate_data_sent_) {
         // Update last frame, because something already sent to it
-        scene_->add_frame_data(*frame_);
+        sink_->add_frame_data(*frame_, end_frame);
     } else {
         // Add new frame, nothing was appended to last one
-        scene_->add_frame(std::move(frame_));
+        sink_->add_frame(std::move(frame_));
         frame_ = nullptr;
     }
     immediate_data_sent_ = !end_frame;
-    scene_->add_permanent_frame_data(permanent_frame_);
+    sink_->add_permanent_frame_data(permanent_frame_);
 
     if (end_frame) {
         reset_state();
@@ -68,3 +74,9 @@ void ProtoHandler::set_layer(size_t layer) {
     frame_->set_layer_id(last_layer_id_);
     permanent_frame_.set_layer_id(last_layer_id_);
 }
+
+void ProtoHandler::reply(const std::string &msg) {
+    if (reply_) {
+        reply_(msg);
+    }
+}
@@ -5,7 +5,10 @@
 #pragma once
 
 #include <viewer/FrameEditor.h>
-#include <viewer/Scene.h>
+#include <viewer/FrameSink.h>
+
+#include <functional>
+#include <string>
 
 class ProtoHandler {
  public:
@@ -14,7 +17,11 @@ class ProtoHandler {
         IMMEDIATE  /// Send primitives as soon as they come
     };
 
-    explicit ProtoHandler(Scene *scene);
+    /// Writes data back to connected strategy
+    using reply_fn_t = std::function<void(const std::string &)>;
+
+    /// @param sink - receives decoded frames, usually scene
+    explicit ProtoHandler(FrameSink *sink);
     virtual ~ProtoHandler() = default;
 
     /// Called whenever data from socket should be processed
@@ -26,6 +33,9 @@ class ProtoHandler {
 
     void set_immediate_mode(bool enabled);
 
+    /// Set by network listener while connection alive, replies are dropped without it
+    void set_reply_callback(reply_fn_t reply);
+
  protected:
     /// Should be called by specific handler after each processed message
     /// @param end_frame - set when 'end_frame' received
@@ -41,10 +51,14 @@ class ProtoHandler {
     /// Set primitives layer, affect both permanent and normal frames
     void set_layer(size_t layer);
 
+    /// Send message to strategy, only on its request, because clients may never read socket
+    void reply(const std::string &msg);
+
  private:
     void reset_state();
 
-    Scene *scene_;
+    FrameSink *sink_;
+    reply_fn_t reply_;
     std::shared_ptr<FrameEditor> frame_;
     FrameEditor permanent_frame_;
     bool use_permanent_ = false;
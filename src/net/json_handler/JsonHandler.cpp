@@ -1,5 +1,6 @@
 #include "JsonHandler.h"
 
+#include <common/Profiler.h>
 #include <common/logger.h>
 #include <net/PrimitiveType.h>
 #include <viewer/FrameEditor.h>
@@ -215,13 +216,14 @@ inline void from_json(const nlohmann::json &j, ColorShape &p) {
 }  // namespace pod
 
 void JsonHandler::handle_message(const uint8_t *data, uint32_t nbytes) {
+    Profiler::Scope parse{Profiler::PARSE, nbytes};
     const uint8_t *beg = data;
     const uint8_t *block_end = data + nbytes;
     while (true) {
         const uint8_t *end = std::find(beg, block_end, '}');
         if (end == block_end) {
             if (beg != block_end) {
-                fragment_msg_ = std::string(beg, end);
+                fragment_msg_ += std::string(beg, end);
             }
             break;
         }
@@ -317,6 +319,14 @@ void JsonHandler::process_json_message(const uint8_t *chunk_begin, const uint8_t
         }
 
         on_message_processed(type == PrimitiveType::END);
+
+        // Frame is in scene now, strategy asked to confirm it, e.g. to measure latency
+        if (type == PrimitiveType::END) {
+            auto it = j.find("ack");
+            if (it != j.end()) {
+                reply(json{{"type", "ack"}, {"ack", *it}}.dump() + "\n");
+            }
+        }
     } catch (const std::exception &e) {
         LOG_WARN("JsonClient::Exception: %s", e.what());
     }
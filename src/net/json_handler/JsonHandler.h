@@ -2,7 +2,17 @@
 
 #include <json.hpp>
 
+#include <glm/vec2.hpp>
+
 #include <cstdint>
+#include <vector>
+
+namespace pod {
+
+/// Coordinates [x1, y1, x2, y2, ...] to points
+std::vector<glm::vec2> convert_check(const std::vector<float> &points);
+
+}  // namespace pod
 
 class JsonHandler : public ProtoHandler {
  public:
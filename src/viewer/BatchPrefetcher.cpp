@@ -0,0 +1,287 @@
+//
+// Created by valdemar on 18.10.26.
+//
+
+#include "BatchPrefetcher.h"
+#include "ShaderCollection.h"
+
+#include <cgutils/opengl.h>
+#include <common/JobSystem.h>
+#include <common/logger.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+enum class slot_state_t {
+    FREE,
+    FILLING,  // Owned by worker thread
+    READY,
+    DRAWING,  // Owned by render thread
+};
+
+}  // anonymous namespace
+
+struct BatchPrefetcher::prefetch_state_t {
+    struct slot_t {
+        slot_state_t state = slot_state_t::FREE;
+        std::shared_ptr<Frame> frame;
+        settings_t settings;
+        RenderContext::Batch batch;
+        RenderContext::batch_buffers_t buffers{};
+        // Signaled when upload finished on READY slot and when draw finished on FREE slot
+        GLsync fence = nullptr;
+    };
+    std::vector<std::unique_ptr<slot_t>> slots;
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool stop = false;
+
+    // Requested frames not taken by worker yet
+    std::vector<std::shared_ptr<Frame>> pending;
+    settings_t settings;
+    // Replaced with settings, so fill jobs of outdated batches are dropped
+    JobSystem::CancelToken cancel;
+
+    std::thread worker;
+
+    slot_t *free_slot() {
+        for (auto &slot : slots) {
+            if (slot->state == slot_state_t::FREE) {
+                return slot.get();
+            }
+        }
+        return nullptr;
+    }
+};
+
+bool BatchPrefetcher::settings_t::operator==(const settings_t &other) const {
+    return view_min == other.view_min && view_max == other.view_max &&
+           pixel_size == other.pixel_size && lod_enabled == other.lod_enabled &&
+           instanced_circles == other.instanced_circles &&
+           split_tags == other.split_tags && key == other.key;
+}
+
+BatchPrefetcher::BatchPrefetcher(ResourceManager *res, size_t slots, fill_fn_t fill)
+    : fill_(std::move(fill)) {
+    state_ = std::make_unique<prefetch_state_t>();
+
+    // Window hints kept from main window creation, so context has the same version
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    window_ = glfwCreateWindow(1, 1, "Prefetch context", nullptr, glfwGetCurrentContext());
+    glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+    if (!window_) {
+        LOG_WARN("Cannot create shared OpenGL context, frames prefetching disabled");
+        return;
+    }
+
+    for (size_t idx = 0; idx < slots; ++idx) {
+        auto slot = std::make_unique<prefetch_state_t::slot_t>();
+        slot->buffers.point_vbo = res->gen_buffer();
+        slot->buffers.circle_vbo = res->gen_buffer();
+        slot->buffers.circle_instance_vbo = res->gen_buffer();
+        slot->buffers.ebo = res->gen_buffer();
+        state_->slots.emplace_back(std::move(slot));
+    }
+
+    state_->worker = std::thread([this] {
+        glfwMakeContextCurrent(window_);
+        try {
+            worker_loop();
+        } catch (const std::exception &ex) {
+            LOG_ERROR("BatchPrefetcher Exception:: %s", ex.what());
+        }
+        glfwMakeContextCurrent(nullptr);
+    });
+}
+
+BatchPrefetcher::~BatchPrefetcher() {
+    if (!window_) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        state_->stop = true;
+    }
+    state_->cv.notify_all();
+    state_->worker.join();
+
+    for (auto &slot : state_->slots) {
+        if (slot->fence) {
+            glDeleteSync(slot->fence);
+        }
+    }
+    glfwDestroyWindow(window_);
+}
+
+bool BatchPrefetcher::available() const {
+    return window_ != nullptr;
+}
+
+void BatchPrefetcher::request(std::vector<std::shared_ptr<Frame>> frames,
+                              const settings_t &settings) {
+    if (!window_) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        if (!(state_->settings == settings)) {
+            state_->cancel.cancel();
+            state_->cancel = JobSystem::CancelToken();
+        }
+        state_->settings = settings;
+
+        const auto requested = [&frames](const std::shared_ptr<Frame> &frame) {
+            return std::find(frames.begin(), frames.end(), frame) != frames.end();
+        };
+        for (auto &slot : state_->slots) {
+            if (slot->state != slot_state_t::READY) {
+                continue;
+            }
+            if (!(slot->settings == settings) || !requested(slot->frame)) {
+                // Upload may still be in progress, but it's enough to wait on reuse
+                slot->state = slot_state_t::FREE;
+                slot->frame = nullptr;
+            }
+        }
+
+        const auto prepared = [&](const std::shared_ptr<Frame> &frame) {
+            for (const auto &slot : state_->slots) {
+                if (slot->frame == frame && slot->settings == settings &&
+                    (slot->state == slot_state_t::FILLING || slot->state == slot_state_t::READY)) {
+                    return true;
+                }
+            }
+            return false;
+        };
+        state_->pending.clear();
+        for (auto &frame : frames) {
+            if (frame && !prepared(frame)) {
+                state_->pending.emplace_back(std::move(frame));
+            }
+        }
+    }
+    state_->cv.notify_one();
+}
+
+bool BatchPrefetcher::draw(const Frame *frame, const settings_t &settings,
+                           const RenderContext::context_vao_t &vaos,
+                           const ShaderCollection &shaders,
+                           RenderContext::Batch::draw_stats_t *stats) {
+    if (!window_) {
+        return false;
+    }
+
+    prefetch_state_t::slot_t *slot = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        for (auto &candidate : state_->slots) {
+            if (candidate->state == slot_state_t::READY && candidate->frame.get() == frame &&
+                candidate->settings == settings) {
+                slot = candidate.get();
+                break;
+            }
+        }
+        if (!slot) {
+            return false;
+        }
+        slot->state = slot_state_t::DRAWING;
+    }
+
+    // Waits on GPU side, upload is already flushed by worker
+    glWaitSync(slot->fence, 0, GL_TIMEOUT_IGNORED);
+    glDeleteSync(slot->fence);
+    slot->batch.draw_uploaded(vaos, slot->buffers, shaders);
+    if (stats) {
+        *stats = slot->batch.last_stats();
+    }
+    // Worker must not overwrite buffers until drawing is done
+    slot->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glFlush();
+
+    {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        slot->state = slot_state_t::FREE;
+        slot->frame = nullptr;
+    }
+    state_->cv.notify_one();
+    return true;
+}
+
+void BatchPrefetcher::worker_loop() {
+    auto &jobs = JobSystem::shared();
+    std::unique_lock<std::mutex> lock(state_->mutex);
+    while (true) {
+        state_->cv.wait(lock, [&] {
+            return state_->stop || (state_->free_slot() && !state_->pending.empty());
+        });
+        if (state_->stop) {
+            break;
+        }
+
+        // Every free slot takes a frame, so batches are filled in parallel
+        std::vector<prefetch_state_t::slot_t *> filling;
+        prefetch_state_t::slot_t *slot = nullptr;
+        while (!state_->pending.empty() && (slot = state_->free_slot())) {
+            slot->state = slot_state_t::FILLING;
+            slot->frame = state_->pending.front();
+            slot->settings = state_->settings;
+            state_->pending.erase(state_->pending.begin());
+            filling.push_back(slot);
+        }
+        const JobSystem::CancelToken cancel = state_->cancel;
+        lock.unlock();
+
+        JobSystem::Group group;
+        for (auto *item : filling) {
+            jobs.submit(JobSystem::Priority::PREFETCH,
+                        [this, item] {
+                            auto &batch = item->batch;
+                            // Dropped slots keep commands of never drawn batch
+                            batch.clear();
+                            batch.set_visible_area(item->settings.view_min,
+                                                   item->settings.view_max);
+                            batch.set_pixel_size(item->settings.pixel_size);
+                            batch.set_lod_enabled(item->settings.lod_enabled);
+                            batch.set_split_tags(item->settings.split_tags);
+                            fill_(*item->frame, item->settings.key, batch);
+                        },
+                        &group, &cancel);
+        }
+        // Helps with own jobs, so prefetching goes on even if pool is busy with others
+        jobs.wait(group);
+
+        // Cancelled jobs may be dropped before start, their batches are not filled
+        const bool cancelled = cancel.cancelled();
+        if (!cancelled) {
+            for (auto *item : filling) {
+                // Previous content of buffers may still be in use
+                if (item->fence) {
+                    glWaitSync(item->fence, 0, GL_TIMEOUT_IGNORED);
+                    glDeleteSync(item->fence);
+                    item->fence = nullptr;
+                }
+                item->batch.upload(item->buffers, item->settings.instanced_circles);
+                item->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            }
+            // Make commands visible to render context
+            glFlush();
+        }
+
+        lock.lock();
+        for (auto *item : filling) {
+            if (!cancelled && item->settings == state_->settings) {
+                item->state = slot_state_t::READY;
+            } else {
+                item->state = slot_state_t::FREE;
+                item->frame = nullptr;
+            }
+        }
+    }
+}
@@ -0,0 +1,74 @@
+//
+// Created by valdemar on 18.10.26.
+//
+
+#pragma once
+
+#include <cgutils/ResourceManager.h>
+#include <viewer/Frame.h>
+#include <viewer/RenderContext.h>
+
+#include <glm/glm.hpp>
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+struct GLFWwindow;
+struct ShaderCollection;
+
+/**
+ * Prepares batches of upcoming frames during playback, so render thread only issues draw calls.
+ * Batches are filled in parallel by shared job system with prefetch priority. Worker thread has
+ * own hidden window with GL context shared with render one, it uploads filled batches and hands
+ * buffers over to render thread with fence sync.
+ */
+class BatchPrefetcher {
+ public:
+    /// Everything affecting batch content except frame itself
+    struct settings_t {
+        glm::vec2 view_min{};
+        glm::vec2 view_max{};
+        float pixel_size = 0.0f;
+        bool lod_enabled = true;
+        bool instanced_circles = false;
+        bool split_tags = false;
+        /// Opaque value passed to fill function, e.g. enabled layers and permanent data version
+        uint64_t key = 0;
+
+        bool operator==(const settings_t &other) const;
+    };
+
+    /// Queue frame primitives into batch, called from job system threads, several at once
+    using fill_fn_t =
+        std::function<void(const Frame &frame, uint64_t key, RenderContext::Batch &batch)>;
+
+    /// Should be created from render thread with current GL context
+    /// @param slots - maximum frames prepared ahead
+    BatchPrefetcher(ResourceManager *res, size_t slots, fill_fn_t fill);
+    ~BatchPrefetcher();
+
+    /// False if shared context cannot be created, prefetching does nothing in that case
+    bool available() const;
+
+    /// Replace list of frames to prepare, ordered by priority.
+    /// Prepared batches of frames not in list or with other settings are dropped
+    /// @note Called from render thread
+    void request(std::vector<std::shared_ptr<Frame>> frames, const settings_t &settings);
+
+    /// Draw prepared batch of frame if it was uploaded with same settings
+    /// @return false if batch is not ready, frame should be drawn usual way
+    /// @note Called from render thread
+    bool draw(const Frame *frame, const settings_t &settings,
+              const RenderContext::context_vao_t &vaos, const ShaderCollection &shaders,
+              RenderContext::Batch::draw_stats_t *stats);
+
+ private:
+    void worker_loop();
+
+    struct prefetch_state_t;
+    std::unique_ptr<prefetch_state_t> state_;
+
+    GLFWwindow *window_ = nullptr;
+    fill_fn_t fill_;
+};
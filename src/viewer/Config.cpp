@@ -25,8 +25,8 @@ void callback_ReadLine(ImGuiContext *, ImGuiSettingsHandler *, void *entry, cons
     glm::vec2 p;
     int d1, d2;
 
-    if (sscanf(line, "ui.fast_skip_speed=%d", &d1) == 1) {
-        cfg.ui.fast_skip_speed = d1;
+    if (sscanf(line, "ui.playback_speed=%f", &p.x) == 1) {
+        cfg.ui.playback_speed = cg::clamp(p.x, 0.25f, 1000.0f);
     } else if (sscanf(line, "ui.close_with_esc=%d", &d1) == 1) {
         cfg.ui.close_with_esc = d1;
     } else if (sscanf(line, "ui.clear_color=(%f,%f,%f)", &v.r, &v.g, &v.b) == 3) {
@@ -47,6 +47,16 @@ void callback_ReadLine(ImGuiContext *, ImGuiSettingsHandler *, void *entry, cons
         cfg.scene.scene_color = v;
     } else if (sscanf(line, "scene.show_grid=%d", &d1) == 1) {
         cfg.scene.show_grid = d1;
+    } else if (sscanf(line, "scene.use_lod=%d", &d1) == 1) {
+        cfg.scene.use_lod = d1;
+    } else if (sscanf(line, "scene.hover_primitives=%d", &d1) == 1) {
+        cfg.scene.hover_primitives = d1;
+    } else if (sscanf(line, "scene.circles_render_mode=%d", &d1) == 1) {
+        cfg.scene.circles_render_mode = cg::clamp(d1, 0, 2);
+    } else if (sscanf(line, "scene.prefetch_frames=%d", &d1) == 1) {
+        cfg.scene.prefetch_frames = cg::clamp(d1, 0, 64);
+    } else if (sscanf(line, "scene.search_index=%d", &d1) == 1) {
+        cfg.scene.search_index = d1;
     } else if (sscanf(line, "net.use_binary_protocol=%d", &d1) == 1) {
         cfg.net.use_binary_protocol = d1;
     } else if (sscanf(line, "camera.origin_on_top_left=%d", &d1) == 1) {
@@ -70,10 +80,6 @@ void write(ImGuiTextBuffer &to, const char *name, float value) {
     to.appendf("%s=%.3f\n", name, value);
 }
 
-void write(ImGuiTextBuffer &to, const char *name, uint16_t value) {
-    to.appendf("%s=%hu\n", name, value);
-}
-
 void write(ImGuiTextBuffer &to, const char *name, glm::vec2 pos) {
     to.appendf("%s=(%.3f,%.3f)\n", name, pos.x, pos.y);
 }
@@ -98,7 +104,9 @@ void callback_WriteAll(ImGuiContext *, ImGuiSettingsHandler *handler, ImGuiTextB
 
 #define P(param) #param, param
     const auto &ui = cfg.ui;
-    write(*buf, P(ui.fast_skip_speed), "How much frame to skip when fast forward arrow pressed");
+    write(*buf, P(ui.playback_speed),
+          "Autoplay speed from 0.25 to 1000, 1 is 60 ticks per second. Fast forward is 10 times "
+          "faster");
     write(*buf, P(ui.close_with_esc), "If true, visualiser can be closed by Esc key");
     write(*buf, P(ui.clear_color), "Background color, rgb format");
     write(*buf, P(ui.update_unfocused), "Update when not in focus, consumes extra CPU");
@@ -112,6 +120,17 @@ void callback_WriteAll(ImGuiContext *, ImGuiSettingsHandler *handler, ImGuiTextB
     write(*buf, "scene.scene_color", glm::vec3{cfg.scene.scene_color},
           "Scene background color, rgb format");
     write(*buf, P(scene.show_grid), "If true, grid will be shown by default");
+    write(*buf, P(scene.use_lod),
+          "If true, zoomed out scene drawn with simplified geometry, error is within one pixel");
+    write(*buf, P(scene.hover_primitives),
+          "If true, attributes of primitive under cursor shown in tooltip");
+    write(*buf, P(scene.circles_render_mode),
+          "Circles drawing: 0 - choose by driver, 1 - geometry shader, 2 - instancing");
+    write(*buf, P(scene.prefetch_frames),
+          "Frames uploaded to GPU ahead in background thread during playback, 0 disables. "
+          "Applied after restart");
+    write(*buf, P(scene.search_index),
+          "If true, frames messages and popups are indexed in background for text search");
 
     // const auto &net = cfg.net;
     // write(*buf, P(net.use_binary_protocol),
@@ -13,7 +13,8 @@
 
 struct Config {
     struct UIConf {
-        uint16_t fast_skip_speed = 20;
+        // Autoplay speed multiplier, 1x is 60 ticks per second
+        float playback_speed = 1.0f;
         bool close_with_esc = false;
         glm::vec3 clear_color = {0.2, 0.3, 0.3};
         bool update_unfocused = false;
@@ -27,7 +28,18 @@ struct Config {
         glm::vec4 grid_color = {0.3219f, 0.336f, 0.392f, 1.0f};
         glm::vec4 scene_color = {0.757f, 0.856f, 0.882f, 1.0f};
         bool show_grid = true;
+        bool use_lod = true;
+        // Tooltip with attributes of primitive under cursor
+        bool hover_primitives = true;
+        // 0 - choose by driver, 1 - geometry shader, 2 - instancing
+        int circles_render_mode = 0;
+        // Frames prepared ahead in background during playback, 0 disables
+        int prefetch_frames = 8;
+        // Index frames text in background for search
+        bool search_index = true;
         std::array<bool, Frame::LAYERS_COUNT> enabled_layers = {{1, 1, 1, 1, 1, 1, 1, 1, 1, 1}};
+        // Layers drawn as primitives density instead of primitives
+        std::array<bool, Frame::LAYERS_COUNT> heatmap_layers = {};
     } scene;
 
     struct NetConf {
@@ -1,29 +1,95 @@
 #include "Frame.h"
 
+#include <common/JobSystem.h>
+
+#include <atomic>
 #include <cassert>
 
+namespace {
+
+/// Unique for whole process, so frames never share version unless copied
+uint64_t next_version() {
+    static std::atomic<uint64_t> counter{0};
+    return ++counter;
+}
+
+}  // anonymous namespace
+
 void Frame::update_from(const Frame::context_collection_t &from_contexts) {
-    for (size_t i = 0; i < contexts_.size(); ++i) {
-        contexts_[i].update_from(from_contexts[i]);
-    }
+    version_ = next_version();
+    append_contexts(from_contexts, true);
 }
 
 void Frame::update_from(const Frame &other) {
-    update_from(other.all_contexts());
+    version_ = next_version();
+    append_contexts(other.all_contexts(), false);
 
     // copy popups
     for (size_t i = 0; i < popups_.size(); ++i) {
         const auto &from = other.popups_[i];
         auto &to = popups_[i];
 
-        to.reserve(to.size() + from.size());
-        for (const auto &popup : from) {
-            to.push_back(popup);
+        if (from.empty()) {
+            continue;
         }
+        to.insert(to.end(), from.begin(), from.end());
     }
 
+    const auto shift = static_cast<uint32_t>(user_message_.size());
     user_message_ += other.user_message_;
+    for (uint32_t start : other.message_lines_) {
+        message_lines_.push_back(shift + start);
+    }
+
+    if (first_data_ == std::chrono::steady_clock::time_point{}) {
+        first_data_ = other.first_data_;
+    }
+    update_stats();
+}
+
+void Frame::seal() {
+    version_ = next_version();
+    // Layers are independent, filled ones indexed in parallel and one of them on this thread
+    auto &jobs = JobSystem::shared();
+    JobSystem::Group group;
+    RenderContext *own = nullptr;
+    for (auto &ctx : contexts_) {
+        if (ctx.empty()) {
+            ctx.build_index();
+        } else if (!own) {
+            own = &ctx;
+        } else {
+            jobs.submit(JobSystem::Priority::INTERACTIVE, [&ctx] { ctx.build_index(); }, &group);
+        }
+    }
+    for (size_t i = 0; i < popups_.size(); ++i) {
+        popup_index_[i].build(popups_[i]);
+    }
+    if (own) {
+        own->build_index();
+    }
+    jobs.wait(group);
+
+    stats_.bounds_min = glm::vec2{std::numeric_limits<float>::max()};
+    stats_.bounds_max = glm::vec2{std::numeric_limits<float>::lowest()};
+    for (const auto &ctx : contexts_) {
+        ctx.extend_bounds(stats_.bounds_min, stats_.bounds_max);
+    }
+    update_stats();
+}
+
+void Frame::append_contexts(const Frame::context_collection_t &from_contexts, bool reindex) {
+    for (size_t i = 0; i < contexts_.size(); ++i) {
+        if (!from_contexts[i].empty()) {
+            from_contexts[i].extend_bounds(stats_.bounds_min, stats_.bounds_max);
+            contexts_[i].update_from(from_contexts[i]);
+            if (reindex) {
+                contexts_[i].build_index();
+            }
+        }
+    }
 }
+
 const Frame::context_collection_t &Frame::all_contexts() const {
     return contexts_;
 }
@@ -35,3 +101,54 @@ const Frame::popup_collection_t &Frame::all_popups() const {
 const char *Frame::user_message() const {
     return user_message_.c_str();
 }
+
+size_t Frame::message_lines_count() const {
+    return message_lines_.size();
+}
+
+Frame::text_range_t Frame::message_line(size_t idx) const {
+    const size_t next =
+        idx + 1 < message_lines_.size() ? message_lines_[idx + 1] : user_message_.size();
+    const char *text = user_message_.data();
+    return {text + message_lines_[idx], text + next - 1};
+}
+
+void Frame::hit_popups(size_t layer, glm::vec2 point, std::vector<uint32_t> &result) const {
+    popup_index_[layer].hit_test(popups_[layer], point, result);
+}
+
+uint64_t Frame::version() const {
+    return version_;
+}
+
+const Frame::stats_t &Frame::stats() const {
+    return stats_;
+}
+
+void Frame::update_stats() {
+    stats_.popups = 0;
+    stats_.vertex_bytes = 0;
+    for (size_t i = 0; i < LAYERS_COUNT; ++i) {
+        for (size_t kind = 0; kind < RenderContext::PRIMITIVE_KINDS; ++kind) {
+            stats_.primitives[i][kind] = static_cast<uint32_t>(
+                contexts_[i].primitives_count(static_cast<RenderContext::primitive_t>(kind)));
+        }
+        stats_.popups += static_cast<uint32_t>(popups_[i].size());
+        stats_.vertex_bytes += contexts_[i].vertex_bytes();
+    }
+    stats_.message_bytes = static_cast<uint32_t>(user_message_.size());
+    if (first_data_ != std::chrono::steady_clock::time_point{}) {
+        const std::chrono::duration<float, std::milli> elapsed =
+            std::chrono::steady_clock::now() - first_data_;
+        stats_.ingest_ms = elapsed.count();
+    }
+}
+
+bool Frame::empty() const {
+    for (size_t i = 0; i < LAYERS_COUNT; ++i) {
+        if (!contexts_[i].empty() || !popups_[i].empty()) {
+            return false;
+        }
+    }
+    return user_message_.empty();
+}
@@ -5,9 +5,15 @@
 #pragma once
 
 #include <array>
+#include <chrono>
+#include <cstdint>
 #include <cstdlib>
+#include <limits>
+#include <string>
+#include <vector>
 
 #include <viewer/Popup.h>
+#include <viewer/PopupIndex.h>
 #include <viewer/RenderContext.h>
 
 class Frame {
@@ -18,16 +24,71 @@ class Frame {
     using context_collection_t = std::array<RenderContext, LAYERS_COUNT>;
     using popup_collection_t = std::array<std::vector<Popup>, LAYERS_COUNT>;
 
+    /// Append primitives from other contexts, changed contexts are reindexed
     void update_from(const context_collection_t &from_contexts);
+    /// Append primitives, popups and messages without reindexing, appended data is found by
+    /// linear scan until next seal()
     void update_from(const Frame &other);
 
+    /// Called once frame is complete, before it become visible to render thread
+    void seal();
+
     const context_collection_t &all_contexts() const;
     const popup_collection_t &all_popups() const;
 
     const char *user_message() const;
 
+    /// Part of user message, not null terminated
+    struct text_range_t {
+        const char *begin;
+        const char *end;
+    };
+
+    /// Lines of user message, each message adds at least one
+    size_t message_lines_count() const;
+    /// Line by index in range [0, message_lines_count()), without line break
+    text_range_t message_line(size_t idx) const;
+
+    /// Indices of layer popups containing point, in order popups were added
+    void hit_popups(size_t layer, glm::vec2 point, std::vector<uint32_t> &result) const;
+
+    /// True if nothing was added to frame
+    bool empty() const;
+
+    /// Frame summary, updated on seal and on each update
+    struct stats_t {
+        /// Primitives by layer and kind
+        std::array<std::array<uint32_t, RenderContext::PRIMITIVE_KINDS>, LAYERS_COUNT> primitives{};
+        uint32_t popups = 0;
+        uint64_t vertex_bytes = 0;
+        uint32_t message_bytes = 0;
+        /// Bounds of all primitives, min is greater than max if there are none
+        glm::vec2 bounds_min{std::numeric_limits<float>::max()};
+        glm::vec2 bounds_max{std::numeric_limits<float>::lowest()};
+        /// From the first data received to the last update
+        float ingest_ms = 0.0f;
+    };
+
+    const stats_t &stats() const;
+
+    /// Changes on each update and seal, so frame object reused for other content is told apart
+    uint64_t version() const;
+
  protected:
     context_collection_t contexts_;
     popup_collection_t popups_;
+    std::array<PopupIndex, LAYERS_COUNT> popup_index_;
     std::string user_message_;
+    /// Offset of each line start in user message, every line ends with line break
+    std::vector<uint32_t> message_lines_;
+
+    /// Recompute counters, bounds are extended separately as primitives added
+    void update_stats();
+
+    void append_contexts(const context_collection_t &from_contexts, bool reindex);
+
+    /// When the first primitive, popup or message was added, zero if nothing was
+    std::chrono::steady_clock::time_point first_data_{};
+    stats_t stats_;
+    uint64_t version_ = 0;
 };
@@ -6,16 +6,28 @@
 #include <utility>
 
 void FrameEditor::add_box_popup(glm::vec2 center, glm::vec2 size, std::string message) {
+    mark_data();
     popups_[layer_id_].push_back(Popup::create_rect(center, size, std::move(message)));
 }
 
 void FrameEditor::add_round_popup(glm::vec2 center, float radius, std::string message) {
+    mark_data();
     popups_[layer_id_].push_back(Popup::create_circle(center, radius, std::move(message)));
 }
 
 void FrameEditor::add_user_text(const std::string &msg) {
+    mark_data();
+    const size_t start = user_message_.size();
     user_message_ += msg;
     user_message_ += '\n';
+
+    // Message may consist of several lines itself
+    message_lines_.push_back(static_cast<uint32_t>(start));
+    for (size_t pos = start; pos + 1 < user_message_.size(); ++pos) {
+        if (user_message_[pos] == '\n') {
+            message_lines_.push_back(static_cast<uint32_t>(pos + 1));
+        }
+    }
 }
 
 void FrameEditor::set_layer_id(size_t id) {
@@ -27,10 +39,22 @@ void FrameEditor::clear() {
     for (size_t i = 0; i < Frame::LAYERS_COUNT; ++i) {
         contexts_[i].clear();
         popups_[i].clear();
+        popup_index_[i].clear();
     }
     user_message_.clear();
+    message_lines_.clear();
+    first_data_ = {};
+    stats_ = {};
 }
 
 RenderContext &FrameEditor::context() {
+    // Editor hands out context only to add primitives
+    mark_data();
     return contexts_[layer_id_];
 }
+
+void FrameEditor::mark_data() {
+    if (first_data_ == std::chrono::steady_clock::time_point{}) {
+        first_data_ = std::chrono::steady_clock::now();
+    }
+}
@@ -20,5 +20,8 @@ class FrameEditor : public Frame {
     RenderContext &context();
 
  private:
+    /// Remember time of the first data, used as ingest start
+    void mark_data();
+
     size_t layer_id_ = DEFAULT_LAYER;
 };
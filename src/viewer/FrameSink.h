@@ -0,0 +1,31 @@
+//
+// Created by valdemar on 18.10.26.
+//
+
+#pragma once
+
+#include <viewer/Frame.h>
+
+#include <memory>
+
+/**
+ * Receiver of frames decoded by protocol handler. Implemented by Scene, other implementations
+ * let handlers run without scene and GL, e.g. in benchmarks
+ */
+class FrameSink {
+ public:
+    virtual ~FrameSink() = default;
+
+    /// Next frame is ready
+    virtual void add_frame(std::shared_ptr<Frame> frame) = 0;
+
+    /// Add data to last appended frame
+    /// @param complete - set when data ends the frame
+    virtual void add_frame_data(const Frame &data, bool complete) = 0;
+
+    /// Add primitives to permanent frame
+    virtual void add_permanent_frame_data(const Frame &data) = 0;
+
+    /// Remove all frames and clear permanent frame
+    virtual void clear_data() = 0;
+};
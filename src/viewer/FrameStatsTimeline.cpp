@@ -0,0 +1,88 @@
+//
+// Created by valdemar on 18.10.26.
+//
+
+#include "FrameStatsTimeline.h"
+
+#include <algorithm>
+#include <cmath>
+
+const char *FrameStatsTimeline::metric_name(size_t metric) {
+    static const std::array<const char *, METRICS_COUNT> names{
+        {"Primitives", "Triangles", "Lines", "Circles", "Popups", "Vertex KB", "Message KB",
+         "Bounds size", "Ingest ms", "Layer 1", "Layer 2", "Layer 3", "Layer 4", "Layer 5",
+         "Layer 6", "Layer 7", "Layer 8", "Layer 9", "Layer 10"}};
+    return metric < METRICS_COUNT ? names[metric] : "";
+}
+
+void FrameStatsTimeline::update(const FrameTimeline &frames) {
+    const size_t count = frames.size();
+    if (count < complete_) {
+        clear();
+    }
+    for (auto &column : columns_) {
+        column.resize(count);
+    }
+
+    using kind_t = RenderContext::primitive_t;
+    for (size_t idx = complete_; idx < count; ++idx) {
+        const auto &stats = frames.at(idx)->stats();
+        std::array<float, RenderContext::PRIMITIVE_KINDS> kinds{};
+        for (size_t layer = 0; layer < Frame::LAYERS_COUNT; ++layer) {
+            float layer_total = 0.0f;
+            for (size_t kind = 0; kind < RenderContext::PRIMITIVE_KINDS; ++kind) {
+                const auto value = static_cast<float>(stats.primitives[layer][kind]);
+                kinds[kind] += value;
+                layer_total += value;
+            }
+            columns_[LAYER_PRIMITIVES + layer][idx] = layer_total;
+        }
+
+        const auto kind = [&kinds](kind_t k) { return kinds[static_cast<size_t>(k)]; };
+        columns_[TRIANGLES][idx] = kind(kind_t::TRIANGLE);
+        columns_[LINES][idx] = kind(kind_t::LINE);
+        columns_[CIRCLES][idx] = kind(kind_t::FILLED_CIRCLE) + kind(kind_t::THIN_CIRCLE);
+        columns_[PRIMITIVES][idx] =
+            columns_[TRIANGLES][idx] + columns_[LINES][idx] + columns_[CIRCLES][idx];
+        columns_[POPUPS][idx] = static_cast<float>(stats.popups);
+        columns_[VERTEX_KB][idx] = static_cast<float>(stats.vertex_bytes) / 1024.0f;
+        columns_[MESSAGE_KB][idx] = static_cast<float>(stats.message_bytes) / 1024.0f;
+        const glm::vec2 extent = stats.bounds_max - stats.bounds_min;
+        columns_[BOUNDS_SIZE][idx] =
+            extent.x >= 0.0f && extent.y >= 0.0f ? std::sqrt(glm::dot(extent, extent)) : 0.0f;
+        columns_[INGEST_MS][idx] = stats.ingest_ms;
+    }
+    // The last frame may be replaced with more data in immediate mode
+    complete_ = count > 0 ? count - 1 : 0;
+}
+
+void FrameStatsTimeline::clear() {
+    for (auto &column : columns_) {
+        column.clear();
+    }
+    complete_ = 0;
+}
+
+size_t FrameStatsTimeline::size() const {
+    return columns_[0].size();
+}
+
+float FrameStatsTimeline::value(size_t metric, size_t frame) const {
+    return columns_[metric][frame];
+}
+
+float FrameStatsTimeline::downsample(size_t metric, size_t buckets,
+                                     std::vector<float> &result) const {
+    const auto &column = columns_[metric];
+    buckets = std::min(buckets, column.size());
+    result.assign(buckets, 0.0f);
+    float max_value = 0.0f;
+    for (size_t bucket = 0; bucket < buckets; ++bucket) {
+        const size_t from = bucket * column.size() / buckets;
+        const size_t to = (bucket + 1) * column.size() / buckets;
+        const float value = *std::max_element(column.begin() + from, column.begin() + to);
+        result[bucket] = value;
+        max_value = std::max(max_value, value);
+    }
+    return max_value;
+}
@@ -0,0 +1,56 @@
+//
+// Created by valdemar on 18.10.26.
+//
+
+#pragma once
+
+#include <viewer/FrameTimeline.h>
+
+#include <array>
+#include <vector>
+
+/**
+ * Statistics of all frames stored by columns, one value per frame, used for timeline plots.
+ * Filled from frame stats computed on seal, the last frame refreshed until next one arrives.
+ */
+class FrameStatsTimeline {
+ public:
+    enum Metric : size_t {
+        PRIMITIVES,
+        TRIANGLES,
+        LINES,
+        CIRCLES,
+        POPUPS,
+        VERTEX_KB,
+        MESSAGE_KB,
+        /// Diagonal of primitives bounds
+        BOUNDS_SIZE,
+        INGEST_MS,
+        /// Primitives of each layer, LAYER_PRIMITIVES + layer index
+        LAYER_PRIMITIVES,
+    };
+    static constexpr size_t METRICS_COUNT = LAYER_PRIMITIVES + Frame::LAYERS_COUNT;
+
+    static const char *metric_name(size_t metric);
+
+    /// Add new frames and refresh the last one
+    void update(const FrameTimeline &frames);
+
+    void clear();
+
+    size_t size() const;
+
+    float value(size_t metric, size_t frame) const;
+
+    /**
+     * Split frames into equal ranges and take maximum of each, so spikes never disappear
+     * @param buckets - ranges count, less if there are fewer frames
+     * @return maximum of all values
+     */
+    float downsample(size_t metric, size_t buckets, std::vector<float> &result) const;
+
+ private:
+    std::array<std::vector<float>, METRICS_COUNT> columns_;
+    /// Frames which stats never change
+    size_t complete_ = 0;
+};
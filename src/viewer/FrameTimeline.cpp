@@ -0,0 +1,63 @@
+//
+// Created by valdemar on 18.10.26.
+//
+
+#include "FrameTimeline.h"
+
+#include <stdexcept>
+
+FrameTimeline::FrameTimeline() {
+    directory_ = std::make_unique<std::atomic<chunk_t *>[]>(MAX_CHUNKS);
+    for (size_t i = 0; i < MAX_CHUNKS; ++i) {
+        directory_[i].store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+FrameTimeline::~FrameTimeline() {
+    for (size_t i = 0; i < MAX_CHUNKS; ++i) {
+        delete directory_[i].load(std::memory_order_relaxed);
+    }
+}
+
+const Frame *FrameTimeline::at(size_t idx) const {
+    return chunk(idx).frames[idx % CHUNK_SIZE].load(std::memory_order_acquire);
+}
+
+std::shared_ptr<Frame> FrameTimeline::share(size_t idx) const {
+    if (idx + 1 >= size()) {
+        throw std::out_of_range("Last frame may be replaced and can't be shared");
+    }
+    return chunk(idx).owners[idx % CHUNK_SIZE];
+}
+
+void FrameTimeline::push_back(std::shared_ptr<Frame> frame) {
+    const size_t idx = size_.load(std::memory_order_relaxed);
+    const size_t chunk_idx = idx / CHUNK_SIZE;
+    if (chunk_idx >= MAX_CHUNKS) {
+        throw std::runtime_error("Frames limit reached");
+    }
+    chunk_t *chunk = directory_[chunk_idx].load(std::memory_order_relaxed);
+    if (!chunk) {
+        chunk = new chunk_t;
+        directory_[chunk_idx].store(chunk, std::memory_order_relaxed);
+    }
+    chunk->frames[idx % CHUNK_SIZE].store(frame.get(), std::memory_order_relaxed);
+    chunk->owners[idx % CHUNK_SIZE] = std::move(frame);
+    // Frame and chunk become visible together with new size
+    size_.store(idx + 1, std::memory_order_release);
+}
+
+std::shared_ptr<Frame> FrameTimeline::replace_back(std::shared_ptr<Frame> frame) {
+    const size_t idx = size_.load(std::memory_order_relaxed);
+    if (idx == 0) {
+        throw std::runtime_error("called replace_back, but frames list is empty");
+    }
+    chunk_t *chunk = directory_[(idx - 1) / CHUNK_SIZE].load(std::memory_order_relaxed);
+    chunk->frames[(idx - 1) % CHUNK_SIZE].store(frame.get(), std::memory_order_release);
+    std::swap(chunk->owners[(idx - 1) % CHUNK_SIZE], frame);
+    return frame;
+}
+
+const FrameTimeline::chunk_t &FrameTimeline::chunk(size_t idx) const {
+    return *directory_[idx / CHUNK_SIZE].load(std::memory_order_relaxed);
+}
@@ -0,0 +1,60 @@
+//
+// Created by valdemar on 18.10.26.
+//
+
+#pragma once
+
+#include <viewer/Frame.h>
+
+#include <array>
+#include <atomic>
+#include <memory>
+
+/**
+ * Append-only frames index split into fixed size chunks.
+ * Directory of chunks is allocated once and never moves, so readers get stable frame pointers
+ * without locks while single writer appends. Appending never copies existing entries.
+ * Only the last frame may be replaced, e.g. by data sent in immediate mode.
+ */
+class FrameTimeline {
+ public:
+    static constexpr size_t CHUNK_SIZE = 1024;
+    static constexpr size_t MAX_CHUNKS = 16384;
+
+    FrameTimeline();
+    ~FrameTimeline();
+
+    FrameTimeline(const FrameTimeline &) = delete;
+    FrameTimeline &operator=(const FrameTimeline &) = delete;
+
+    /// Published frames count, never decreases
+    size_t size() const {
+        return size_.load(std::memory_order_acquire);
+    }
+
+    /// Frame by index in range [0, size()), last one may be replaced after call
+    const Frame *at(size_t idx) const;
+
+    /// Shared ownership of frame, which is not the last one and so never replaced
+    std::shared_ptr<Frame> share(size_t idx) const;
+
+    /// @note Writers should be serialized by caller
+    void push_back(std::shared_ptr<Frame> frame);
+
+    /// Replace last frame
+    /// @return previous frame, readers may still use it
+    /// @note Writers should be serialized by caller
+    std::shared_ptr<Frame> replace_back(std::shared_ptr<Frame> frame);
+
+ private:
+    struct chunk_t {
+        std::array<std::atomic<const Frame *>, CHUNK_SIZE> frames;
+        /// Touched only by writer, except entries which are not last anymore
+        std::array<std::shared_ptr<Frame>, CHUNK_SIZE> owners;
+    };
+
+    const chunk_t &chunk(size_t idx) const;
+
+    std::unique_ptr<std::atomic<chunk_t *>[]> directory_;
+    std::atomic<size_t> size_{0};
+};
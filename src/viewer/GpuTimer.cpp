@@ -0,0 +1,108 @@
+//
+// Created by valdemar on 18.10.26.
+//
+
+#include "GpuTimer.h"
+
+namespace {
+
+/// Weight of newest frame in smoothed values
+constexpr float SMOOTHING = 0.1f;
+
+}  // anonymous namespace
+
+size_t GpuTimer::layer_section(size_t layer, size_t pass_group) {
+    return LAYER_PASSES + layer * PASS_GROUPS + pass_group;
+}
+
+std::string GpuTimer::section_name(size_t section) {
+    static const char *fixed_names[LAYER_PASSES] = {"background", "grid", "heatmaps", "ui"};
+    static const char *group_names[PASS_GROUPS] = {"triangles", "lines", "circles"};
+    if (section < LAYER_PASSES) {
+        return fixed_names[section];
+    }
+    const size_t layer_pass = section - LAYER_PASSES;
+    // Layers are numbered from one in ui
+    return "layer " + std::to_string(layer_pass / PASS_GROUPS + 1) + " " +
+           group_names[layer_pass % PASS_GROUPS];
+}
+
+GpuTimer::~GpuTimer() {
+    for (auto &frame : frames_) {
+        if (!frame.queries.empty()) {
+            glDeleteQueries(static_cast<GLsizei>(frame.queries.size()), frame.queries.data());
+        }
+    }
+}
+
+void GpuTimer::new_frame(bool enabled) {
+    if (active_) {
+        end();
+        active_->pending = true;
+        active_ = nullptr;
+    }
+
+    // Oldest frame first, results of later ones are taken only after it
+    for (size_t idx = 0; idx < FRAMES_IN_FLIGHT; ++idx) {
+        auto &frame = frames_[(next_frame_ + idx) % FRAMES_IN_FLIGHT];
+        if (frame.pending && !collect(frame)) {
+            break;
+        }
+    }
+
+    auto &next = frames_[next_frame_];
+    if (!enabled || next.pending) {
+        return;
+    }
+    next.used = 0;
+    next.sections.clear();
+    active_ = &next;
+    next_frame_ = (next_frame_ + 1) % FRAMES_IN_FLIGHT;
+}
+
+void GpuTimer::begin(size_t section) {
+    if (!active_ || section >= SECTIONS_COUNT) {
+        return;
+    }
+    end();
+    if (active_->used == active_->queries.size()) {
+        GLuint query = 0;
+        glGenQueries(1, &query);
+        active_->queries.push_back(query);
+    }
+    glBeginQuery(GL_TIME_ELAPSED, active_->queries[active_->used++]);
+    active_->sections.push_back(section);
+    query_running_ = true;
+}
+
+void GpuTimer::end() {
+    if (query_running_) {
+        glEndQuery(GL_TIME_ELAPSED);
+        query_running_ = false;
+    }
+}
+
+bool GpuTimer::collect(GpuTimer::frame_t &frame) {
+    if (frame.used > 0) {
+        // Queries finish in order they were issued
+        GLint available = 0;
+        glGetQueryObjectiv(frame.queries[frame.used - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            return false;
+        }
+
+        std::array<float, SECTIONS_COUNT> frame_ms{};
+        for (size_t idx = 0; idx < frame.used; ++idx) {
+            GLuint64 elapsed_ns = 0;
+            glGetQueryObjectui64v(frame.queries[idx], GL_QUERY_RESULT, &elapsed_ns);
+            frame_ms[frame.sections[idx]] += static_cast<float>(elapsed_ns) * 1e-6f;
+        }
+        const float weight = measured_frames_ == 0 ? 1.0f : SMOOTHING;
+        for (size_t idx = 0; idx < SECTIONS_COUNT; ++idx) {
+            smoothed_ms_[idx] += (frame_ms[idx] - smoothed_ms_[idx]) * weight;
+        }
+        ++measured_frames_;
+    }
+    frame.pending = false;
+    return true;
+}
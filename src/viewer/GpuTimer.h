@@ -0,0 +1,89 @@
+//
+// Created by valdemar on 18.10.26.
+//
+
+#pragma once
+
+#include <viewer/Frame.h>
+
+#include <glad/glad.h>
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * GPU time of render passes measured by GL_TIME_ELAPSED queries.
+ * Queries of several frames are in flight at once, results are taken only when GPU already
+ * finished them, so measuring never stalls the pipeline. Frame is skipped if its queries are
+ * still busy.
+ */
+class GpuTimer {
+ public:
+    enum Section : size_t {
+        BACKGROUND = 0,
+        GRID,
+        HEATMAPS,
+        UI,
+        /// Pass groups of each layer follow
+        LAYER_PASSES,
+    };
+    /// Triangles, lines and circles
+    static constexpr size_t PASS_GROUPS = 3;
+    static constexpr size_t SECTIONS_COUNT = LAYER_PASSES + Frame::LAYERS_COUNT * PASS_GROUPS;
+    static constexpr size_t FRAMES_IN_FLIGHT = 4;
+
+    static size_t layer_section(size_t layer, size_t pass_group);
+    static std::string section_name(size_t section);
+
+    GpuTimer() = default;
+    /// @note Needs GL context queries were created in
+    ~GpuTimer();
+
+    GpuTimer(const GpuTimer &) = delete;
+    GpuTimer &operator=(const GpuTimer &) = delete;
+
+    /// Finish measured frame, take finished results and start measuring next one if enabled
+    void new_frame(bool enabled);
+
+    /// Whether current frame is measured
+    bool active() const {
+        return active_ != nullptr;
+    }
+
+    /// Start measuring section, previous one is ended. Does nothing if frame isn't measured
+    void begin(size_t section);
+    void end();
+
+    /// Per frame milliseconds of each section, smoothed over recent frames
+    const std::array<float, SECTIONS_COUNT> &smoothed_ms() const {
+        return smoothed_ms_;
+    }
+
+    /// Frames with results taken
+    uint64_t measured_frames() const {
+        return measured_frames_;
+    }
+
+ private:
+    struct frame_t {
+        /// Grows to the most sections used by a frame, reused afterwards
+        std::vector<GLuint> queries;
+        std::vector<size_t> sections;
+        size_t used = 0;
+        bool pending = false;
+    };
+
+    /// @return false if GPU hasn't finished frame yet
+    bool collect(frame_t &frame);
+
+    std::array<frame_t, FRAMES_IN_FLIGHT> frames_;
+    /// Ring position of next frame
+    size_t next_frame_ = 0;
+    frame_t *active_ = nullptr;
+    bool query_running_ = false;
+
+    std::array<float, SECTIONS_COUNT> smoothed_ms_{};
+    uint64_t measured_frames_ = 0;
+};
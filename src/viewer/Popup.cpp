@@ -34,6 +34,18 @@ bool Popup::hit_test(glm::vec2 point) const {
     return diff.x <= half_width_ && diff.y <= half_height_;
 }
 
+bool Popup::is_circle() const {
+    return is_circle_;
+}
+
+glm::vec2 Popup::center() const {
+    return center_;
+}
+
+glm::vec2 Popup::half_size() const {
+    return {half_width_, half_height_};
+}
+
 const char* Popup::text() const {
     return text_.c_str();
 }
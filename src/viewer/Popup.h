@@ -15,6 +15,11 @@ class Popup {
 
     bool hit_test(glm::vec2 point) const;
 
+    bool is_circle() const;
+    glm::vec2 center() const;
+    /// Radius for circle
+    glm::vec2 half_size() const;
+
     const char *text() const;
 
  private:
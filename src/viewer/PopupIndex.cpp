@@ -0,0 +1,182 @@
+//
+// Created by valdemar on 18.10.26.
+//
+
+#include "PopupIndex.h"
+
+#include <cgutils/utils.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+/// Fewer popups are tested one by one
+constexpr size_t MIN_INDEXED_POPUPS = 64;
+/// Average popups per cell
+constexpr float POPUPS_PER_CELL = 4.0f;
+constexpr int MAX_GRID_SIDE = 256;
+/// Popups covering more cells are kept out of grid
+constexpr int MAX_POPUP_CELLS = 64;
+
+/// Popup bounds, slightly enlarged, so rounding never puts hit point outside of them
+void popup_bounds(const Popup &popup, glm::vec2 &min_corner, glm::vec2 &max_corner) {
+    const glm::vec2 center = popup.center();
+    const glm::vec2 half = glm::max(popup.half_size(), glm::vec2{0.0f});
+    const glm::vec2 eps = (glm::abs(center) + half) * 1e-6f;
+    min_corner = center - half - eps;
+    max_corner = center + half + eps;
+}
+
+}  // anonymous namespace
+
+void PopupIndex::shapes_t::resize(size_t count) {
+    center_x.resize(count);
+    center_y.resize(count);
+    half_width.resize(count);
+    half_height.resize(count);
+    circle.resize(count);
+    popup_idx.resize(count);
+}
+
+void PopupIndex::shapes_t::set(size_t pos, const Popup &popup, uint32_t idx) {
+    center_x[pos] = popup.center().x;
+    center_y[pos] = popup.center().y;
+    half_width[pos] = popup.half_size().x;
+    half_height[pos] = popup.half_size().y;
+    circle[pos] = popup.is_circle();
+    popup_idx[pos] = idx;
+}
+
+void PopupIndex::shapes_t::push(const Popup &popup, uint32_t idx) {
+    resize(popup_idx.size() + 1);
+    set(popup_idx.size() - 1, popup, idx);
+}
+
+void PopupIndex::shapes_t::test(size_t from, size_t to, glm::vec2 point,
+                                std::vector<uint32_t> &result) const {
+    // Masks computed in blocks without branches, so compiler vectorizes the loop
+    constexpr size_t BLOCK = 64;
+    std::array<uint8_t, BLOCK> hits;
+    for (size_t start = from; start < to; start += BLOCK) {
+        const size_t count = std::min(BLOCK, to - start);
+        for (size_t i = 0; i < count; ++i) {
+            const size_t k = start + i;
+            const float dx = std::abs(point.x - center_x[k]);
+            const float dy = std::abs(point.y - center_y[k]);
+            const bool in_circle = dx * dx + dy * dy <= half_width[k] * half_width[k];
+            const bool in_rect = (dx <= half_width[k]) & (dy <= half_height[k]);
+            hits[i] = static_cast<uint8_t>((circle[k] & in_circle) | (!circle[k] & in_rect));
+        }
+        for (size_t i = 0; i < count; ++i) {
+            if (hits[i]) {
+                result.push_back(popup_idx[start + i]);
+            }
+        }
+    }
+}
+
+void PopupIndex::build(const std::vector<Popup> &popups) {
+    clear();
+    indexed_count_ = popups.size();
+    if (popups.size() < MIN_INDEXED_POPUPS) {
+        for (size_t idx = 0; idx < popups.size(); ++idx) {
+            large_.push(popups[idx], static_cast<uint32_t>(idx));
+        }
+        return;
+    }
+
+    std::vector<glm::vec2> min_corners(popups.size());
+    std::vector<glm::vec2> max_corners(popups.size());
+    glm::vec2 lo{std::numeric_limits<float>::max()};
+    glm::vec2 hi{std::numeric_limits<float>::lowest()};
+    for (size_t idx = 0; idx < popups.size(); ++idx) {
+        popup_bounds(popups[idx], min_corners[idx], max_corners[idx]);
+        lo = glm::min(lo, min_corners[idx]);
+        hi = glm::max(hi, max_corners[idx]);
+    }
+
+    const auto side = cg::clamp(
+        static_cast<int>(std::sqrt(static_cast<float>(popups.size()) / POPUPS_PER_CELL)), 1,
+        MAX_GRID_SIDE);
+    origin_ = lo;
+    grid_size_ = glm::ivec2{side};
+    cell_size_ = glm::max((hi - lo) / static_cast<float>(side),
+                          glm::vec2{std::numeric_limits<float>::min()});
+
+    // Count entries of each cell, then place them
+    const size_t cells_count = static_cast<size_t>(side) * side;
+    cell_offsets_.assign(cells_count + 1, 0);
+    std::vector<uint8_t> in_grid(popups.size(), 0);
+    for (size_t idx = 0; idx < popups.size(); ++idx) {
+        const glm::ivec2 from = cell_of(min_corners[idx]);
+        const glm::ivec2 to = cell_of(max_corners[idx]);
+        if ((to.x - from.x + 1) * (to.y - from.y + 1) > MAX_POPUP_CELLS) {
+            large_.push(popups[idx], static_cast<uint32_t>(idx));
+            continue;
+        }
+        in_grid[idx] = 1;
+        for (int y = from.y; y <= to.y; ++y) {
+            for (int x = from.x; x <= to.x; ++x) {
+                ++cell_offsets_[static_cast<size_t>(y) * side + x + 1];
+            }
+        }
+    }
+    for (size_t c = 0; c < cells_count; ++c) {
+        cell_offsets_[c + 1] += cell_offsets_[c];
+    }
+
+    cells_.resize(cell_offsets_.back());
+    std::vector<uint32_t> fill_pos(cell_offsets_.begin(), cell_offsets_.end() - 1);
+    for (size_t idx = 0; idx < popups.size(); ++idx) {
+        if (!in_grid[idx]) {
+            continue;
+        }
+        const glm::ivec2 from = cell_of(min_corners[idx]);
+        const glm::ivec2 to = cell_of(max_corners[idx]);
+        for (int y = from.y; y <= to.y; ++y) {
+            for (int x = from.x; x <= to.x; ++x) {
+                const size_t c = static_cast<size_t>(y) * side + x;
+                cells_.set(fill_pos[c]++, popups[idx], static_cast<uint32_t>(idx));
+            }
+        }
+    }
+}
+
+void PopupIndex::clear() {
+    *this = PopupIndex{};
+}
+
+void PopupIndex::hit_test(const std::vector<Popup> &popups, glm::vec2 point,
+                          std::vector<uint32_t> &result) const {
+    const size_t first = result.size();
+    size_t indexed = indexed_count_;
+    if (indexed > popups.size()) {
+        // Popups were cleared without index, test everything
+        indexed = 0;
+    } else {
+        if (!cell_offsets_.empty()) {
+            const glm::ivec2 cell = cell_of(point);
+            const size_t c = static_cast<size_t>(cell.y) * grid_size_.x + cell.x;
+            cells_.test(cell_offsets_[c], cell_offsets_[c + 1], point, result);
+        }
+        const size_t grid_hits = result.size();
+        large_.test(0, large_.popup_idx.size(), point, result);
+        // Both parts are in order of popups
+        std::inplace_merge(result.begin() + first, result.begin() + grid_hits, result.end());
+    }
+    for (size_t idx = indexed; idx < popups.size(); ++idx) {
+        if (popups[idx].hit_test(point)) {
+            result.push_back(static_cast<uint32_t>(idx));
+        }
+    }
+}
+
+glm::ivec2 PopupIndex::cell_of(glm::vec2 point) const {
+    const glm::vec2 rel = glm::floor((point - origin_) / cell_size_);
+    // Compared as floats, far points may not fit into int
+    return {static_cast<int>(cg::clamp(rel.x, 0.0f, static_cast<float>(grid_size_.x - 1))),
+            static_cast<int>(cg::clamp(rel.y, 0.0f, static_cast<float>(grid_size_.y - 1)))};
+}
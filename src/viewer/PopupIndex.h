@@ -0,0 +1,62 @@
+//
+// Created by valdemar on 18.10.26.
+//
+
+#pragma once
+
+#include <viewer/Popup.h>
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * Uniform grid over popups of one layer for hover lookup.
+ * Each popup is stored in every cell its bounds overlap, so lookup tests only one cell.
+ * Shapes inside cell are kept as separate arrays, tested without branches.
+ * Popups added after build() are tested one by one.
+ */
+class PopupIndex {
+ public:
+    /// Index all popups, previous index dropped
+    void build(const std::vector<Popup> &popups);
+
+    void clear();
+
+    /// Append indices of popups containing point to result, in order popups were added
+    /// @param popups - the same popups index was built for, maybe with new ones appended
+    void hit_test(const std::vector<Popup> &popups, glm::vec2 point,
+                  std::vector<uint32_t> &result) const;
+
+ private:
+    /// Shapes of entries as separate arrays, radius of circle kept as half width
+    struct shapes_t {
+        std::vector<float> center_x;
+        std::vector<float> center_y;
+        std::vector<float> half_width;
+        std::vector<float> half_height;
+        std::vector<uint8_t> circle;
+        std::vector<uint32_t> popup_idx;
+
+        void resize(size_t count);
+        void set(size_t pos, const Popup &popup, uint32_t idx);
+        void push(const Popup &popup, uint32_t idx);
+
+        /// Append indices of entries in range [from, to) containing point
+        void test(size_t from, size_t to, glm::vec2 point, std::vector<uint32_t> &result) const;
+    };
+
+    /// Cell containing point, points outside of grid go to the nearest cell
+    glm::ivec2 cell_of(glm::vec2 point) const;
+
+    size_t indexed_count_ = 0;
+    glm::vec2 origin_{0.0f};
+    glm::vec2 cell_size_{1.0f};
+    glm::ivec2 grid_size_{0};
+    /// Entries of cell c are [cell_offsets_[c], cell_offsets_[c + 1])
+    std::vector<uint32_t> cell_offsets_;
+    shapes_t cells_;
+    /// Popups covering too many cells, tested on each lookup
+    shapes_t large_;
+};
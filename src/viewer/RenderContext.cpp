@@ -2,37 +2,371 @@
 // Created by valdemar on 10.02.2020.
 //
 
-#include "RenderContext.h"
-#include "ShaderCollection.h"
+#include "RenderContextImpl.h"
 
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <cmath>
+#include <limits>
 #include <stdexcept>
+#include <unordered_set>
 
-namespace {
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define RENDER_CONTEXT_AVX2
+#include <immintrin.h>
+#endif
+
+using namespace render_details;
 
-#pragma pack(push, 1)
-struct point_layout_t {
-    glm::vec4 color;
-    glm::vec2 point;
+namespace render_details {
+
+/// Primitives of one pass belonging to the same grid cell
+struct cell_range_t {
+    // Union of primitive bounds, may exceed cell itself
+    glm::vec2 min_corner;
+    glm::vec2 max_corner;
+    // Range in pass_index_t::primitives
+    size_t first;
+    size_t count;
 };
 
-struct circle_layout_t {
-    glm::vec4 color;
-    glm::vec2 point;
-    float radius;
+/// Spatial index of one pass, covers only first indexed_count elements,
+/// everything appended later is drawn without culling until index rebuilt
+struct pass_index_t {
+    std::vector<cell_range_t> cells;
+    // Primitive numbers grouped by cell, ascending inside each cell
+    std::vector<uint32_t> primitives;
+    size_t indexed_count = 0;
 };
 
-#pragma pack(pop)
+}  // namespace render_details
+
+namespace {
+
+/// Index grid resolution in each dimension
+constexpr size_t INDEX_GRID_SIZE = 16;
+/// Passes with fewer primitives are always drawn whole, culling is not worth it
+constexpr size_t INDEX_MIN_PRIMITIVES = 256;
+
+/// Reserve room for count more items keeping geometric growth, so repeated appends stay linear
+template <typename T>
+void reserve_more(std::vector<T> &to, size_t count) {
+    if (to.size() + count > to.capacity()) {
+        to.reserve(std::max(to.size() + count, 2 * to.capacity()));
+    }
+}
+
+void add_elements(size_t shift, std::vector<GLuint> &to, const GLuint *from, size_t count) {
+    reserve_more(to, count);
+    for (size_t i = 0; i < count; ++i) {
+        to.push_back(shift + from[i]);
+    }
+}
 
 void add_elements(size_t shift, std::vector<GLuint> &to, const std::vector<GLuint> &from) {
-    to.reserve(to.size() + from.size());
-    for (GLuint i : from) {
-        to.push_back(shift + i);
+    add_elements(shift, to, from.data(), from.size());
+}
+
+/// Commands looked back for the same pass to join, when adding elements to batch
+constexpr size_t MERGE_LOOKUP_COMMANDS = 64;
+/// Vertex ranges of context closer than that are copied to batch as one range
+constexpr size_t VERTEX_RANGE_GAP = 64;
+
+/// LOD levels generated only for contexts with at least that many primitives
+constexpr size_t LOD_MIN_PRIMITIVES = 1024;
+/// Screen resolution (in pixels per context extent) for each LOD level, from finest to coarsest
+constexpr std::array<float, 3> LOD_RESOLUTIONS = {{2048.0f, 512.0f, 128.0f}};
+/// Level stored only if it has at most that part of elements of previous stored level
+constexpr float LOD_MIN_REDUCTION = 0.9f;
+
+bool intersects(glm::vec2 min1, glm::vec2 max1, glm::vec2 min2, glm::vec2 max2) {
+    return min1.x <= max2.x && min2.x <= max1.x && min1.y <= max2.y && min2.y <= max1.y;
+}
+
+float segment_distance(glm::vec2 p, glm::vec2 a, glm::vec2 b) {
+    const glm::vec2 ab = b - a;
+    const float len2 = glm::dot(ab, ab);
+    if (len2 == 0.0f) {
+        return glm::distance(p, a);
+    }
+    const float t = cg::clamp(glm::dot(p - a, ab) / len2, 0.0f, 1.0f);
+    return glm::distance(p, a + ab * t);
+}
+
+/**
+ * Douglas-Peucker simplification of vertex chain
+ * @param chain - vertex indices, consecutive vertices connected by lines
+ * @param position - callable(GLuint) returning vertex position
+ * @return indices of chain elements to keep, first and last always kept
+ */
+template <typename PositionFn>
+std::vector<size_t> simplify_chain(const std::vector<GLuint> &chain, float epsilon,
+                                   PositionFn position) {
+    std::vector<bool> keep(chain.size(), false);
+    keep.front() = keep.back() = true;
+
+    std::vector<std::pair<size_t, size_t>> stack;
+    stack.emplace_back(0, chain.size() - 1);
+    while (!stack.empty()) {
+        const auto range = stack.back();
+        stack.pop_back();
+        const glm::vec2 a = position(chain[range.first]);
+        const glm::vec2 b = position(chain[range.second]);
+
+        float max_dist = -1.0f;
+        size_t max_idx = range.first;
+        for (size_t i = range.first + 1; i < range.second; ++i) {
+            const float dist = segment_distance(position(chain[i]), a, b);
+            if (dist > max_dist) {
+                max_dist = dist;
+                max_idx = i;
+            }
+        }
+        if (max_dist > epsilon) {
+            keep[max_idx] = true;
+            stack.emplace_back(range.first, max_idx);
+            stack.emplace_back(max_idx, range.second);
+        }
+    }
+
+    std::vector<size_t> result;
+    for (size_t i = 0; i < keep.size(); ++i) {
+        if (keep[i]) {
+            result.push_back(i);
+        }
+    }
+    return result;
+}
+
+/**
+ * Group primitives of pass by uniform grid cells (counting sort, so order inside cell preserved).
+ * Elements stay in submission order, because primitives of one kind overlap each other
+ * @param elements - pass elements
+ * @param prim_size - elements count per primitive
+ * @param bounds_of - callable(const GLuint *prim, glm::vec2 &min, glm::vec2 &max)
+ */
+template <typename BoundsFn>
+pass_index_t build_grid_index(const std::vector<GLuint> &elements, size_t prim_size,
+                              BoundsFn bounds_of) {
+    pass_index_t result;
+    const size_t prim_cnt = elements.size() / prim_size;
+    if (prim_cnt < INDEX_MIN_PRIMITIVES) {
+        return result;
+    }
+
+    std::vector<glm::vec2> prim_min(prim_cnt);
+    std::vector<glm::vec2> prim_max(prim_cnt);
+    glm::vec2 lo{std::numeric_limits<float>::max()};
+    glm::vec2 hi{std::numeric_limits<float>::lowest()};
+    for (size_t p = 0; p < prim_cnt; ++p) {
+        bounds_of(&elements[p * prim_size], prim_min[p], prim_max[p]);
+        lo = glm::min(lo, prim_min[p]);
+        hi = glm::max(hi, prim_max[p]);
+    }
+
+    constexpr size_t cells_cnt = INDEX_GRID_SIZE * INDEX_GRID_SIZE;
+    const glm::vec2 cell_size = glm::max((hi - lo) / static_cast<float>(INDEX_GRID_SIZE),
+                                         glm::vec2{std::numeric_limits<float>::epsilon()});
+    std::vector<uint16_t> prim_cell(prim_cnt);
+    std::array<size_t, cells_cnt + 1> offsets{};
+    for (size_t p = 0; p < prim_cnt; ++p) {
+        const glm::vec2 rel = ((prim_min[p] + prim_max[p]) * 0.5f - lo) / cell_size;
+        const auto cx = cg::clamp<size_t>(static_cast<size_t>(rel.x), 0, INDEX_GRID_SIZE - 1);
+        const auto cy = cg::clamp<size_t>(static_cast<size_t>(rel.y), 0, INDEX_GRID_SIZE - 1);
+        prim_cell[p] = static_cast<uint16_t>(cy * INDEX_GRID_SIZE + cx);
+        ++offsets[prim_cell[p] + 1];
+    }
+    for (size_t c = 0; c < cells_cnt; ++c) {
+        offsets[c + 1] += offsets[c];
+    }
+
+    for (size_t c = 0; c < cells_cnt; ++c) {
+        const size_t cnt = offsets[c + 1] - offsets[c];
+        if (cnt > 0) {
+            result.cells.push_back({hi, lo, offsets[c], cnt});
+        }
+    }
+
+    // Scatter primitives to their cells, accumulating cell bounds
+    result.primitives.resize(prim_cnt);
+    std::array<size_t, cells_cnt> fill_pos;
+    std::array<uint16_t, cells_cnt> cell_range_idx{};
+    for (size_t c = 0, r = 0; c < cells_cnt; ++c) {
+        fill_pos[c] = offsets[c];
+        if (offsets[c + 1] > offsets[c]) {
+            cell_range_idx[c] = static_cast<uint16_t>(r++);
+        }
+    }
+    for (size_t p = 0; p < prim_cnt; ++p) {
+        const uint16_t c = prim_cell[p];
+        result.primitives[fill_pos[c]++] = static_cast<uint32_t>(p);
+        auto &cell = result.cells[cell_range_idx[c]];
+        cell.min_corner = glm::min(cell.min_corner, prim_min[p]);
+        cell.max_corner = glm::max(cell.max_corner, prim_max[p]);
+    }
+
+    result.indexed_count = prim_cnt * prim_size;
+    return result;
+}
+
+/**
+ * Runs of consecutive pass primitives which may be visible in area, in submission order
+ * @param visible - scratch buffer, reused between calls
+ * @param on_run - callable(const GLuint *first, size_t count) called with elements of each run
+ */
+template <typename RunFn>
+void for_visible_runs(pass_t pass, const std::vector<GLuint> &elements, const pass_index_t &index,
+                      glm::vec2 view_min, glm::vec2 view_max, std::vector<uint32_t> &visible,
+                      RunFn on_run) {
+    visible.clear();
+    bool all_visible = true;
+    for (const auto &cell : index.cells) {
+        if (intersects(cell.min_corner, cell.max_corner, view_min, view_max)) {
+            visible.insert(visible.end(), &index.primitives[cell.first],
+                           &index.primitives[cell.first] + cell.count);
+        } else {
+            all_visible = false;
+        }
+    }
+    if (all_visible) {
+        if (!elements.empty()) {
+            on_run(elements.data(), elements.size());
+        }
+        return;
+    }
+
+    // Cells are mixed together, so restore order and join consecutive primitives
+    std::sort(visible.begin(), visible.end());
+    const size_t prim_size = primitive_size(pass);
+    for (size_t run_begin = 0, idx = 0; idx < visible.size(); ++idx) {
+        if (idx + 1 == visible.size() || visible[idx + 1] != visible[idx] + 1) {
+            const size_t run_len = idx + 1 - run_begin;
+            on_run(&elements[visible[run_begin] * prim_size], run_len * prim_size);
+            run_begin = idx + 1;
+        }
+    }
+    if (elements.size() > index.indexed_count) {
+        on_run(elements.data() + index.indexed_count, elements.size() - index.indexed_count);
+    }
+}
+
+/**
+ * Key of grid cell of given size containing point. Coordinates are clamped before conversion,
+ * so far off points share border cells instead of overflowing
+ */
+uint64_t pixel_cell(glm::vec2 point, float cell_size) {
+    constexpr float LIMIT = static_cast<float>(std::numeric_limits<int32_t>::max() / 2);
+    const glm::vec2 cell = glm::clamp(glm::floor(point / cell_size), -LIMIT, LIMIT);
+    const auto cell_x = static_cast<uint32_t>(static_cast<int32_t>(cell.x));
+    const auto cell_y = static_cast<uint32_t>(static_cast<int32_t>(cell.y));
+    return (static_cast<uint64_t>(cell_x) << 32u) | cell_y;
+}
+
+/// Unique for whole process, so contexts never share generation unless copied
+uint64_t next_generation() {
+    static std::atomic<uint64_t> counter{0};
+    return ++counter;
+}
+
+/// Uniform grid positions are binned into, out of grid positions go to trash bin past the end
+struct density_grid_t {
+    glm::vec2 origin;
+    glm::vec2 scale;
+    int32_t width;
+    int32_t height;
+    int32_t trash_bin;
+};
+
+/**
+ * Bin index of position. Relative position is clamped in float to [-1, size] before
+ * conversion, so far off and non-finite positions land out of grid without overflow
+ */
+inline int32_t density_bin(const density_grid_t &grid, float x, float y) {
+    const float rel_x = std::max(-1.0f, std::min((x - grid.origin.x) * grid.scale.x,
+                                                 static_cast<float>(grid.width)));
+    const float rel_y = std::max(-1.0f, std::min((y - grid.origin.y) * grid.scale.y,
+                                                 static_cast<float>(grid.height)));
+    const auto bin_x = static_cast<int32_t>(std::floor(rel_x));
+    const auto bin_y = static_cast<int32_t>(std::floor(rel_y));
+    const bool inside = bin_x >= 0 && bin_x < grid.width && bin_y >= 0 && bin_y < grid.height;
+    return inside ? bin_y * grid.width + bin_x : grid.trash_bin;
+}
+
+void density_bins_scalar(const density_grid_t &grid, const float *xs, const float *ys,
+                         size_t count, int32_t *bins) {
+    for (size_t idx = 0; idx < count; ++idx) {
+        bins[idx] = density_bin(grid, xs[idx], ys[idx]);
     }
 }
 
+#ifdef RENDER_CONTEXT_AVX2
+/// Eight positions per iteration, same result as density_bin()
+__attribute__((target("avx2"))) void density_bins_avx2(const density_grid_t &grid,
+                                                       const float *xs, const float *ys,
+                                                       size_t count, int32_t *bins) {
+    const __m256 origin_x = _mm256_set1_ps(grid.origin.x);
+    const __m256 origin_y = _mm256_set1_ps(grid.origin.y);
+    const __m256 scale_x = _mm256_set1_ps(grid.scale.x);
+    const __m256 scale_y = _mm256_set1_ps(grid.scale.y);
+    const __m256 max_x = _mm256_set1_ps(static_cast<float>(grid.width));
+    const __m256 max_y = _mm256_set1_ps(static_cast<float>(grid.height));
+    const __m256 min_rel = _mm256_set1_ps(-1.0f);
+    const __m256i width = _mm256_set1_epi32(grid.width);
+    const __m256i height = _mm256_set1_epi32(grid.height);
+    const __m256i below = _mm256_set1_epi32(-1);
+    const __m256i trash_bin = _mm256_set1_epi32(grid.trash_bin);
+
+    size_t idx = 0;
+    for (; idx + 8 <= count; idx += 8) {
+        __m256 rel_x = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(xs + idx), origin_x), scale_x);
+        __m256 rel_y = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(ys + idx), origin_y), scale_y);
+        // NaN turns into size here and into -1 in scalar version, both out of grid
+        rel_x = _mm256_max_ps(_mm256_min_ps(rel_x, max_x), min_rel);
+        rel_y = _mm256_max_ps(_mm256_min_ps(rel_y, max_y), min_rel);
+        const __m256i bin_x = _mm256_cvttps_epi32(_mm256_floor_ps(rel_x));
+        const __m256i bin_y = _mm256_cvttps_epi32(_mm256_floor_ps(rel_y));
+
+        const __m256i inside = _mm256_and_si256(
+            _mm256_and_si256(_mm256_cmpgt_epi32(bin_x, below), _mm256_cmpgt_epi32(width, bin_x)),
+            _mm256_and_si256(_mm256_cmpgt_epi32(bin_y, below),
+                             _mm256_cmpgt_epi32(height, bin_y)));
+        const __m256i bin = _mm256_add_epi32(_mm256_mullo_epi32(bin_y, width), bin_x);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(bins + idx),
+                            _mm256_blendv_epi8(trash_bin, bin, inside));
+    }
+    density_bins_scalar(grid, xs + idx, ys + idx, count - idx, bins + idx);
+}
+#endif
+
+using density_bins_fn_t = void (*)(const density_grid_t &, const float *, const float *, size_t,
+                                   int32_t *);
+
+density_bins_fn_t select_density_bins() {
+#ifdef RENDER_CONTEXT_AVX2
+    if (__builtin_cpu_supports("avx2")) {
+        return density_bins_avx2;
+    }
+#endif
+    return density_bins_scalar;
+}
+
+const density_bins_fn_t density_bins = select_density_bins();
+
 }  // anonymous namespace
 
+/// Simplified copy of context elements, used when zoomed out, references same vertex data
+struct lod_level_t {
+    // World size of screen pixel starting from which level may be used
+    float tolerance;
+    std::array<std::vector<GLuint>, PASSES_COUNT> elements;
+    std::array<pass_index_t, PASSES_COUNT> index;
+    // Full detail elements of each pass replaced by level, ones added later are drawn as is
+    std::array<size_t, PASSES_COUNT> covered_count{};
+    // Pass isn't reduced by level, full detail elements and index are used instead of a copy
+    std::array<bool, PASSES_COUNT> shared{};
+};
+
 struct RenderContext::memory_layout_t {
     std::vector<point_layout_t> points;
     std::vector<circle_layout_t> circles;
@@ -40,54 +374,214 @@ struct RenderContext::memory_layout_t {
     std::vector<GLuint> thin_circle_indicies;
     std::vector<GLuint> triangle_indicies;
     std::vector<GLuint> line_indicies;
-};
+    // Always empty in full detail, exist for uniform access by pass
+    std::vector<GLuint> circle_point_indicies;
+    std::vector<GLuint> point_indicies;
 
-RenderContext::context_vao_t RenderContext::create_gl_context(ResourceManager &res) {
-    RenderContext::context_vao_t ret{};
-
-    ret.common_ebo = res.gen_buffer();
-    // Initialize forward pass point vao
-    {
-        ret.point_vao = res.gen_vertex_array();
-        ret.point_vbo = res.gen_buffer();
-        glBindVertexArray(ret.point_vao);
-        glBindBuffer(GL_ARRAY_BUFFER, ret.point_vbo);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ret.common_ebo);
-        // Point layout of RenderContext: vec4 color, vec2 pos
-        const size_t stride = 6 * sizeof(float);
-        glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, stride, nullptr);
-        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, cg::offset<float>(4));
-        glEnableVertexAttribArray(0);
-        glEnableVertexAttribArray(1);
-        glBindVertexArray(0);
-    }
-
-    {
-        ret.circle_vao = res.gen_vertex_array();
-        ret.circle_vbo = res.gen_buffer();
-        glBindVertexArray(ret.circle_vao);
-        glBindBuffer(GL_ARRAY_BUFFER, ret.circle_vbo);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ret.common_ebo);
-        const size_t stride = 7 * sizeof(float);
-        glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, stride, nullptr);
-        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, cg::offset<float>(4));
-        glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, stride, cg::offset<float>(6));
-        glEnableVertexAttribArray(0);
-        glEnableVertexAttribArray(1);
-        glEnableVertexAttribArray(2);
-        glBindVertexArray(0);
-    }
-
-    return ret;
-}
+    std::array<pass_index_t, PASSES_COUNT> index;
+    // From finest to coarsest
+    std::vector<lod_level_t> lods;
+    // Changed by every modification, index isn't content so it keeps generation
+    uint64_t generation = next_generation();
+
+    const std::vector<GLuint> &elements(pass_t pass) const {
+        switch (pass) {
+            case pass_t::TRIANGLES: return triangle_indicies;
+            case pass_t::LINES: return line_indicies;
+            case pass_t::FILLED_CIRCLES: return filled_circle_indicies;
+            case pass_t::THIN_CIRCLES: return thin_circle_indicies;
+            case pass_t::CIRCLE_POINTS: return circle_point_indicies;
+            case pass_t::POINTS: return point_indicies;
+            case pass_t::PASSES_COUNT: break;
+        }
+        throw std::invalid_argument("Incorrect pass type");
+    }
+
+    std::vector<GLuint> &elements(pass_t pass) {
+        return const_cast<std::vector<GLuint> &>(
+            static_cast<const memory_layout_t *>(this)->elements(pass));
+    }
+
+    /// Spatial index of pass elements
+    pass_index_t index_pass(pass_t pass, const std::vector<GLuint> &pass_elements) const {
+        if (is_circle_pass(pass)) {
+            return build_grid_index(pass_elements, 1,
+                                    [this](const GLuint *prim, glm::vec2 &min_corner,
+                                           glm::vec2 &max_corner) {
+                                        const auto &circle = circles[prim[0]];
+                                        min_corner = circle.point - glm::vec2{circle.radius};
+                                        max_corner = circle.point + glm::vec2{circle.radius};
+                                    });
+        }
+
+        const size_t prim_size = primitive_size(pass);
+        return build_grid_index(
+            pass_elements, prim_size,
+            [this, prim_size](const GLuint *prim, glm::vec2 &min_corner, glm::vec2 &max_corner) {
+                min_corner = max_corner = points[prim[0]].point;
+                for (size_t i = 1; i < prim_size; ++i) {
+                    min_corner = glm::min(min_corner, points[prim[i]].point);
+                    max_corner = glm::max(max_corner, points[prim[i]].point);
+                }
+            });
+    }
+
+    /// Polylines simplified with given tolerance, chains restored from consecutive line elements.
+    /// Chains smaller than pixel become points, one point per pixel cell
+    void simplify_lines(float tolerance, lod_level_t &to,
+                        std::unordered_set<uint64_t> &occupied_cells) const {
+        auto &result = to.elements[static_cast<size_t>(pass_t::LINES)];
+        result.reserve(line_indicies.size());
+
+        const auto position = [this](GLuint idx) { return points[idx].point; };
+        std::vector<GLuint> chain;
+        const auto flush_chain = [&] {
+            if (chain.empty()) {
+                return;
+            }
+            glm::vec2 lo = position(chain[0]);
+            glm::vec2 hi = lo;
+            for (GLuint idx : chain) {
+                lo = glm::min(lo, position(idx));
+                hi = glm::max(hi, position(idx));
+            }
+            if (hi.x - lo.x < tolerance && hi.y - lo.y < tolerance) {
+                if (occupied_cells.insert(pixel_cell(lo, tolerance)).second) {
+                    to.elements[static_cast<size_t>(pass_t::POINTS)].push_back(chain[0]);
+                }
+            } else if (chain.size() > 2) {
+                const auto kept = simplify_chain(chain, tolerance, position);
+                for (size_t i = 1; i < kept.size(); ++i) {
+                    result.push_back(chain[kept[i - 1]]);
+                    result.push_back(chain[kept[i]]);
+                }
+            } else if (chain.size() == 2) {
+                result.push_back(chain[0]);
+                result.push_back(chain[1]);
+            }
+            chain.clear();
+        };
+
+        for (size_t i = 0; i + 1 < line_indicies.size(); i += 2) {
+            if (chain.empty() || chain.back() != line_indicies[i]) {
+                flush_chain();
+                chain.push_back(line_indicies[i]);
+            }
+            chain.push_back(line_indicies[i + 1]);
+        }
+        flush_chain();
+    }
+
+    /// Triangles smaller than pixel become points, one point per pixel cell, so dense clusters
+    /// of small rectangles and triangles are drawn as few points
+    void simplify_triangles(float tolerance, lod_level_t &to,
+                            std::unordered_set<uint64_t> &occupied_cells) const {
+        auto &big = to.elements[static_cast<size_t>(pass_t::TRIANGLES)];
+        for (size_t i = 0; i + 2 < triangle_indicies.size(); i += 3) {
+            const glm::vec2 a = points[triangle_indicies[i]].point;
+            const glm::vec2 b = points[triangle_indicies[i + 1]].point;
+            const glm::vec2 c = points[triangle_indicies[i + 2]].point;
+            const glm::vec2 lo = glm::min(a, glm::min(b, c));
+            const glm::vec2 hi = glm::max(a, glm::max(b, c));
+            if (hi.x - lo.x >= tolerance || hi.y - lo.y >= tolerance) {
+                big.insert(big.end(), &triangle_indicies[i], &triangle_indicies[i] + 3);
+            } else if (occupied_cells.insert(pixel_cell(lo, tolerance)).second) {
+                to.elements[static_cast<size_t>(pass_t::POINTS)].push_back(triangle_indicies[i]);
+            }
+        }
+    }
+
+    /// Keep circles bigger than pixel, smaller ones become points, one point per pixel cell
+    void simplify_circles(float tolerance, lod_level_t &to) const {
+        std::unordered_set<uint64_t> occupied_cells;
+        const auto simplify = [&](const std::vector<GLuint> &from, std::vector<GLuint> &big) {
+            for (GLuint idx : from) {
+                const auto &circle = circles[idx];
+                if (circle.radius * 2.0f >= tolerance) {
+                    big.push_back(idx);
+                    continue;
+                }
+                if (occupied_cells.insert(pixel_cell(circle.point, tolerance)).second) {
+                    to.elements[static_cast<size_t>(pass_t::CIRCLE_POINTS)].push_back(idx);
+                }
+            }
+        };
+        simplify(filled_circle_indicies, to.elements[static_cast<size_t>(pass_t::FILLED_CIRCLES)]);
+        simplify(thin_circle_indicies, to.elements[static_cast<size_t>(pass_t::THIN_CIRCLES)]);
+    }
+
+    void build_lods() {
+        lods.clear();
+        const size_t primitives_cnt = triangle_indicies.size() / 3 + line_indicies.size() / 2 +
+                                      filled_circle_indicies.size() + thin_circle_indicies.size();
+        if (primitives_cnt < LOD_MIN_PRIMITIVES) {
+            return;
+        }
+
+        glm::vec2 lo{std::numeric_limits<float>::max()};
+        glm::vec2 hi{std::numeric_limits<float>::lowest()};
+        for (const auto &pt : points) {
+            lo = glm::min(lo, pt.point);
+            hi = glm::max(hi, pt.point);
+        }
+        for (const auto &circle : circles) {
+            lo = glm::min(lo, circle.point - glm::vec2{circle.radius});
+            hi = glm::max(hi, circle.point + glm::vec2{circle.radius});
+        }
+        const float extent = std::max(hi.x - lo.x, hi.y - lo.y);
+        if (extent <= 0.0f) {
+            return;
+        }
+
+        size_t prev_elements_cnt = triangle_indicies.size() + line_indicies.size() +
+                                   filled_circle_indicies.size() + thin_circle_indicies.size();
+        for (float resolution : LOD_RESOLUTIONS) {
+            lod_level_t level;
+            level.tolerance = extent / resolution;
+            // Triangles and polylines share pixel cells, both are drawn as points of the same pass
+            std::unordered_set<uint64_t> occupied_cells;
+            simplify_triangles(level.tolerance, level, occupied_cells);
+            simplify_lines(level.tolerance, level, occupied_cells);
+            simplify_circles(level.tolerance, level);
+
+            size_t elements_cnt = 0;
+            for (const auto &pass_elements : level.elements) {
+                elements_cnt += pass_elements.size();
+            }
+            if (elements_cnt > prev_elements_cnt * LOD_MIN_REDUCTION) {
+                // Not worth memory, try coarser level
+                continue;
+            }
+            prev_elements_cnt = elements_cnt;
+
+            for (size_t idx = 0; idx < PASSES_COUNT; ++idx) {
+                const auto pass = static_cast<pass_t>(idx);
+                // Elements are kept in order, so nothing removed if count is the same
+                if (level.elements[idx].size() == elements(pass).size()) {
+                    level.shared[idx] = true;
+                    level.elements[idx] = std::vector<GLuint>();
+                    continue;
+                }
+                level.index[idx] = index_pass(pass, level.elements[idx]);
+                level.covered_count[idx] = elements(pass).size();
+            }
+            lods.emplace_back(std::move(level));
+        }
+    }
+};
 
 RenderContext::RenderContext() {
     impl_ = std::make_unique<memory_layout_t>();
 }
 
+RenderContext::RenderContext(const RenderContext &other) {
+    impl_ = std::make_unique<memory_layout_t>(*other.impl_);
+}
+
 RenderContext::~RenderContext() = default;
 
 void RenderContext::add_circle(glm::vec2 center, float r, glm::vec4 color, bool fill) {
+    impl_->generation = next_generation();
     GLuint idx = impl_->circles.size();
     impl_->circles.push_back({color, center, r});
     if (fill) {
@@ -113,6 +607,7 @@ void RenderContext::add_polyline(const std::vector<glm::vec2> &points, glm::vec4
     if (points.size() < 2) {
         throw std::invalid_argument("Cannot create polyline from one point");
     }
+    impl_->generation = next_generation();
 
     impl_->points.push_back({color, points[0]});
     for (size_t i = 1; i < points.size(); ++i) {
@@ -128,6 +623,7 @@ void RenderContext::add_polyline(const std::vector<glm::vec2> &points, glm::vec4
 void RenderContext::add_triangle(glm::vec2 p1, glm::vec2 p2, glm::vec2 p3,
                                  const TriangleColors &colors, bool fill) {
     if (fill) {
+        impl_->generation = next_generation();
         GLuint idx = impl_->points.size();
         impl_->points.push_back({colors[0], p1});
         impl_->points.push_back({colors[1], p2});
@@ -146,6 +642,7 @@ void RenderContext::add_rectangle(glm::vec2 top_left, glm::vec2 bottom_right,
     auto bottom_left = glm::vec2{top_left.x, bottom_right.y};
 
     if (fill) {
+        impl_->generation = next_generation();
         GLuint idx = impl_->points.size();
         impl_->points.push_back({colors[0], top_left});
         impl_->points.push_back({colors[1], bottom_left});
@@ -161,11 +658,16 @@ void RenderContext::add_rectangle(glm::vec2 top_left, glm::vec2 bottom_right,
 }
 
 void RenderContext::update_from(const RenderContext &other) {
+    if (other.empty()) {
+        return;
+    }
+    impl_->generation = next_generation();
+
     const size_t points_cnt = impl_->points.size();
     add_elements(points_cnt, impl_->line_indicies, other.impl_->line_indicies);
     add_elements(points_cnt, impl_->triangle_indicies, other.impl_->triangle_indicies);
 
-    impl_->points.reserve(points_cnt + other.impl_->points.size());
+    reserve_more(impl_->points, other.impl_->points.size());
     for (auto &obj : other.impl_->points) {
         impl_->points.emplace_back(obj);
     }
@@ -174,7 +676,7 @@ void RenderContext::update_from(const RenderContext &other) {
     add_elements(circles_cnt, impl_->thin_circle_indicies, other.impl_->thin_circle_indicies);
     add_elements(circles_cnt, impl_->filled_circle_indicies, other.impl_->filled_circle_indicies);
 
-    impl_->circles.reserve(circles_cnt + other.impl_->circles.size());
+    reserve_more(impl_->circles, other.impl_->circles.size());
     for (auto &obj : other.impl_->circles) {
         impl_->circles.emplace_back(obj);
     }
@@ -184,59 +686,504 @@ void RenderContext::clear() {
     (*impl_) = memory_layout_t();
 }
 
-void RenderContext::draw(const RenderContext::context_vao_t &vaos,
-                         const ShaderCollection &shaders) const {
-    glCheckError();
-    // glLineWidth(2);
-    // glEnable(GL_LINE_SMOOTH);
-
-    // Load data
-    glBindBuffer(GL_ARRAY_BUFFER, vaos.point_vbo);
-    glBufferData(GL_ARRAY_BUFFER, impl_->points.size() * sizeof(point_layout_t),
-                 impl_->points.data(), GL_DYNAMIC_DRAW);
-
-    glBindBuffer(GL_ARRAY_BUFFER, vaos.circle_vbo);
-    glBufferData(GL_ARRAY_BUFFER, impl_->circles.size() * sizeof(circle_layout_t),
-                 impl_->circles.data(), GL_DYNAMIC_DRAW);
-
-    // Simple pass shader - triangles and lines
-    shaders.color_pos.use();
-    glBindVertexArray(vaos.point_vao);
-    {
-        // Filled triangles, so any polygon
-        const auto &triangle_elements = impl_->triangle_indicies;
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, triangle_elements.size() * sizeof(GLuint),
-                     triangle_elements.data(), GL_DYNAMIC_DRAW);
-        glDrawElements(GL_TRIANGLES, triangle_elements.size(), GL_UNSIGNED_INT, nullptr);
-
-        // Lines
-        const auto &line_elements = impl_->line_indicies;
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, line_elements.size() * sizeof(GLuint),
-                     line_elements.data(), GL_DYNAMIC_DRAW);
-        glDrawElements(GL_LINES, line_elements.size(), GL_UNSIGNED_INT, nullptr);
-    }
-
-    // Circles shader
-    shaders.circle.use();
-    glBindVertexArray(vaos.circle_vao);
-    {
-        // Filled
-        shaders.circle.set_uint("line_width", 0);
-        const auto &fill_circle_elements = impl_->filled_circle_indicies;
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, fill_circle_elements.size() * sizeof(GLuint),
-                     fill_circle_elements.data(), GL_DYNAMIC_DRAW);
-        glDrawElements(GL_POINTS, fill_circle_elements.size(), GL_UNSIGNED_INT, nullptr);
-
-        // Thin
-        shaders.circle.set_uint("line_width", 1);
-        const auto &thin_circle_elements = impl_->thin_circle_indicies;
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, thin_circle_elements.size() * sizeof(GLuint),
-                     thin_circle_elements.data(), GL_DYNAMIC_DRAW);
-        glDrawElements(GL_POINTS, thin_circle_elements.size(), GL_UNSIGNED_INT, nullptr);
-    }
-
-    // glLineWidth(1);
-    // glDisable(GL_LINE_SMOOTH);
-    glBindVertexArray(0);
-    glCheckError();
+bool RenderContext::empty() const {
+    return impl_->points.empty() && impl_->circles.empty();
+}
+
+size_t RenderContext::vertices_count() const {
+    return impl_->points.size() + impl_->circles.size();
+}
+
+uint64_t RenderContext::generation() const {
+    return impl_->generation;
+}
+
+size_t RenderContext::primitives_count(primitive_t kind) const {
+    switch (kind) {
+        case primitive_t::TRIANGLE: return impl_->triangle_indicies.size() / 3;
+        case primitive_t::LINE: return impl_->line_indicies.size() / 2;
+        case primitive_t::FILLED_CIRCLE: return impl_->filled_circle_indicies.size();
+        case primitive_t::THIN_CIRCLE: return impl_->thin_circle_indicies.size();
+    }
+    return 0;
+}
+
+size_t RenderContext::vertex_bytes() const {
+    return impl_->points.size() * sizeof(point_layout_t) +
+           impl_->circles.size() * sizeof(circle_layout_t);
+}
+
+bool RenderContext::extend_bounds(glm::vec2 &min_corner, glm::vec2 &max_corner) const {
+    if (empty()) {
+        return false;
+    }
+    for (const auto &point : impl_->points) {
+        min_corner = glm::min(min_corner, point.point);
+        max_corner = glm::max(max_corner, point.point);
+    }
+    for (const auto &circle : impl_->circles) {
+        min_corner = glm::min(min_corner, circle.point - circle.radius);
+        max_corner = glm::max(max_corner, circle.point + circle.radius);
+    }
+    return true;
+}
+
+void RenderContext::accumulate_density(glm::vec2 area_min, glm::vec2 area_max, glm::u32vec2 size,
+                                       float *bins) const {
+    const auto &from = *impl_;
+    density_grid_t grid;
+    grid.origin = area_min;
+    grid.scale = glm::vec2{size} / (area_max - area_min);
+    grid.width = static_cast<int32_t>(size.x);
+    grid.height = static_cast<int32_t>(size.y);
+    grid.trash_bin = grid.width * grid.height;
+
+    // One position per primitive, in separate coordinate arrays for SIMD binning
+    const size_t count = from.triangle_indicies.size() / 3 + from.line_indicies.size() / 2 +
+                         from.filled_circle_indicies.size() + from.thin_circle_indicies.size();
+    std::vector<float> xs;
+    std::vector<float> ys;
+    xs.reserve(count);
+    ys.reserve(count);
+    const auto add_centers = [&](const std::vector<GLuint> &elements, size_t per_primitive) {
+        const float weight = 1.0f / static_cast<float>(per_primitive);
+        for (size_t i = 0; i + per_primitive <= elements.size(); i += per_primitive) {
+            glm::vec2 sum{0.0f};
+            for (size_t k = 0; k < per_primitive; ++k) {
+                sum += from.points[elements[i + k]].point;
+            }
+            xs.push_back(sum.x * weight);
+            ys.push_back(sum.y * weight);
+        }
+    };
+    const auto add_circles = [&](const std::vector<GLuint> &elements) {
+        for (GLuint idx : elements) {
+            xs.push_back(from.circles[idx].point.x);
+            ys.push_back(from.circles[idx].point.y);
+        }
+    };
+    add_centers(from.triangle_indicies, 3);
+    add_centers(from.line_indicies, 2);
+    add_circles(from.filled_circle_indicies);
+    add_circles(from.thin_circle_indicies);
+
+    // Bin computation has no branches and is vectorized, scatter stays scalar
+    std::vector<int32_t> bin_idx(xs.size());
+    density_bins(grid, xs.data(), ys.data(), xs.size(), bin_idx.data());
+    for (int32_t idx : bin_idx) {
+        if (idx != grid.trash_bin) {
+            bins[idx] += 1.0f;
+        }
+    }
+}
+
+void RenderContext::visit_primitives(const primitive_visitor_t &visitor) const {
+    const auto &points = impl_->points;
+    vertex_t vertices[3];
+    const auto visit_points = [&](primitive_t kind, const std::vector<GLuint> &elements,
+                                  size_t per_primitive) {
+        for (size_t i = 0; i + per_primitive <= elements.size(); i += per_primitive) {
+            for (size_t k = 0; k < per_primitive; ++k) {
+                const auto &point = points[elements[i + k]];
+                vertices[k] = {point.color, point.point};
+            }
+            visitor(kind, vertices, 0.0f);
+        }
+    };
+    const auto visit_circles = [&](primitive_t kind, const std::vector<GLuint> &elements) {
+        for (GLuint idx : elements) {
+            const auto &circle = impl_->circles[idx];
+            vertices[0] = {circle.color, circle.point};
+            visitor(kind, vertices, circle.radius);
+        }
+    };
+
+    visit_points(primitive_t::TRIANGLE, impl_->triangle_indicies, 3);
+    visit_points(primitive_t::LINE, impl_->line_indicies, 2);
+    visit_circles(primitive_t::FILLED_CIRCLE, impl_->filled_circle_indicies);
+    visit_circles(primitive_t::THIN_CIRCLE, impl_->thin_circle_indicies);
+}
+
+void RenderContext::build_index() {
+    impl_->build_lods();
+    for (size_t idx = 0; idx < PASSES_COUNT; ++idx) {
+        const auto pass = static_cast<pass_t>(idx);
+        impl_->index[idx] = impl_->index_pass(pass, impl_->elements(pass));
+    }
+}
+
+void RenderContext::Batch::batch_data_t::add_culled_pass(pass_t pass,
+                                                         const std::vector<GLuint> &from,
+                                                         const pass_index_t &index) {
+    for_visible_runs(pass, from, index, view_min, view_max, visible,
+                     [this, pass](const GLuint *run, size_t count) {
+                         add_run(pass, run, count);
+                     });
+}
+
+template <typename Layout>
+void RenderContext::Batch::batch_data_t::copy_ranges(std::vector<vertex_range_t> &ranges,
+                                                     const std::vector<Layout> &from,
+                                                     std::vector<Layout> &to) {
+    std::sort(ranges.begin(), ranges.end(),
+              [](const auto &lhs, const auto &rhs) { return lhs.first < rhs.first; });
+    size_t merged = 0;
+    for (size_t idx = 0; idx < ranges.size(); ++idx) {
+        if (merged > 0 && ranges[idx].first <= ranges[merged - 1].last + VERTEX_RANGE_GAP) {
+            ranges[merged - 1].last = std::max(ranges[merged - 1].last, ranges[idx].last);
+        } else {
+            ranges[merged++] = ranges[idx];
+        }
+    }
+    ranges.resize(merged);
+    for (auto &range : ranges) {
+        range.batch_first = to.size();
+        to.insert(to.end(), from.begin() + range.first, from.begin() + range.last + 1);
+    }
+}
+
+void RenderContext::Batch::batch_data_t::flush_runs(const memory_layout_t &from) {
+    point_ranges.clear();
+    circle_ranges.clear();
+    for (const auto &run : runs) {
+        const auto minmax = std::minmax_element(run.elements, run.elements + run.count);
+        auto &ranges = is_circle_pass(run.pass) ? circle_ranges : point_ranges;
+        ranges.push_back({*minmax.first, *minmax.second, 0});
+    }
+    copy_ranges(point_ranges, from.points, points);
+    copy_ranges(circle_ranges, from.circles, circles);
+
+    for (const auto &run : runs) {
+        const bool circle = is_circle_pass(run.pass);
+        const auto &ranges = circle ? circle_ranges : point_ranges;
+        const auto range = std::upper_bound(ranges.begin(), ranges.end(), run.elements[0],
+                                            [](GLuint value, const vertex_range_t &item) {
+                                                return value < item.first;
+                                            }) -
+                           1;
+        // Unsigned wrap around gives the right element even if range moved to lower index
+        const size_t shift = range->batch_first - range->first;
+
+        glm::vec2 min_corner{std::numeric_limits<float>::max()};
+        glm::vec2 max_corner{std::numeric_limits<float>::lowest()};
+        for (size_t idx = 0; idx < run.count; ++idx) {
+            if (circle) {
+                const auto &item = from.circles[run.elements[idx]];
+                min_corner = glm::min(min_corner, item.point - item.radius);
+                max_corner = glm::max(max_corner, item.point + item.radius);
+            } else {
+                const auto &item = from.points[run.elements[idx]];
+                min_corner = glm::min(min_corner, item.point);
+                max_corner = glm::max(max_corner, item.point);
+            }
+        }
+        add_pass(run.pass, shift, run.elements, run.count, min_corner, max_corner);
+    }
+    runs.clear();
+}
+
+void RenderContext::Batch::batch_data_t::add_pass(pass_t pass, size_t shift, const GLuint *from,
+                                                  size_t count, glm::vec2 min_corner,
+                                                  glm::vec2 max_corner) {
+    const size_t first = staged.size();
+    add_elements(shift, staged, from, count);
+
+    // Latest command of the same pass may take elements if nothing drawn after it overlaps
+    // them, so interleaved layers don't multiply draw calls. Lines and circle outlines may
+    // touch neighbour pixel, so bounds are compared with one pixel margin. Without known pixel
+    // size only the latest command may take elements
+    const glm::vec2 margin{pixel_size};
+    const size_t barrier = splits.empty() ? 0 : splits.back();
+    const size_t lookup = pixel_size > 0.0f ? MERGE_LOOKUP_COMMANDS : 1;
+    const size_t lookup_end =
+        commands.size() > barrier + lookup ? commands.size() - lookup : barrier;
+    draw_cmd_t *target = nullptr;
+    for (size_t idx = commands.size(); idx > lookup_end; --idx) {
+        auto &cmd = commands[idx - 1];
+        if (cmd.pass == pass && (!split_tags || cmd.tag == tag)) {
+            target = &cmd;
+            break;
+        }
+        if (intersects(cmd.min_corner, cmd.max_corner, min_corner - margin,
+                       max_corner + margin)) {
+            break;
+        }
+    }
+
+    if (!target) {
+        chunks.push_back({first, count, NO_CHUNK});
+        commands.push_back({pass, first, count, 0, tag, min_corner, max_corner,
+                            chunks.size() - 1, chunks.size() - 1});
+        return;
+    }
+
+    auto &last = chunks[target->last_chunk];
+    if (last.first + last.count == first) {
+        last.count += count;
+    } else {
+        last.next = chunks.size();
+        target->last_chunk = chunks.size();
+        chunks.push_back({first, count, NO_CHUNK});
+        reordered = true;
+    }
+    target->count += count;
+    target->min_corner = glm::min(target->min_corner, min_corner);
+    target->max_corner = glm::max(target->max_corner, max_corner);
+}
+
+void RenderContext::Batch::batch_data_t::layout_elements() {
+    if (!reordered) {
+        elements.swap(staged);
+        return;
+    }
+    elements.clear();
+    elements.reserve(staged.size());
+    for (auto &cmd : commands) {
+        cmd.first = elements.size();
+        for (size_t chunk = cmd.first_chunk; chunk != NO_CHUNK; chunk = chunks[chunk].next) {
+            const auto &range = chunks[chunk];
+            elements.insert(elements.end(), staged.begin() + range.first,
+                            staged.begin() + range.first + range.count);
+        }
+    }
+    staged.clear();
+}
+
+void RenderContext::Batch::batch_data_t::gather_instances() {
+    instances.clear();
+    for (auto &cmd : commands) {
+        if (!is_circle_shader_pass(cmd.pass)) {
+            continue;
+        }
+        cmd.first_instance = instances.size();
+        for (size_t i = cmd.first; i < cmd.first + cmd.count; ++i) {
+            instances.push_back(circles[elements[i]]);
+        }
+    }
+}
+
+RenderContext::Batch::Batch() {
+    impl_ = std::make_unique<batch_data_t>();
+}
+
+RenderContext::Batch::~Batch() = default;
+
+void RenderContext::Batch::set_visible_area(glm::vec2 min_corner, glm::vec2 max_corner) {
+    impl_->view_min = min_corner;
+    impl_->view_max = max_corner;
+}
+
+void RenderContext::Batch::set_pixel_size(float world_size) {
+    impl_->pixel_size = world_size;
+}
+
+void RenderContext::Batch::set_lod_enabled(bool enabled) {
+    impl_->lod_enabled = enabled;
+}
+
+void RenderContext::Batch::set_split_tags(bool split) {
+    impl_->split_tags = split;
+}
+
+void RenderContext::Batch::add(const RenderContext &ctx, uint32_t tag) {
+    const auto &from = *ctx.impl_;
+    impl_->tag = tag;
+
+    // Coarsest level which error still fits in one pixel
+    const lod_level_t *lod = nullptr;
+    for (const auto &level : from.lods) {
+        if (impl_->lod_enabled && level.tolerance <= impl_->pixel_size) {
+            lod = &level;
+        }
+    }
+
+    // Same order as for single context: triangles, lines, filled and thin circles
+    for (size_t idx = 0; idx < PASSES_COUNT; ++idx) {
+        const auto pass = static_cast<pass_t>(idx);
+        const auto &elements = from.elements(pass);
+        if (lod && !lod->shared[idx]) {
+            // Level replaces full detail elements, so they are never culled and drawn both
+            impl_->add_culled_pass(pass, lod->elements[idx], lod->index[idx]);
+            const size_t covered = lod->covered_count[idx];
+            impl_->add_run(pass, elements.data() + covered, elements.size() - covered);
+        } else {
+            impl_->add_culled_pass(pass, elements, from.index[idx]);
+        }
+    }
+    // Only vertices of selected elements are copied and uploaded later
+    impl_->flush_runs(from);
+}
+
+size_t RenderContext::Batch::split() {
+    impl_->splits.push_back(impl_->commands.size());
+    return impl_->splits.size() - 1;
+}
+
+void RenderContext::Batch::clear() {
+    impl_->clear();
+}
+
+const RenderContext::Batch::draw_stats_t &RenderContext::Batch::last_stats() const {
+    return impl_->stats;
+}
+
+RenderContext::Batch::draw_stats_t RenderContext::Batch::queued_stats() const {
+    draw_stats_t stats;
+    stats.elements = impl_->staged.size() + impl_->elements.size();
+    stats.draw_calls = impl_->commands.size();
+    stats.vertex_bytes = impl_->points.size() * sizeof(point_layout_t) +
+                         impl_->circles.size() * sizeof(circle_layout_t);
+    return stats;
+}
+
+void RenderContext::PickBatch::pick_data_t::add_command(pass_t pass, size_t first, size_t count,
+                                                        uint32_t id_base) {
+    if (!commands.empty()) {
+        auto &last = commands.back();
+        if (last.pass == pass && last.first + last.count == first) {
+            last.count += count;
+            return;
+        }
+    }
+    commands.push_back({pass, first, count, id_base});
+}
+
+size_t RenderContext::PickBatch::pick_data_t::add_primitive(
+    pass_t pass, const std::vector<GLuint> &from, const std::vector<point_layout_t> &from_points,
+    size_t pos, uint32_t tag) {
+    const size_t prim_size = primitive_size(pass);
+    const size_t prim_cnt = from.size() / prim_size;
+    const auto range_of = [&](size_t prim) {
+        const auto minmax =
+            std::minmax_element(&from[prim * prim_size], &from[prim * prim_size] + prim_size);
+        return std::make_pair(*minmax.first, *minmax.second);
+    };
+    auto range = range_of(pos);
+    const auto joins = [&](size_t prim) {
+        const auto other = range_of(prim);
+        if (other.second < range.first || other.first > range.second) {
+            return false;
+        }
+        range.first = std::min(range.first, other.first);
+        range.second = std::max(range.second, other.second);
+        return true;
+    };
+    size_t first = pos;
+    size_t last = pos + 1;
+    while (first > 0 && joins(first - 1)) {
+        --first;
+    }
+    while (last < prim_cnt && joins(last)) {
+        ++last;
+    }
+
+    const glm::vec4 id_color = encode_id(next_id());
+    const size_t vertices_cnt = range.second - range.first + 1;
+    primitives.push_back({pass, points.size(), vertices_cnt, tag});
+    // Unsigned wrap around gives the right element even if vertices moved to lower index
+    const size_t shift = points.size() - range.first;
+    for (GLuint idx = range.first; idx <= range.second; ++idx) {
+        points.push_back(from_points[idx]);
+        id_points.push_back({id_color, from_points[idx].point});
+    }
+    const size_t elements_first = elements.size();
+    add_elements(shift, elements, &from[first * prim_size], (last - first) * prim_size);
+    add_command(pass, elements_first, (last - first) * prim_size, 0);
+    return last;
+}
+
+glm::vec4 RenderContext::PickBatch::pick_data_t::encode_id(uint32_t id) {
+    return glm::vec4{static_cast<float>(id & 0xFFu), static_cast<float>((id >> 8) & 0xFFu),
+                     static_cast<float>((id >> 16) & 0xFFu),
+                     static_cast<float>((id >> 24) & 0xFFu)} /
+           255.0f;
+}
+
+RenderContext::PickBatch::PickBatch() {
+    impl_ = std::make_unique<pick_data_t>();
+}
+
+RenderContext::PickBatch::~PickBatch() = default;
+
+void RenderContext::PickBatch::set_visible_area(glm::vec2 min_corner, glm::vec2 max_corner) {
+    impl_->view_min = min_corner;
+    impl_->view_max = max_corner;
+}
+
+void RenderContext::PickBatch::add(const RenderContext &ctx, uint32_t tag) {
+    const auto &from = *ctx.impl_;
+    auto &to = *impl_;
+
+    for (const auto pass : {pass_t::TRIANGLES, pass_t::LINES, pass_t::FILLED_CIRCLES,
+                            pass_t::THIN_CIRCLES}) {
+        const auto &elements = from.elements(pass);
+        const auto &index = from.index[static_cast<size_t>(pass)];
+        if (is_circle_pass(pass)) {
+            for_visible_runs(pass, elements, index, to.view_min, to.view_max, to.visible,
+                             [&](const GLuint *run, size_t count) {
+                                 to.add_command(pass, to.instances.size(), count, to.next_id());
+                                 for (size_t i = 0; i < count; ++i) {
+                                     to.primitives.push_back({pass, to.instances.size(), 1, tag});
+                                     to.instances.push_back(from.circles[run[i]]);
+                                 }
+                             });
+            continue;
+        }
+
+        const size_t prim_size = primitive_size(pass);
+        // Primitive may span several runs, its GL primitives are added once
+        size_t added_end = 0;
+        for_visible_runs(pass, elements, index, to.view_min, to.view_max, to.visible,
+                         [&](const GLuint *run, size_t count) {
+                             const size_t run_first = (run - elements.data()) / prim_size;
+                             const size_t run_end = run_first + count / prim_size;
+                             for (size_t pos = std::max(run_first, added_end); pos < run_end;
+                                  pos = added_end) {
+                                 added_end = to.add_primitive(pass, elements, from.points, pos,
+                                                              tag);
+                             }
+                         });
+    }
+}
+
+void RenderContext::PickBatch::clear() {
+    impl_->clear();
+}
+
+bool RenderContext::PickBatch::lookup(uint32_t id, RenderContext::picked_t &result) const {
+    const auto &data = *impl_;
+    if (id == 0 || id > data.primitives.size()) {
+        return false;
+    }
+    const auto &prim = data.primitives[id - 1];
+
+    result.tag = prim.tag;
+    result.radius = 0.0f;
+    result.vertices.clear();
+    switch (prim.pass) {
+        case pass_t::TRIANGLES:
+        case pass_t::LINES:
+            result.kind =
+                prim.pass == pass_t::TRIANGLES ? primitive_t::TRIANGLE : primitive_t::LINE;
+            for (size_t idx = prim.first; idx < prim.first + prim.count; ++idx) {
+                result.vertices.push_back({data.points[idx].color, data.points[idx].point});
+            }
+            break;
+        case pass_t::FILLED_CIRCLES:
+        case pass_t::THIN_CIRCLES: {
+            const auto &circle = data.instances[prim.first];
+            result.kind = prim.pass == pass_t::FILLED_CIRCLES ? primitive_t::FILLED_CIRCLE
+                                                              : primitive_t::THIN_CIRCLE;
+            result.vertices.push_back({circle.color, circle.point});
+            result.radius = circle.radius;
+            break;
+        }
+        default: return false;
+    }
+    return true;
+}
+
+uint32_t RenderContext::PickBatch::decode_id(const uint8_t *rgba) {
+    return static_cast<uint32_t>(rgba[0]) | static_cast<uint32_t>(rgba[1]) << 8 |
+           static_cast<uint32_t>(rgba[2]) << 16 | static_cast<uint32_t>(rgba[3]) << 24;
 }
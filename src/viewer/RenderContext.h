@@ -8,28 +8,51 @@
 
 #include <glm/glm.hpp>
 
+#include <array>
+#include <cstdint>
+#include <functional>
 #include <memory>
 #include <vector>
 
 struct ShaderCollection;
+class GpuTimer;
 
 /**
  * RenderContext
  */
+
 class RenderContext {
  public:
     struct context_vao_t {
         GLuint point_vao;
         GLuint circle_vao;
+        GLuint circle_instanced_vao;
 
         GLuint point_vbo;
         GLuint circle_vbo;
+        // Circles in draw order, one per instance
+        GLuint circle_instance_vbo;
+        GLuint quad_vbo;
 
         GLuint common_ebo;
+
+        /// Measures passes of each tag, may be null
+        GpuTimer *gpu_timer = nullptr;
     };
     static context_vao_t create_gl_context(ResourceManager &res);
 
+    /// Buffers with uploaded batch data. Buffer objects are shared between GL contexts,
+    /// so they may be filled from another thread having shared context
+    struct batch_buffers_t {
+        GLuint point_vbo;
+        GLuint circle_vbo;
+        GLuint circle_instance_vbo;
+        GLuint ebo;
+    };
+
     RenderContext();
+    /// Deep copy, spatial index and levels of detail included
+    RenderContext(const RenderContext &other);
     ~RenderContext();
 
     using TriangleColors = std::array<glm::vec4, 3>;
@@ -52,8 +75,175 @@ class RenderContext {
     /// Remove everything
     void clear();
 
+    /// True if context has no primitives
+    bool empty() const;
+
+    /// Total vertices and circles count, grows with every added primitive
+    size_t vertices_count() const;
+
+    /// Changes with every modification and is unique among contexts, copies keep it.
+    /// Same generation means same content, so it may key caches of derived data
+    uint64_t generation() const;
+
+    /**
+     * Add count of primitives falling into each bin of uniform grid. Primitive is binned by one
+     * position: circle center, triangle centroid or line segment midpoint
+     * @param area_min, area_max - world area covered by grid
+     * @param size - bins count in each dimension
+     * @param bins - row major, size.x * size.y elements, first row at area_min.y
+     */
+    void accumulate_density(glm::vec2 area_min, glm::vec2 area_max, glm::u32vec2 size,
+                            float *bins) const;
+
+    /// Primitive kinds in the order they are drawn for one context
+    enum class primitive_t { TRIANGLE, LINE, FILLED_CIRCLE, THIN_CIRCLE };
+    static constexpr size_t PRIMITIVE_KINDS = 4;
+
+    /// Primitives of full detail of given kind
+    size_t primitives_count(primitive_t kind) const;
+
+    /// Memory taken by vertices and circles
+    size_t vertex_bytes() const;
+
+    /// Extend box by primitives bounds, circles included with radius
+    /// @return false if context is empty and box not changed
+    bool extend_bounds(glm::vec2 &min_corner, glm::vec2 &max_corner) const;
+
+    struct vertex_t {
+        glm::vec4 color;
+        glm::vec2 pos;
+    };
+
+    /// @param vertices - three for triangle, two for line, one center for circles
+    /// @param radius - circle radius, zero for other kinds
+    using primitive_visitor_t =
+        std::function<void(primitive_t kind, const vertex_t *vertices, float radius)>;
+
+    /// Enumerate primitives of full detail in the same order GPU draws them
+    void visit_primitives(const primitive_visitor_t &visitor) const;
+
+    /// Build spatial index used to skip invisible primitives during drawing and simplified
+    /// levels of detail for zoomed out views.
+    /// Should be called once context is complete, primitives added later are drawn without culling
+    void build_index();
+
     void draw(const context_vao_t &vaos, const ShaderCollection &shaders) const;
 
+    /**
+     * Packs several contexts into shared vertex and element buffers and draws them in the order
+     * they were added. Each buffer uploaded once per draw, only vertices of visible primitives
+     * are copied. Pass joins earlier draw call of the same kind if nothing drawn in between
+     * overlaps it, so interleaved layers share draw calls and shader switches.
+     */
+    class Batch {
+     public:
+        struct draw_stats_t {
+            size_t elements = 0;
+            size_t draw_calls = 0;
+            size_t vertex_bytes = 0;
+        };
+
+        Batch();
+        ~Batch();
+
+        /// Primitives of indexed contexts outside of that area are skipped on add()
+        void set_visible_area(glm::vec2 min_corner, glm::vec2 max_corner);
+
+        /// World size of one screen pixel, used to choose level of detail on add() and as margin
+        /// when joining draw calls. Zero value disables simplification
+        void set_pixel_size(float world_size);
+
+        /// Use levels of detail chosen by pixel size, enabled by default
+        void set_lod_enabled(bool enabled);
+
+        /// Keep contexts with different tags in separate draw calls, so GPU time of each tag
+        /// is measured. Should be enabled only while GPU timing is on
+        void set_split_tags(bool split);
+
+        /// Queue context for drawing, data is copied so context may be changed afterwards
+        /// @param tag - layer of context, GPU time of passes is measured per tag
+        void add(const RenderContext &ctx, uint32_t tag = 0);
+
+        /// Mark place for external drawing, primitives added before and after split are never
+        /// drawn by the same call
+        /// @return split index passed to draw callback
+        size_t split();
+
+        /// Upload and draw everything queued, queue is empty after this call
+        /// @param on_split - called at each split point, may change any GL state
+        void draw(const context_vao_t &vaos, const ShaderCollection &shaders,
+                  const std::function<void(size_t)> &on_split = nullptr);
+
+        /// Upload queued data to buffers, vertex arrays not touched so current context may be
+        /// any context shared with render one. Draw commands kept until draw_uploaded() call
+        void upload(const batch_buffers_t &buffers, bool instanced_circles);
+
+        /// Draw data uploaded by previous upload() call, queue is empty after this call
+        void draw_uploaded(const context_vao_t &vaos, const batch_buffers_t &buffers,
+                           const ShaderCollection &shaders,
+                           const std::function<void(size_t)> &on_split = nullptr);
+
+        /// Drop everything queued or uploaded without drawing
+        void clear();
+
+        /// Statistics of last draw() call
+        const draw_stats_t &last_stats() const;
+
+        /// Statistics of data queued so far, available without GL context
+        draw_stats_t queued_stats() const;
+
+     private:
+        struct batch_data_t;
+        std::unique_ptr<batch_data_t> impl_;
+    };
+
+    /// Primitive found by PickBatch
+    struct picked_t {
+        primitive_t kind = primitive_t::TRIANGLE;
+        /// All vertices of primitive as it was added, e.g. four for filled rectangle or every
+        /// polyline point, one center for circles
+        std::vector<vertex_t> vertices;
+        float radius = 0.0f;
+        /// Value passed to PickBatch::add()
+        uint32_t tag = 0;
+    };
+
+    /**
+     * Draws contexts into ID buffer, every added primitive filled with its own id encoded as
+     * RGBA8 color, so primitive under cursor found by reading single pixel. Rectangle or
+     * polyline gets single id, though drawn as several triangles or lines.
+     * Visible primitives drawn in full detail, in the same order as Batch draws them.
+     */
+    class PickBatch {
+     public:
+        PickBatch();
+        ~PickBatch();
+
+        /// Primitives of indexed contexts outside of that area are skipped on add()
+        void set_visible_area(glm::vec2 min_corner, glm::vec2 max_corner);
+
+        /// Queue context primitives, data is copied so lookup works after context changed
+        /// @param tag - returned with primitives of that context, e.g. layer index
+        void add(const RenderContext &ctx, uint32_t tag);
+
+        void clear();
+
+        /// Draw queued primitives into currently bound framebuffer, queue is kept for lookup
+        /// @note Blending should be disabled and framebuffer cleared to zero
+        void draw(const context_vao_t &vaos, const ShaderCollection &shaders) const;
+
+        /// Find primitive by id read from ID buffer
+        /// @return false for background or unknown id
+        bool lookup(uint32_t id, picked_t &result) const;
+
+        /// Id stored in ID buffer pixel
+        static uint32_t decode_id(const uint8_t *rgba);
+
+     private:
+        struct pick_data_t;
+        std::unique_ptr<pick_data_t> impl_;
+    };
+
  private:
     struct memory_layout_t;
     std::unique_ptr<memory_layout_t> impl_;
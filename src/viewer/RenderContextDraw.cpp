@@ -0,0 +1,318 @@
+//
+// Created by valdemar on 18.10.26.
+//
+
+#include "RenderContextImpl.h"
+#include "ShaderCollection.h"
+
+#include <common/Profiler.h>
+#include <viewer/GpuTimer.h>
+
+using namespace render_details;
+
+namespace {
+
+/// Point layout of RenderContext for currently bound vertex array and array buffer
+void set_point_attributes() {
+    const size_t stride = sizeof(point_layout_t);
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, stride, nullptr);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, cg::offset<float>(4));
+}
+
+/// Circle layout starting from circle with given index
+void set_circle_attributes(size_t first_circle) {
+    const size_t stride = sizeof(circle_layout_t);
+    const size_t base = first_circle * 7;
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, stride, cg::offset<float>(base));
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, cg::offset<float>(base + 4));
+    glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, stride, cg::offset<float>(base + 6));
+}
+
+/// Passes are timed on GPU as triangles, lines and all kinds of circles.
+/// Points of simplified triangles and polylines are counted as triangles
+size_t timer_pass_group(pass_t pass) {
+    switch (pass) {
+        case pass_t::TRIANGLES:
+        case pass_t::POINTS: return 0;
+        case pass_t::LINES: return 1;
+        default: return 2;
+    }
+}
+
+}  // anonymous namespace
+
+RenderContext::context_vao_t RenderContext::create_gl_context(ResourceManager &res) {
+    RenderContext::context_vao_t ret{};
+
+    ret.common_ebo = res.gen_buffer();
+    // Initialize forward pass point vao
+    {
+        ret.point_vao = res.gen_vertex_array();
+        ret.point_vbo = res.gen_buffer();
+        glBindVertexArray(ret.point_vao);
+        glBindBuffer(GL_ARRAY_BUFFER, ret.point_vbo);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ret.common_ebo);
+        set_point_attributes();
+        glEnableVertexAttribArray(0);
+        glEnableVertexAttribArray(1);
+        glBindVertexArray(0);
+    }
+
+    {
+        ret.circle_vao = res.gen_vertex_array();
+        ret.circle_vbo = res.gen_buffer();
+        glBindVertexArray(ret.circle_vao);
+        glBindBuffer(GL_ARRAY_BUFFER, ret.circle_vbo);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ret.common_ebo);
+        set_circle_attributes(0);
+        glEnableVertexAttribArray(0);
+        glEnableVertexAttribArray(1);
+        glEnableVertexAttribArray(2);
+        glBindVertexArray(0);
+    }
+
+    // Instanced circles, per instance pointers are set before each draw
+    {
+        //@formatter:off
+        const float quad[] = {
+            -1.0f, -1.0f,
+             1.0f, -1.0f,
+            -1.0f,  1.0f,
+             1.0f,  1.0f,
+        };
+        //@formatter:on
+        ret.quad_vbo = res.gen_buffer();
+        ret.circle_instance_vbo = res.gen_buffer();
+        ret.circle_instanced_vao = res.gen_vertex_array();
+        glBindVertexArray(ret.circle_instanced_vao);
+        glBindBuffer(GL_ARRAY_BUFFER, ret.quad_vbo);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
+        glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), nullptr);
+        glEnableVertexAttribArray(3);
+
+        glBindBuffer(GL_ARRAY_BUFFER, ret.circle_instance_vbo);
+        for (GLuint attr = 0; attr < 3; ++attr) {
+            glEnableVertexAttribArray(attr);
+            glVertexAttribDivisor(attr, 1);
+        }
+        glBindVertexArray(0);
+    }
+
+    return ret;
+}
+
+void RenderContext::draw(const RenderContext::context_vao_t &vaos,
+                         const ShaderCollection &shaders) const {
+    Batch batch;
+    batch.add(*this);
+    batch.draw(vaos, shaders);
+}
+
+void RenderContext::Batch::draw(const RenderContext::context_vao_t &vaos,
+                                const ShaderCollection &shaders,
+                                const std::function<void(size_t)> &on_split) {
+    const batch_buffers_t buffers{vaos.point_vbo, vaos.circle_vbo, vaos.circle_instance_vbo,
+                                  vaos.common_ebo};
+    upload(buffers, shaders.instanced_circles);
+    draw_uploaded(vaos, buffers, shaders, on_split);
+}
+
+void RenderContext::Batch::upload(const batch_buffers_t &buffers, bool instanced_circles) {
+    impl_->instanced = instanced_circles;
+    if (impl_->commands.empty()) {
+        return;
+    }
+    impl_->layout_elements();
+    Profiler::Scope upload{Profiler::UPLOAD, static_cast<int64_t>(impl_->elements.size())};
+
+    glCheckError();
+
+    // Element buffer loaded through array target, element target needs bound vertex array
+    const auto load = [](GLuint buffer, size_t size, const void *data) {
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        glBufferData(GL_ARRAY_BUFFER, size, data, GL_DYNAMIC_DRAW);
+    };
+    load(buffers.point_vbo, impl_->points.size() * sizeof(point_layout_t), impl_->points.data());
+    load(buffers.circle_vbo, impl_->circles.size() * sizeof(circle_layout_t),
+         impl_->circles.data());
+    if (instanced_circles) {
+        impl_->gather_instances();
+        load(buffers.circle_instance_vbo, impl_->instances.size() * sizeof(circle_layout_t),
+             impl_->instances.data());
+    }
+    load(buffers.ebo, impl_->elements.size() * sizeof(GLuint), impl_->elements.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glCheckError();
+}
+
+void RenderContext::Batch::draw_uploaded(const RenderContext::context_vao_t &vaos,
+                                         const batch_buffers_t &buffers,
+                                         const ShaderCollection &shaders,
+                                         const std::function<void(size_t)> &on_split) {
+    Profiler::Scope draw{Profiler::DRAW, static_cast<int64_t>(impl_->elements.size())};
+    impl_->stats = queued_stats();
+    if (impl_->commands.empty()) {
+        if (on_split) {
+            for (size_t idx = 0; idx < impl_->splits.size(); ++idx) {
+                on_split(idx);
+            }
+        }
+        impl_->clear();
+        return;
+    }
+
+    glCheckError();
+
+    // Point vertex arrays to buffers, element buffer is shared between both
+    glBindVertexArray(vaos.point_vao);
+    glBindBuffer(GL_ARRAY_BUFFER, buffers.point_vbo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers.ebo);
+    set_point_attributes();
+    glBindVertexArray(vaos.circle_vao);
+    glBindBuffer(GL_ARRAY_BUFFER, buffers.circle_vbo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers.ebo);
+    set_circle_attributes(0);
+
+    const bool instanced = impl_->instanced;
+    glBindVertexArray(vaos.point_vao);
+    GLuint cur_vao = vaos.point_vao;
+
+    const Shader *cur_shader = nullptr;
+    // Uniforms keep values between program switches, so it enough to set it once per change
+    GLuint cur_line_width = GL_INVALID_INDEX;
+    GpuTimer *timer = vaos.gpu_timer;
+    size_t cur_section = GpuTimer::SECTIONS_COUNT;
+    size_t next_split = 0;
+    const auto run_splits = [&](size_t cmd_idx) {
+        for (; next_split < impl_->splits.size() && impl_->splits[next_split] <= cmd_idx;
+             ++next_split) {
+            if (on_split) {
+                if (timer) {
+                    timer->end();
+                    cur_section = GpuTimer::SECTIONS_COUNT;
+                }
+                on_split(next_split);
+            }
+            // Callback may change anything
+            cur_shader = nullptr;
+            cur_vao = 0;
+            cur_line_width = GL_INVALID_INDEX;
+        }
+    };
+    for (size_t cmd_idx = 0; cmd_idx < impl_->commands.size(); ++cmd_idx) {
+        run_splits(cmd_idx);
+        auto &cmd = impl_->commands[cmd_idx];
+        const bool circle_shader = is_circle_shader_pass(cmd.pass);
+        const bool draw_instanced = instanced && circle_shader;
+        const Shader *shader = &shaders.color_pos;
+        GLuint vao = is_circle_pass(cmd.pass) ? vaos.circle_vao : vaos.point_vao;
+        if (draw_instanced) {
+            shader = &shaders.circle_instanced;
+            vao = vaos.circle_instanced_vao;
+        } else if (circle_shader) {
+            shader = &shaders.circle;
+        }
+
+        if (shader != cur_shader) {
+            shader->use();
+            cur_shader = shader;
+        }
+        if (vao != cur_vao) {
+            glBindVertexArray(vao);
+            cur_vao = vao;
+        }
+        if (timer) {
+            const size_t section = GpuTimer::layer_section(cmd.tag, timer_pass_group(cmd.pass));
+            if (section != cur_section) {
+                timer->begin(section);
+                cur_section = section;
+            }
+        }
+
+        GLenum mode = GL_POINTS;
+        switch (cmd.pass) {
+            case pass_t::TRIANGLES: mode = GL_TRIANGLES; break;
+            case pass_t::LINES: mode = GL_LINES; break;
+            // Circle vertex layout starts with color and position, same as for point
+            case pass_t::CIRCLE_POINTS: mode = GL_POINTS; break;
+            case pass_t::POINTS: mode = GL_POINTS; break;
+            case pass_t::PASSES_COUNT: break;
+            case pass_t::FILLED_CIRCLES:
+            case pass_t::THIN_CIRCLES: {
+                const GLuint line_width = cmd.pass == pass_t::THIN_CIRCLES ? 1 : 0;
+                if (line_width != cur_line_width) {
+                    shader->set_uint("line_width", line_width);
+                    cur_line_width = line_width;
+                }
+                break;
+            }
+        }
+
+        if (draw_instanced) {
+            // No base instance in OpenGL 3.3, so shift attribute pointers instead
+            glBindBuffer(GL_ARRAY_BUFFER, buffers.circle_instance_vbo);
+            set_circle_attributes(cmd.first_instance);
+            glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, static_cast<GLsizei>(cmd.count));
+        } else {
+            glDrawElements(mode, static_cast<GLsizei>(cmd.count), GL_UNSIGNED_INT,
+                           cg::offset<GLuint>(cmd.first));
+        }
+    }
+    if (timer) {
+        timer->end();
+    }
+    run_splits(impl_->commands.size());
+
+    glBindVertexArray(0);
+    glCheckError();
+
+    impl_->clear();
+}
+
+void RenderContext::PickBatch::draw(const RenderContext::context_vao_t &vaos,
+                                    const ShaderCollection &shaders) const {
+    const auto &data = *impl_;
+    if (data.commands.empty()) {
+        return;
+    }
+
+    glCheckError();
+
+    const auto load = [](GLuint buffer, size_t size, const void *ptr) {
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        glBufferData(GL_ARRAY_BUFFER, size, ptr, GL_DYNAMIC_DRAW);
+    };
+    load(vaos.point_vbo, data.id_points.size() * sizeof(point_layout_t), data.id_points.data());
+    load(vaos.circle_instance_vbo, data.instances.size() * sizeof(circle_layout_t),
+         data.instances.data());
+    load(vaos.common_ebo, data.elements.size() * sizeof(GLuint), data.elements.data());
+
+    // Vertex array may point to prefetched batch buffers after last draw
+    glBindVertexArray(vaos.point_vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vaos.point_vbo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vaos.common_ebo);
+    set_point_attributes();
+
+    for (const auto &cmd : data.commands) {
+        if (is_circle_pass(cmd.pass)) {
+            shaders.pick_circle.use();
+            shaders.pick_circle.set_uint("id_base", cmd.id_base);
+            shaders.pick_circle.set_uint("line_width", cmd.pass == pass_t::THIN_CIRCLES ? 1u : 0u);
+            glBindVertexArray(vaos.circle_instanced_vao);
+            glBindBuffer(GL_ARRAY_BUFFER, vaos.circle_instance_vbo);
+            set_circle_attributes(cmd.first);
+            glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, static_cast<GLsizei>(cmd.count));
+        } else {
+            shaders.pick.use();
+            glBindVertexArray(vaos.point_vao);
+            glDrawElements(cmd.pass == pass_t::TRIANGLES ? GL_TRIANGLES : GL_LINES,
+                           static_cast<GLsizei>(cmd.count), GL_UNSIGNED_INT,
+                           cg::offset<GLuint>(cmd.first));
+        }
+    }
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glCheckError();
+}
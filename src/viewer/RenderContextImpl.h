@@ -0,0 +1,256 @@
+//
+// Created by valdemar on 18.10.26.
+//
+
+#pragma once
+
+#include "RenderContext.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+/**
+ * Internals of RenderContext shared by its data part, which makes no GL calls and is used
+ * without GL context, and its drawing part in RenderContextDraw.cpp
+ */
+namespace render_details {
+
+#pragma pack(push, 1)
+struct point_layout_t {
+    glm::vec4 color;
+    glm::vec2 point;
+};
+
+struct circle_layout_t {
+    glm::vec4 color;
+    glm::vec2 point;
+    float radius;
+};
+
+#pragma pack(pop)
+
+/// Kinds of draw passes, in order they are drawn for one context
+enum class pass_t : uint8_t {
+    TRIANGLES,
+    LINES,
+    FILLED_CIRCLES,
+    THIN_CIRCLES,
+    CIRCLE_POINTS,  // Circles smaller than pixel, drawn as points in LOD levels
+    POINTS,         // Triangles and polylines smaller than pixel, drawn as points in LOD levels
+
+    PASSES_COUNT
+};
+constexpr size_t PASSES_COUNT = static_cast<size_t>(pass_t::PASSES_COUNT);
+
+/// Pass uses circles as vertex data
+inline bool is_circle_pass(pass_t pass) {
+    return pass == pass_t::FILLED_CIRCLES || pass == pass_t::THIN_CIRCLES ||
+           pass == pass_t::CIRCLE_POINTS;
+}
+
+/// Elements count per primitive of pass
+inline size_t primitive_size(pass_t pass) {
+    switch (pass) {
+        case pass_t::TRIANGLES: return 3;
+        case pass_t::LINES: return 2;
+        default: return 1;
+    }
+}
+
+/// Pass drawn by circle shader
+inline bool is_circle_shader_pass(pass_t pass) {
+    return pass == pass_t::FILLED_CIRCLES || pass == pass_t::THIN_CIRCLES;
+}
+
+/// Spatial index of one pass, defined by data part
+struct pass_index_t;
+
+}  // namespace render_details
+
+struct RenderContext::Batch::batch_data_t {
+    using pass_t = render_details::pass_t;
+    using point_layout_t = render_details::point_layout_t;
+    using circle_layout_t = render_details::circle_layout_t;
+    using pass_index_t = render_details::pass_index_t;
+
+    /// Continuous range in shared element buffer drawn with one call
+    struct draw_cmd_t {
+        pass_t pass;
+        // Range in laid out elements
+        size_t first;
+        size_t count;
+        // Filled for instanced circles only
+        size_t first_instance;
+        uint32_t tag;
+        // Union of primitive bounds, decides whether later passes may join the command
+        glm::vec2 min_corner;
+        glm::vec2 max_corner;
+        // Chain of staged element ranges
+        size_t first_chunk;
+        size_t last_chunk;
+    };
+
+    /// Range of staged elements, chunks of one command are chained in draw order
+    struct chunk_t {
+        size_t first;
+        size_t count;
+        size_t next;
+    };
+    static constexpr size_t NO_CHUNK = std::numeric_limits<size_t>::max();
+
+    /// Elements of one context pass selected for drawing, before vertices are copied
+    struct run_t {
+        pass_t pass;
+        const GLuint *elements;
+        size_t count;
+    };
+
+    /// Source vertices copied to batch, elements of runs inside it are shifted by the same value
+    struct vertex_range_t {
+        size_t first;
+        size_t last;
+        size_t batch_first;
+    };
+
+    std::vector<point_layout_t> points;
+    std::vector<circle_layout_t> circles;
+    // Circles referenced by elements, in draw order
+    std::vector<circle_layout_t> instances;
+    // Elements in order they were added
+    std::vector<GLuint> staged;
+    std::vector<chunk_t> chunks;
+    // Elements grouped by commands, same as staged if no command was joined out of order
+    std::vector<GLuint> elements;
+    bool reordered = false;
+    std::vector<draw_cmd_t> commands;
+    // Commands count at each split point
+    std::vector<size_t> splits;
+
+    glm::vec2 view_min{std::numeric_limits<float>::lowest()};
+    glm::vec2 view_max{std::numeric_limits<float>::max()};
+    // World size of one screen pixel, zero if unknown
+    float pixel_size = 0.0f;
+    bool lod_enabled = true;
+
+    draw_stats_t stats;
+    // Whether circle shader passes were uploaded as instances
+    bool instanced = false;
+    // Tag of context being added
+    uint32_t tag = 0;
+    bool split_tags = false;
+    // Visible primitives of pass being culled, reused between passes
+    std::vector<uint32_t> visible;
+    // Selected elements of context being added
+    std::vector<run_t> runs;
+    std::vector<vertex_range_t> point_ranges;
+    std::vector<vertex_range_t> circle_ranges;
+
+    void add_run(pass_t pass, const GLuint *from, size_t count) {
+        if (count > 0) {
+            runs.push_back({pass, from, count});
+        }
+    }
+
+    /// Select only pass elements which may be visible in current view, in submission order
+    void add_culled_pass(pass_t pass, const std::vector<GLuint> &from, const pass_index_t &index);
+
+    /**
+     * Copy vertices referenced by selected runs, ranges closer than gap are copied as one
+     * @return copied ranges sorted by source position
+     */
+    template <typename Layout>
+    static void copy_ranges(std::vector<vertex_range_t> &ranges, const std::vector<Layout> &from,
+                            std::vector<Layout> &to);
+
+    /// Copy vertices of selected runs of context and queue their elements
+    void flush_runs(const memory_layout_t &from);
+
+    void add_pass(pass_t pass, size_t shift, const GLuint *from, size_t count,
+                  glm::vec2 min_corner, glm::vec2 max_corner);
+
+    /// Place elements of each command together, in command order
+    void layout_elements();
+
+    /// Copy circles of circle shader passes to instances array
+    void gather_instances();
+
+    void clear() {
+        points.clear();
+        circles.clear();
+        instances.clear();
+        staged.clear();
+        chunks.clear();
+        elements.clear();
+        reordered = false;
+        commands.clear();
+        splits.clear();
+    }
+};
+
+struct RenderContext::PickBatch::pick_data_t {
+    using pass_t = render_details::pass_t;
+    using point_layout_t = render_details::point_layout_t;
+    using circle_layout_t = render_details::circle_layout_t;
+
+    /// Elements of one pass drawn with one call
+    struct pick_cmd_t {
+        pass_t pass;
+        // First element or, for circles, first instance
+        size_t first;
+        // Elements or instances count
+        size_t count;
+        // Id of first instance, other passes take ids from vertices
+        uint32_t id_base;
+    };
+
+    /// Submitted primitive, found by id minus one
+    struct pick_primitive_t {
+        pass_t pass;
+        // First vertex or circle instance
+        size_t first;
+        size_t count;
+        uint32_t tag;
+    };
+
+    // Vertices with original colors for lookup, and with primitive ids as colors for drawing
+    std::vector<point_layout_t> points;
+    std::vector<point_layout_t> id_points;
+    std::vector<circle_layout_t> instances;
+    std::vector<GLuint> elements;
+    std::vector<pick_cmd_t> commands;
+    std::vector<pick_primitive_t> primitives;
+
+    glm::vec2 view_min{std::numeric_limits<float>::lowest()};
+    glm::vec2 view_max{std::numeric_limits<float>::max()};
+    std::vector<uint32_t> visible;
+
+    /// Id 0 is background, so ids start from one
+    uint32_t next_id() const {
+        return static_cast<uint32_t>(primitives.size() + 1);
+    }
+
+    void add_command(pass_t pass, size_t first, size_t count, uint32_t id_base);
+
+    /**
+     * Add submitted primitive, which GL primitive at given position belongs to.
+     * Vertices of primitive are consecutive and never shared with other primitives, so GL
+     * primitives around are joined while they share vertex range with it
+     * @return position of GL primitive after added one
+     */
+    size_t add_primitive(pass_t pass, const std::vector<GLuint> &from,
+                         const std::vector<point_layout_t> &from_points, size_t pos, uint32_t tag);
+
+    static glm::vec4 encode_id(uint32_t id);
+
+    void clear() {
+        points.clear();
+        id_points.clear();
+        instances.clear();
+        elements.clear();
+        commands.clear();
+        primitives.clear();
+    }
+};
@@ -11,6 +11,11 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
 namespace {
 
 [[maybe_unused]] const RenderContext *test_draw() {
@@ -42,6 +47,14 @@ namespace {
     return context.get();
 }
 
+/// Density grid resolution over layer content in each dimension, power of two for mip levels
+constexpr uint32_t HEATMAP_SIZE = 512;
+/// Density grid area is fitted again once it is that many times larger than layer content
+constexpr float HEATMAP_MAX_SHRINK = 4.0f;
+
+/// ID buffer pixels read around cursor in each dimension, so thin lines are easy to hover
+constexpr GLsizei PICK_AREA = 5;
+
 }  // anonymous namespace
 
 struct Renderer::render_attrs_t {
@@ -53,6 +66,80 @@ struct Renderer::render_attrs_t {
     GLuint lines_vao = 0;
     GLuint uniform_buf{};
     glm::mat4 grid_model{};
+    // Primitives from all layers, drawn together
+    RenderContext::Batch batch;
+
+    glm::vec2 view_min{};
+    glm::vec2 view_max{};
+    float pixel_size = 0.0f;
+    RenderContext::Batch::draw_stats_t stats;
+
+    std::unique_ptr<BatchPrefetcher> prefetcher;
+    GpuTimer gpu_timer;
+
+    /// Layer density over world area around its content, permanent and frame parts binned
+    /// independently. View changes only pick mip level and renormalize colors
+    struct heatmap_t {
+        struct part_t {
+            // Zero is never used by contexts
+            uint64_t generation = 0;
+            bool empty = true;
+            glm::vec2 min_corner{};
+            glm::vec2 max_corner{};
+            // Cleared when content or area changed
+            std::vector<float> bins;
+        };
+        part_t perm;
+        part_t frame;
+
+        GLuint texture = 0;
+        glm::vec2 area_min{};
+        glm::vec2 area_max{};
+        // Sum of parts, then each level sums 2x2 bins of previous one, same as texture mipmaps
+        std::vector<std::vector<float>> levels;
+
+        // Maximum of visible bins at mip level view is drawn with
+        float max_density = 0.0f;
+        glm::vec2 view_min{};
+        glm::vec2 view_max{};
+        float pixel_size = 0.0f;
+    };
+    std::vector<heatmap_t> heatmaps;
+    // Layer drawn at each batch split
+    std::vector<size_t> queued_heatmaps;
+
+    glm::mat4 proj_view{};
+
+    /// Offscreen buffer with primitive ids instead of colors
+    struct pick_buffer_t {
+        GLuint fbo = 0;
+        GLuint color_rbo = 0;
+        GLuint pbo = 0;
+        glm::ivec2 size{0};
+        RenderContext::PickBatch batch;
+        // Buffer content doesn't match current primitives or view
+        bool dirty = true;
+        glm::mat4 proj_view{};
+
+        GLsync fence = nullptr;
+        glm::ivec2 read_origin{0};
+        glm::ivec2 read_size{0};
+        // Pixel under cursor when readback was issued
+        glm::ivec2 read_pixel{-1};
+        bool has_result = false;
+        RenderContext::picked_t result;
+
+        ~pick_buffer_t() {
+            if (fence) {
+                glDeleteSync(fence);
+            }
+            if (fbo != 0) {
+                glDeleteRenderbuffers(1, &color_rbo);
+                glDeleteFramebuffers(1, &fbo);
+            }
+        }
+    };
+    pick_buffer_t picking;
 };
 
 Renderer::Renderer(ResourceManager *res, glm::u32vec2 area_size, glm::u16vec2 grid_cells)
@@ -64,6 +151,7 @@ Renderer::Renderer(ResourceManager *res, glm::u32vec2 area_size, glm::u16vec2 gr
 
     LOG_INFO("Initialize needed attributes");
     attr_ = std::make_unique<render_attrs_t>();
+    ctx_render_params_.gpu_timer = &attr_->gpu_timer;
     // Init needed attributes
     attr_->grid_model = glm::scale(glm::mat4{1.0}, {area_size_.x, area_size_.y, 0.0f});
 
@@ -108,6 +196,10 @@ Renderer::Renderer(ResourceManager *res, glm::u32vec2 area_size, glm::u16vec2 gr
     shaders_->color.bind_uniform_block("MatrixBlock", 0);
     shaders_->color_pos.bind_uniform_block("MatrixBlock", 0);
     shaders_->circle.bind_uniform_block("MatrixBlock", 0);
+    shaders_->circle_instanced.bind_uniform_block("MatrixBlock", 0);
+    shaders_->heatmap.bind_uniform_block("MatrixBlock", 0);
+    shaders_->pick.bind_uniform_block("MatrixBlock", 0);
+    shaders_->pick_circle.bind_uniform_block("MatrixBlock", 0);
 }
 
 Renderer::~Renderer() = default;
@@ -118,9 +210,87 @@ void Renderer::update_frustum(const Camera &cam) {
     glBufferData(GL_UNIFORM_BUFFER, sizeof(glm::mat4), glm::value_ptr(cam.proj_view()),
                  GL_DYNAMIC_DRAW);
     glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    attr_->proj_view = cam.proj_view();
+
+    // Visible world area, used to cull primitives
+    const glm::mat4 inv_proj_view = glm::inverse(cam.proj_view());
+    const glm::vec4 corner1 = inv_proj_view * glm::vec4{-1.0f, -1.0f, 0.0f, 1.0f};
+    const glm::vec4 corner2 = inv_proj_view * glm::vec4{1.0f, 1.0f, 0.0f, 1.0f};
+    attr_->view_min = glm::min(glm::vec2{corner1}, glm::vec2{corner2});
+    attr_->view_max = glm::max(glm::vec2{corner1}, glm::vec2{corner2});
+    attr_->batch.set_visible_area(attr_->view_min, attr_->view_max);
+
+    // Orthographic projection, so scale is the same in every point of screen
+    // Pixel size is needed even without LOD, draw calls are joined with one pixel margin
+    float pixel_size = 0.0f;
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    const float x_scale = cam.proj_view()[0][0];
+    if (viewport[2] > 0 && x_scale != 0.0f) {
+        pixel_size = std::abs(2.0f / (x_scale * static_cast<float>(viewport[2])));
+    }
+    attr_->pixel_size = pixel_size;
+    attr_->batch.set_pixel_size(pixel_size);
+    attr_->batch.set_lod_enabled(lod_enabled_);
+    // Layers drawn together can't be measured apart
+    attr_->batch.set_split_tags(attr_->gpu_timer.active());
+}
+
+void Renderer::set_lod_enabled(bool enabled) {
+    lod_enabled_ = enabled;
+}
+
+void Renderer::set_circles_mode(int mode) {
+    switch (mode) {
+        case 1: shaders_->instanced_circles = false; break;
+        case 2: shaders_->instanced_circles = true; break;
+        default: shaders_->instanced_circles = shaders_->prefer_instanced_circles;
+    }
+}
+
+Renderer::circles_benchmark_t Renderer::benchmark_circles(size_t count, int frames) {
+    RenderContext ctx;
+    const auto side = static_cast<size_t>(std::sqrt(static_cast<double>(count))) + 1;
+    const glm::vec2 step = area_size_ / static_cast<float>(side);
+    for (size_t i = 0; i < count; ++i) {
+        const glm::vec2 pos{static_cast<float>(i % side), static_cast<float>(i / side)};
+        const glm::vec4 color{pos.x / side, pos.y / side, 0.5f, 1.0f};
+        ctx.add_circle(pos * step + step * 0.5f, step.x * 0.5f, color, i % 2 == 0);
+    }
+
+    const bool saved_mode = shaders_->instanced_circles;
+    const auto measure = [&](bool instanced) {
+        shaders_->instanced_circles = instanced;
+        // Own batch, so no culling and full detail
+        RenderContext::Batch batch;
+        batch.add(ctx);
+        batch.draw(ctx_render_params_, *shaders_);
+        glFinish();
+
+        const auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < frames; ++i) {
+            batch.add(ctx);
+            batch.draw(ctx_render_params_, *shaders_);
+            glFinish();
+        }
+        const std::chrono::duration<double, std::milli> elapsed =
+            std::chrono::steady_clock::now() - start;
+        return elapsed.count() / std::max(frames, 1);
+    };
+
+    circles_benchmark_t result{};
+    result.geometry_shader_ms = measure(false);
+    result.instanced_ms = measure(true);
+    shaders_->instanced_circles = saved_mode;
+    shaders_->prefer_instanced_circles = result.instanced_ms < result.geometry_shader_ms;
+
+    LOG_INFO("Circles benchmark (%zu circles, %d frames): geometry shader %.2fms, instanced %.2fms",
+             count, frames, result.geometry_shader_ms, result.instanced_ms);
+    return result;
 }
 
 void Renderer::render_background(glm::vec3 color) {
+    attr_->gpu_timer.begin(GpuTimer::BACKGROUND);
     // Main scene area
     shaders_->color.use();
     auto model = glm::scale(glm::mat4(1.0f), {area_size_ * 0.5f, 1.0f});
@@ -129,6 +299,7 @@ void Renderer::render_background(glm::vec3 color) {
     shaders_->color.set_vec4("color", glm::vec4{color, 1.0f});
     glBindVertexArray(attr_->rect_vao);
     glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    attr_->gpu_timer.end();
 
     //if (auto context = test_draw()) {
     //    context->draw(ctx_render_params_, *shaders_);
@@ -136,6 +307,7 @@ void Renderer::render_background(glm::vec3 color) {
 }
 
 void Renderer::render_grid(glm::vec3 color) {
+    attr_->gpu_timer.begin(GpuTimer::GRID);
     shaders_->color.use();
     shaders_->color.set_mat4("model", attr_->grid_model);
     shaders_->color.set_vec4("color", glm::vec4{color, 1.0f});
@@ -185,8 +357,370 @@ void Renderer::render_grid(glm::vec3 color) {
     glBindVertexArray(attr_->grid_vao);
     glDrawArrays(GL_LINES, 0, attr_->grid_vertex_count);
     glBindVertexArray(0);
+    attr_->gpu_timer.end();
+}
+
+void Renderer::queue_primitives(const RenderContext &ctx, size_t layer) {
+    attr_->batch.add(ctx, static_cast<uint32_t>(layer));
+}
+
+void Renderer::queue_heatmap(size_t layer, const RenderContext &permanent,
+                             const RenderContext &frame) {
+    if (attr_->heatmaps.size() <= layer) {
+        attr_->heatmaps.resize(layer + 1);
+    }
+    auto &heatmap = attr_->heatmaps[layer];
+    using part_t = render_attrs_t::heatmap_t::part_t;
+
+    const auto update_bounds = [](const RenderContext &ctx, part_t &part) {
+        if (part.generation == ctx.generation()) {
+            return false;
+        }
+        part.generation = ctx.generation();
+        part.min_corner = glm::vec2{std::numeric_limits<float>::max()};
+        part.max_corner = glm::vec2{std::numeric_limits<float>::lowest()};
+        part.empty = !ctx.extend_bounds(part.min_corner, part.max_corner);
+        part.bins.clear();
+        return true;
+    };
+    bool changed = update_bounds(permanent, heatmap.perm);
+    changed |= update_bounds(frame, heatmap.frame);
+
+    if (changed) {
+        glm::vec2 content_min{std::numeric_limits<float>::max()};
+        glm::vec2 content_max{std::numeric_limits<float>::lowest()};
+        for (const part_t *part : {&heatmap.perm, &heatmap.frame}) {
+            if (!part->empty) {
+                content_min = glm::min(content_min, part->min_corner);
+                content_max = glm::max(content_max, part->max_corner);
+            }
+        }
+
+        if (content_min.x > content_max.x) {
+            heatmap.levels.clear();
+        } else {
+            const glm::vec2 extent = glm::max(content_max - content_min, glm::vec2{1.0f});
+            const glm::vec2 area_extent = heatmap.area_max - heatmap.area_min;
+            const bool fits = content_min.x >= heatmap.area_min.x &&
+                              content_min.y >= heatmap.area_min.y &&
+                              content_max.x <= heatmap.area_max.x &&
+                              content_max.y <= heatmap.area_max.y;
+            const bool too_large = area_extent.x > extent.x * HEATMAP_MAX_SHRINK ||
+                                   area_extent.y > extent.y * HEATMAP_MAX_SHRINK;
+            if (!fits || too_large) {
+                // Margin keeps area while content moves a bit, each area change rebins both parts
+                heatmap.area_min = content_min - extent * 0.25f;
+                heatmap.area_max = content_max + extent * 0.25f;
+                heatmap.perm.bins.clear();
+                heatmap.frame.bins.clear();
+            }
+
+            const glm::u32vec2 size{HEATMAP_SIZE, HEATMAP_SIZE};
+            const auto update_bins = [&](const RenderContext &ctx, part_t &part) {
+                if (!part.bins.empty()) {
+                    return;
+                }
+                part.bins.assign(size.x * size.y, 0.0f);
+                if (!part.empty) {
+                    ctx.accumulate_density(heatmap.area_min, heatmap.area_max, size,
+                                           part.bins.data());
+                }
+            };
+            update_bins(permanent, heatmap.perm);
+            update_bins(frame, heatmap.frame);
+
+            heatmap.levels.resize(1);
+            auto &bins = heatmap.levels.front();
+            bins.resize(heatmap.perm.bins.size());
+            for (size_t i = 0; i < bins.size(); ++i) {
+                bins[i] = heatmap.perm.bins[i] + heatmap.frame.bins[i];
+            }
+            for (size_t side = HEATMAP_SIZE / 2; side > 0; side /= 2) {
+                const auto &prev = heatmap.levels.back();
+                std::vector<float> level(side * side);
+                for (size_t y = 0; y < side; ++y) {
+                    const float *row = &prev[2 * y * 2 * side];
+                    const float *next_row = row + 2 * side;
+                    for (size_t x = 0; x < side; ++x) {
+                        level[y * side + x] =
+                            row[2 * x] + row[2 * x + 1] + next_row[2 * x] + next_row[2 * x + 1];
+                    }
+                }
+                heatmap.levels.emplace_back(std::move(level));
+            }
+
+            if (heatmap.texture == 0) {
+                heatmap.texture = mgr_->gen_texture();
+                glBindTexture(GL_TEXTURE_2D, heatmap.texture);
+                // Levels hold sums, so blending between them would change brightness
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_NEAREST);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL,
+                                static_cast<GLint>(heatmap.levels.size() - 1));
+            }
+            glBindTexture(GL_TEXTURE_2D, heatmap.texture);
+            for (size_t level = 0; level < heatmap.levels.size(); ++level) {
+                const auto side = static_cast<GLsizei>(HEATMAP_SIZE >> level);
+                glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), GL_R32F, side, side, 0,
+                             GL_RED, GL_FLOAT, heatmap.levels[level].data());
+            }
+            glBindTexture(GL_TEXTURE_2D, 0);
+        }
+    }
+
+    if (changed || heatmap.view_min != attr_->view_min || heatmap.view_max != attr_->view_max ||
+        heatmap.pixel_size != attr_->pixel_size) {
+        heatmap.view_min = attr_->view_min;
+        heatmap.view_max = attr_->view_max;
+        heatmap.pixel_size = attr_->pixel_size;
+        heatmap.max_density = visible_max_density(layer);
+    }
+
+    attr_->batch.split();
+    attr_->queued_heatmaps.push_back(layer);
+}
+
+void Renderer::flush_primitives() {
+    attr_->batch.draw(ctx_render_params_, *shaders_, [this](size_t split_idx) {
+        draw_heatmap(attr_->queued_heatmaps[split_idx]);
+    });
+    attr_->stats = attr_->batch.last_stats();
+    attr_->queued_heatmaps.clear();
+}
+
+void Renderer::enable_prefetch(size_t slots, BatchPrefetcher::fill_fn_t fill) {
+    attr_->prefetcher = std::make_unique<BatchPrefetcher>(mgr_, slots, std::move(fill));
+}
+
+void Renderer::prefetch_frames(std::vector<std::shared_ptr<Frame>> frames, uint64_t key) {
+    if (attr_->prefetcher) {
+        attr_->prefetcher->request(std::move(frames), prefetch_settings(key));
+    }
+}
+
+bool Renderer::draw_prefetched(const Frame *frame, uint64_t key) {
+    if (!attr_->prefetcher) {
+        return false;
+    }
+    return attr_->prefetcher->draw(frame, prefetch_settings(key), ctx_render_params_, *shaders_,
+                                   &attr_->stats);
+}
+
+BatchPrefetcher::settings_t Renderer::prefetch_settings(uint64_t key) const {
+    BatchPrefetcher::settings_t settings;
+    settings.view_min = attr_->view_min;
+    settings.view_max = attr_->view_max;
+    settings.pixel_size = attr_->pixel_size;
+    settings.lod_enabled = lod_enabled_;
+    settings.instanced_circles = shaders_->instanced_circles;
+    settings.split_tags = attr_->gpu_timer.active();
+    settings.key = key;
+    return settings;
+}
+
+float Renderer::visible_max_density(size_t layer) const {
+    const auto &heatmap = attr_->heatmaps[layer];
+    const glm::vec2 view_min = attr_->view_min;
+    const glm::vec2 view_max = attr_->view_max;
+    const bool visible = view_min.x <= heatmap.area_max.x && heatmap.area_min.x <= view_max.x &&
+                         view_min.y <= heatmap.area_max.y && heatmap.area_min.y <= view_max.y;
+    if (heatmap.levels.empty() || !visible) {
+        return 0.0f;
+    }
+
+    // Nearest mip level for texels per screen pixel, as GPU picks it
+    const glm::vec2 area_size = heatmap.area_max - heatmap.area_min;
+    const float texel_size = std::min(area_size.x, area_size.y) / HEATMAP_SIZE;
+    size_t level = 0;
+    if (attr_->pixel_size > texel_size) {
+        const auto nearest = std::lround(std::log2(attr_->pixel_size / texel_size));
+        level = std::min(static_cast<size_t>(nearest), heatmap.levels.size() - 1);
+    }
+
+    const size_t side = HEATMAP_SIZE >> level;
+    const glm::vec2 scale = glm::vec2{static_cast<float>(side)} / area_size;
+    // Clamped in float, view may be far larger than area
+    const auto to_bin = [&](glm::vec2 point) {
+        return glm::clamp(glm::floor((point - heatmap.area_min) * scale), 0.0f,
+                          static_cast<float>(side - 1));
+    };
+    const glm::uvec2 first{to_bin(view_min)};
+    const glm::uvec2 last{to_bin(view_max)};
+
+    const auto &bins = heatmap.levels[level];
+    float max_density = 0.0f;
+    for (size_t y = first.y; y <= last.y; ++y) {
+        for (size_t x = first.x; x <= last.x; ++x) {
+            max_density = std::max(max_density, bins[y * side + x]);
+        }
+    }
+    return max_density;
+}
+
+void Renderer::draw_heatmap(size_t layer) {
+    const auto &heatmap = attr_->heatmaps[layer];
+    if (heatmap.max_density <= 0.0f) {
+        return;
+    }
+
+    const glm::vec2 center = (heatmap.area_min + heatmap.area_max) * 0.5f;
+    const glm::vec2 half_size = (heatmap.area_max - heatmap.area_min) * 0.5f;
+    auto model = glm::translate(glm::mat4(1.0f), {center, 0.0f});
+    model = glm::scale(model, {half_size, 1.0f});
+
+    attr_->gpu_timer.begin(GpuTimer::HEATMAPS);
+    shaders_->heatmap.use();
+    shaders_->heatmap.set_mat4("model", model);
+    shaders_->heatmap.set_int("density", 0);
+    shaders_->heatmap.set_float("max_density", heatmap.max_density);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, heatmap.texture);
+    glBindVertexArray(attr_->rect_vao);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    attr_->gpu_timer.end();
+}
+
+bool Renderer::pick(glm::vec2 world_point, bool content_changed, const pick_fill_fn_t &fill,
+                    RenderContext::picked_t &result) {
+    auto &pick = attr_->picking;
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    const glm::ivec2 size{viewport[2], viewport[3]};
+    if (size.x < PICK_AREA || size.y < PICK_AREA) {
+        return false;
+    }
+
+    finish_pick_readback();
+
+    // Framebuffer pixel under point, origin at bottom left
+    const glm::vec4 clip = attr_->proj_view * glm::vec4{world_point.x, world_point.y, 0.0f, 1.0f};
+    const glm::vec2 ndc = glm::vec2{clip} / clip.w;
+    const glm::ivec2 pixel{glm::floor((ndc * 0.5f + 0.5f) * glm::vec2{size})};
+    if (pixel.x < 0 || pixel.y < 0 || pixel.x >= size.x || pixel.y >= size.y) {
+        return false;
+    }
+
+    if (pick.fbo == 0) {
+        glGenFramebuffers(1, &pick.fbo);
+        glGenRenderbuffers(1, &pick.color_rbo);
+        pick.pbo = mgr_->gen_buffer();
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pick.pbo);
+        glBufferData(GL_PIXEL_PACK_BUFFER, PICK_AREA * PICK_AREA * 4, nullptr, GL_STREAM_READ);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+
+    GLint prev_draw_fbo;
+    GLint prev_read_fbo;
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &prev_draw_fbo);
+    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &prev_read_fbo);
+
+    if (size != pick.size) {
+        pick.size = size;
+        pick.dirty = true;
+        glBindRenderbuffer(GL_RENDERBUFFER, pick.color_rbo);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, size.x, size.y);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, pick.fbo);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER,
+                                  pick.color_rbo);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            LOG_WARN("Picking framebuffer is incomplete");
+        }
+    }
+    pick.dirty |= content_changed || pick.proj_view != attr_->proj_view;
+
+    // Batch is kept for lookup, so it is replaced only when no readback is pending
+    if (!pick.fence && (pick.dirty || pixel != pick.read_pixel)) {
+        glBindFramebuffer(GL_FRAMEBUFFER, pick.fbo);
+        if (pick.dirty) {
+            const GLfloat background[] = {0.0f, 0.0f, 0.0f, 0.0f};
+            glClearBufferfv(GL_COLOR, 0, background);
+            const GLboolean blend = glIsEnabled(GL_BLEND);
+            glDisable(GL_BLEND);
+
+            pick.batch.clear();
+            pick.batch.set_visible_area(attr_->view_min, attr_->view_max);
+            fill(pick.batch);
+            pick.batch.draw(ctx_render_params_, *shaders_);
+
+            if (blend) {
+                glEnable(GL_BLEND);
+            }
+            pick.proj_view = attr_->proj_view;
+            pick.dirty = false;
+        }
+
+        pick.read_pixel = pixel;
+        pick.read_origin = glm::clamp(pixel - PICK_AREA / 2, glm::ivec2{0}, size - PICK_AREA);
+        pick.read_size = {PICK_AREA, PICK_AREA};
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pick.pbo);
+        glReadPixels(pick.read_origin.x, pick.read_origin.y, pick.read_size.x, pick.read_size.y,
+                     GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        pick.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        glCheckError();
+    }
+
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, prev_draw_fbo);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, prev_read_fbo);
+
+    if (pick.has_result) {
+        result = pick.result;
+    }
+    return pick.has_result;
+}
+
+bool Renderer::pick_pending() const {
+    return attr_->picking.fence != nullptr;
+}
+
+void Renderer::finish_pick_readback() {
+    auto &pick = attr_->picking;
+    if (!pick.fence) {
+        return;
+    }
+    // Never block, GPU may still be busy with ID buffer
+    if (glClientWaitSync(pick.fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+        return;
+    }
+    glDeleteSync(pick.fence);
+    pick.fence = nullptr;
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pick.pbo);
+    const auto pixels = static_cast<const uint8_t *>(glMapBufferRange(
+        GL_PIXEL_PACK_BUFFER, 0, pick.read_size.x * pick.read_size.y * 4, GL_MAP_READ_BIT));
+    // Pixel under cursor wins, otherwise the nearest primitive around
+    uint32_t id = 0;
+    int best_distance = std::numeric_limits<int>::max();
+    if (pixels) {
+        for (int y = 0; y < pick.read_size.y; ++y) {
+            for (int x = 0; x < pick.read_size.x; ++x) {
+                const uint32_t pixel_id =
+                    RenderContext::PickBatch::decode_id(&pixels[(y * pick.read_size.x + x) * 4]);
+                const glm::ivec2 delta = pick.read_origin + glm::ivec2{x, y} - pick.read_pixel;
+                const int distance = delta.x * delta.x + delta.y * delta.y;
+                if (pixel_id != 0 && distance < best_distance) {
+                    id = pixel_id;
+                    best_distance = distance;
+                }
+            }
+        }
+    } else {
+        LOG_WARN("Cannot map picking buffer");
+    }
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    pick.has_result = id != 0 && pick.batch.lookup(id, pick.result);
+}
+
+const RenderContext::Batch::draw_stats_t &Renderer::primitives_stats() const {
+    return attr_->stats;
 }
 
-void Renderer::render_primitives(const RenderContext &ctx) {
-    ctx.draw(ctx_render_params_, *shaders_);
+GpuTimer &Renderer::gpu_timer() {
+    return attr_->gpu_timer;
 }
@@ -4,6 +4,8 @@
 
 #pragma once
 
+#include "BatchPrefetcher.h"
+#include "GpuTimer.h"
 #include "RenderContext.h"
 #include "ShaderCollection.h"
 
@@ -12,6 +14,7 @@
 
 #include <glm/glm.hpp>
 
+#include <functional>
 #include <memory>
 
 class Renderer {
@@ -21,9 +24,68 @@ class Renderer {
 
     void update_frustum(const Camera &cam);
 
+    /// Use simplified geometry when zoomed out
+    void set_lod_enabled(bool enabled);
+
+    /// 0 - choose by driver, 1 - geometry shader, 2 - instancing
+    void set_circles_mode(int mode);
+
+    struct circles_benchmark_t {
+        double geometry_shader_ms;
+        double instanced_ms;
+    };
+    /// Draw count circles with each available method, return average frame time.
+    /// Faster method is chosen afterwards in automatic mode
+    /// @note Blocking call, waits for GPU to finish every frame
+    circles_benchmark_t benchmark_circles(size_t count, int frames);
+
     void render_background(glm::vec3 color);
     void render_grid(glm::vec3 color);
-    void render_primitives(const RenderContext &ctx);
+
+    /// Queue context primitives, they will be drawn on flush_primitives() call
+    void queue_primitives(const RenderContext &ctx, size_t layer);
+    /// Queue layer drawn as density heatmap of its primitives instead of primitives itself.
+    /// Density is binned over world area around layer content, only when contexts changed since
+    /// last call for that layer. Visible area changes only renormalize colors
+    void queue_heatmap(size_t layer, const RenderContext &permanent, const RenderContext &frame);
+
+    /// Draw all queued primitives and heatmaps, keeping order they were queued
+    void flush_primitives();
+
+    /// Start background thread preparing frames batches ahead
+    /// @param slots - maximum frames prepared at once
+    /// @param fill - queues frame primitives into batch, called from worker thread
+    void enable_prefetch(size_t slots, BatchPrefetcher::fill_fn_t fill);
+
+    /// Prepare batches of frames for current view in background, most wanted first
+    /// @param key - passed to fill function, prepared batch used only with the same key
+    void prefetch_frames(std::vector<std::shared_ptr<Frame>> frames, uint64_t key);
+
+    /// Draw frame from batch prepared for current view, instead of queueing its primitives
+    /// @return false if batch is not ready
+    bool draw_prefetched(const Frame *frame, uint64_t key);
+
+    /// Queues primitives drawn into ID buffer, tag is returned with picked primitive
+    using pick_fill_fn_t = std::function<void(RenderContext::PickBatch &)>;
+
+    /**
+     * Find primitive under world point using offscreen ID buffer of viewport size.
+     * Buffer redrawn only if content changed or view moved, pixels around point are read back
+     * asynchronously, so result lags a frame or two behind.
+     * @param content_changed - contexts filled by fill differ from previous call
+     * @return false if nothing there or no readback finished yet
+     */
+    bool pick(glm::vec2 world_point, bool content_changed, const pick_fill_fn_t &fill,
+              RenderContext::picked_t &result);
+
+    /// True while ID buffer readback is not finished, so another frame needed to get result
+    bool pick_pending() const;
+
+    /// Statistics of last flush_primitives() or successful draw_prefetched() call
+    const RenderContext::Batch::draw_stats_t &primitives_stats() const;
+
+    /// GPU time of passes, sections are measured only in frames started by new_frame(true)
+    GpuTimer &gpu_timer();
 
  private:
     ResourceManager *mgr_;
@@ -34,6 +96,15 @@ class Renderer {
     struct render_attrs_t;
     std::unique_ptr<render_attrs_t> attr_;
 
+    /// Maximum of heatmap bins in visible area, at mip level view is drawn with
+    float visible_max_density(size_t layer) const;
+    void draw_heatmap(size_t layer);
+    BatchPrefetcher::settings_t prefetch_settings(uint64_t key) const;
+    /// Take result of pending ID buffer readback if GPU finished it
+    void finish_pick_readback();
+
     glm::vec2 area_size_;
     glm::u16vec2 grid_cells_;
+
+    bool lod_enabled_ = true;
 };
@@ -1,30 +1,89 @@
 #include "Scene.h"
 #include "Renderer.h"
+#include "SoftwareRenderer.h"
 
 #include <cgutils/utils.h>
+#include <common/Profiler.h>
 
 #include <imgui.h>
 
+#include <chrono>
+#include <cmath>
 #include <unordered_map>
 
-using SpinGuard = std::unique_lock<Spinlock>;
+namespace {
 
-Scene::Scene(ResourceManager *res, const Config::SceneConf *conf) : conf_(*conf) {
+uint64_t elapsed_ns(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now() - start)
+        .count();
+}
+
+const char *primitive_name(const RenderContext::picked_t &primitive) {
+    switch (primitive.kind) {
+        case RenderContext::primitive_t::TRIANGLE:
+            return primitive.vertices.size() == 4 ? "Rectangle" : "Triangle";
+        case RenderContext::primitive_t::LINE:
+            return primitive.vertices.size() > 2 ? "Polyline" : "Line";
+        case RenderContext::primitive_t::FILLED_CIRCLE: return "Filled circle";
+        case RenderContext::primitive_t::THIN_CIRCLE: return "Circle";
+    }
+    return "Primitive";
+}
+
+void show_primitive_tooltip(const RenderContext::picked_t &primitive) {
+    ImGui::BeginTooltip();
+    ImGui::Text("%s, layer %u", primitive_name(primitive), primitive.tag + 1);
+    for (const auto &vertex : primitive.vertices) {
+        const auto byte = [](float channel) {
+            return static_cast<int>(std::lround(cg::clamp(channel, 0.0f, 1.0f) * 255.0f));
+        };
+        ImGui::Text("(%.3f, %.3f) #%02X%02X%02X%02X", vertex.pos.x, vertex.pos.y,
+                    byte(vertex.color.r), byte(vertex.color.g), byte(vertex.color.b),
+                    byte(vertex.color.a));
+    }
+    if (primitive.radius > 0.0f) {
+        ImGui::Text("Radius: %.3f", primitive.radius);
+    }
+    ImGui::EndTooltip();
+}
+
+}  // anonymous namespace
+
+Scene::Scene(ResourceManager *res, const Config::SceneConf *conf)
+    : conf_(*conf), snapshot_(&epoch_, std::make_unique<snapshot_t>()) {
+    if (!res) {
+        return;
+    }
     renderer_ = std::make_unique<Renderer>(res, conf_.grid_dim, conf_.grid_cells);
+    if (conf_.prefetch_frames > 0) {
+        renderer_->enable_prefetch(
+            static_cast<size_t>(conf_.prefetch_frames),
+            [this](const Frame &frame, uint64_t key, RenderContext::Batch &batch) {
+                fill_prefetch_batch(frame, key, batch);
+            });
+    }
 }
 
-Scene::~Scene() = default;
+Scene::~Scene() {
+    // Indexing job reads frames through scene
+    JobSystem::shared().wait(index_jobs_);
+    // Stop prefetching thread before frames destroyed
+    renderer_.reset();
+    frame_guard_.reset();
+}
 
 void Scene::update_and_render(const Camera &cam) {
-    // Update current frame
-    {
-        SpinGuard lock(frame_access_lock_);
-        frames_count_ = static_cast<int>(frames_.size());
-        if (cur_frame_idx_ >= 0 && cur_frame_idx_ < frames_count_) {
-            active_frame_ = frames_[cur_frame_idx_];
-        }
+    if (!renderer_) {
+        throw std::runtime_error("Scene created without GPU renderer");
     }
+    const int prev_frame_idx = rendered_frame_idx_;
+    update_active_frame();
 
+    // GPU passes are measured along with CPU stages
+    renderer_->gpu_timer().new_frame(Profiler::enabled());
+    renderer_->set_lod_enabled(conf_.use_lod);
+    renderer_->set_circles_mode(conf_.circles_render_mode);
     renderer_->update_frustum(cam);
     renderer_->render_background(conf_.scene_color);
 
@@ -34,21 +93,73 @@ void Scene::update_and_render(const Camera &cam) {
     }
 
     // Draw currently selected frame
-    if (active_frame_) {
-        SpinGuard lock(frame_access_lock_);
-        const auto &perm_frame_contexts = permanent_frame_.all_contexts();
-        const auto &frame_contexts = active_frame_->all_contexts();
-        for (size_t idx = 0; idx < Frame::LAYERS_COUNT; ++idx) {
-            if (conf_.enabled_layers[idx]) {
-                renderer_->render_primitives(perm_frame_contexts[idx]);
-                renderer_->render_primitives(frame_contexts[idx]);
+    const uint64_t key = prefetch_key();
+    if (active_frame_ && !(key && renderer_->draw_prefetched(active_frame_, key))) {
+        {
+            // Batch copies primitives, so snapshot needed only while queueing
+            EpochDomain::ReadGuard guard(&epoch_);
+            const auto &perm_frame_contexts = snapshot_.load()->permanent->all_contexts();
+            const auto &frame_contexts = active_frame_->all_contexts();
+            for (size_t idx = 0; idx < Frame::LAYERS_COUNT; ++idx) {
+                if (!conf_.enabled_layers[idx]) {
+                    continue;
+                }
+                if (conf_.heatmap_layers[idx]) {
+                    renderer_->queue_heatmap(idx, perm_frame_contexts[idx], frame_contexts[idx]);
+                } else {
+                    renderer_->queue_primitives(perm_frame_contexts[idx], idx);
+                    renderer_->queue_primitives(frame_contexts[idx], idx);
+                }
             }
         }
+        renderer_->flush_primitives();
+    }
+
+    if (key && prev_frame_idx >= 0) {
+        prefetch_next_frames(cur_frame_idx_ - prev_frame_idx, key);
+    }
+
+    if (hover_requested_ && active_frame_) {
+        pick_hovered();
+    } else {
+        hovered_valid_ = false;
+    }
+    hover_requested_ = false;
+}
+
+void Scene::render_software(SoftwareRenderer &target, const Camera &cam) {
+    update_active_frame();
+
+    uint32_t layers = 0;
+    for (size_t idx = 0; idx < Frame::LAYERS_COUNT; ++idx) {
+        layers |= static_cast<uint32_t>(conf_.enabled_layers[idx]) << idx;
     }
+    target.set_proj_view(cam.proj_view());
+    queue_software(active_frame_, layers, target);
+    target.flush();
+}
+
+void Scene::render_frame_software(const Frame &frame, uint32_t layers,
+                                  SoftwareRenderer &target) {
+    queue_software(&frame, layers, target);
+    target.flush();
+}
+
+std::shared_ptr<Frame> Scene::frame_at(int idx) {
+    EpochDomain::ReadGuard guard(&epoch_);
+    const auto &frames = *snapshot_.load()->frames;
+    if (idx < 0 || idx + 1 >= static_cast<int>(frames.size())) {
+        return nullptr;
+    }
+    return frames.share(static_cast<size_t>(idx));
+}
+
+uint32_t Scene::permanent_version() const {
+    return permanent_version_;
 }
 
 void Scene::set_frame_index(int idx) {
-    cur_frame_idx_ = cg::clamp(idx, 0, frames_count_ - 1);
+    cur_frame_idx_ = cg::clamp(idx, 0, get_frames_count() - 1);
 }
 
 int Scene::get_frame_index() const {
@@ -56,7 +167,8 @@ int Scene::get_frame_index() const {
 }
 
 int Scene::get_frames_count() const {
-    return frames_count_;
+    // Timeline is kept alive by frame guard
+    return timeline_ ? static_cast<int>(timeline_->size()) : 0;
 }
 
 const char *Scene::get_frame_user_message() {
@@ -66,54 +178,383 @@ const char *Scene::get_frame_user_message() {
     return "";
 }
 
-void Scene::add_frame(std::shared_ptr<Frame> frame) {
-    SpinGuard lock(frame_access_lock_);
-    frames_.emplace_back(std::move(frame));
+const FrameStatsTimeline &Scene::frame_stats() const {
+    return frame_stats_;
 }
 
-void Scene::add_frame_data(const Frame &data) {
-    SpinGuard lock(frame_access_lock_);
-    if (frames_.empty()) {
-        throw std::runtime_error("called add_frame_data, but frames list is empty");
+std::vector<uint32_t> Scene::find_frames(const std::string &query) const {
+    return text_index_.search(query);
+}
+
+size_t Scene::searchable_frames_count() const {
+    return text_index_.frames_count();
+}
+
+size_t Scene::get_frame_message_lines() const {
+    return active_frame_ ? active_frame_->message_lines_count() : 0;
+}
+
+Frame::text_range_t Scene::get_frame_message_line(size_t idx) const {
+    return active_frame_->message_line(idx);
+}
+
+void Scene::add_frame(std::shared_ptr<Frame> frame) {
+    Profiler::Scope seal{Profiler::SEAL};
+    // Frame not shared yet, so heavy work can be done without lock
+    frame->seal();
+    {
+        auto lock = lock_writer();
+        // Only writers replace snapshot, so current one stays alive under writer lock
+        auto &frames = *snapshot_.load()->frames;
+        frames.push_back(std::move(frame));
+        seal.set_arg(static_cast<int64_t>(frames.size()) - 1);
+        open_spare_ = nullptr;
+        open_spare_delta_ = nullptr;
     }
+    notify_data_changed();
+}
+
+void Scene::add_frame_data(const Frame &data, bool complete) {
+    {
+        auto lock = lock_writer();
+        auto &frames = *snapshot_.load()->frames;
+        if (frames.size() == 0) {
+            throw std::runtime_error("called add_frame_data, but frames list is empty");
+        }
+        Profiler::Scope seal{Profiler::SEAL, static_cast<int64_t>(frames.size()) - 1};
+
+        // Published frame may be read right now, so changed frame replaces it. Frame replaced
+        // last time is reused when readers are done with it, otherwise published one is copied
+        const auto start = std::chrono::steady_clock::now();
+        std::shared_ptr<Frame> frame;
+        if (open_spare_ && open_spare_.use_count() == 1) {
+            std::atomic_thread_fence(std::memory_order_acquire);
+            frame = std::move(open_spare_);
+            frame->update_from(*open_spare_delta_);
+        } else {
+            frame = std::make_shared<Frame>(*frames.at(frames.size() - 1));
+        }
+        frame->update_from(data);
+        copy_ns_ += elapsed_ns(start);
+        if (complete) {
+            frame->seal();
+        }
 
-    frames_.back()->update_from(data);
+        auto replaced = frames.replace_back(std::move(frame));
+        epoch_.retire(new std::shared_ptr<Frame>(replaced));
+        epoch_.reclaim();
+        open_spare_ = nullptr;
+        open_spare_delta_ = nullptr;
+        if (!complete) {
+            open_spare_ = std::move(replaced);
+            open_spare_delta_ = std::make_unique<Frame>(data);
+        }
+    }
+    notify_data_changed();
 }
 
 void Scene::add_permanent_frame_data(const Frame &data) {
-    SpinGuard lock(frame_access_lock_);
-    permanent_frame_.update_from(data.all_contexts());
+    // Sent after each frame, mostly empty
+    if (data.empty()) {
+        return;
+    }
+    {
+        auto lock = lock_writer();
+        auto next = copy_snapshot();
+        const auto start = std::chrono::steady_clock::now();
+        auto permanent = std::make_shared<Frame>(*next->permanent);
+        permanent->update_from(data.all_contexts());
+        copy_ns_ += elapsed_ns(start);
+        next->permanent = std::move(permanent);
+        publish(std::move(next));
+        ++permanent_version_;
+    }
+    notify_data_changed();
 }
 
-void Scene::show_detailed_info(const glm::vec2 &mouse) const {
+void Scene::show_detailed_info(const glm::vec2 &mouse) {
     if (!active_frame_) {
         return;
     }
 
     const auto &popups = active_frame_->all_popups();
+    std::vector<uint32_t> hits;
+    bool popup_shown = false;
     for (size_t idx = 0; idx < popups.size(); ++idx) {
         if (!conf_.enabled_layers[idx]) {
             continue;
         }
-        for (const auto &popup : popups[idx]) {
-            if (popup.hit_test(mouse)) {
-                ImGui::BeginTooltip();
-                ImGui::Text("%s", popup.text());
-                ImGui::EndTooltip();
-            }
+        hits.clear();
+        active_frame_->hit_popups(idx, mouse, hits);
+        for (uint32_t popup_idx : hits) {
+            ImGui::BeginTooltip();
+            ImGui::Text("%s", popups[idx][popup_idx].text());
+            ImGui::EndTooltip();
+            popup_shown = true;
         }
     }
+
+    // Popups are written by user, so they are more informative than raw primitive
+    if (!popup_shown && hovered_valid_ && conf_.hover_primitives) {
+        show_primitive_tooltip(hovered_);
+    }
+    hover_requested_ = conf_.hover_primitives;
+    hover_point_ = mouse;
 }
 
 void Scene::clear_data() {
-    SpinGuard lock(frame_access_lock_);
-    frames_.clear();
-    active_frame_ = nullptr;
-    permanent_frame_.clear();
-    frames_count_ = 0;
-    cur_frame_idx_ = 0;
+    {
+        auto lock = lock_writer();
+        auto next = std::make_unique<snapshot_t>();
+        next->generation = snapshot_.load()->generation + 1;
+        publish(std::move(next));
+        ++permanent_version_;
+        open_spare_ = nullptr;
+        open_spare_delta_ = nullptr;
+    }
+    notify_data_changed();
 }
 
 bool Scene::has_data() const {
-    return frames_count_ > 0;
+    return get_frames_count() > 0;
+}
+
+void Scene::set_data_changed_callback(std::function<void()> callback) {
+    data_changed_callback_ = std::move(callback);
+}
+
+bool Scene::needs_redraw() const {
+    const bool pick_pending = renderer_ && renderer_->pick_pending();
+    return data_changed_ || rendered_frame_idx_ != cur_frame_idx_ || pick_pending;
+}
+
+void Scene::pick_hovered() {
+    uint32_t layers = 0;
+    for (size_t idx = 0; idx < Frame::LAYERS_COUNT; ++idx) {
+        // Heatmap has no separate primitives to hover
+        const bool pickable = conf_.enabled_layers[idx] && !conf_.heatmap_layers[idx];
+        layers |= static_cast<uint32_t>(pickable) << idx;
+    }
+    const uint32_t permanent_version = permanent_version_;
+    // Last frame object may be reused for updated content, so version is compared, not address
+    const uint64_t frame_version = active_frame_->version();
+    const bool changed = frame_version != picked_frame_version_ ||
+                         permanent_version != picked_permanent_version_ ||
+                         layers != picked_layers_;
+    picked_frame_version_ = frame_version;
+    picked_permanent_version_ = permanent_version;
+    picked_layers_ = layers;
+
+    // Batch copies primitives, so snapshot needed only while filling
+    const auto fill = [this, layers](RenderContext::PickBatch &batch) {
+        EpochDomain::ReadGuard guard(&epoch_);
+        const auto &perm_frame_contexts = snapshot_.load()->permanent->all_contexts();
+        const auto &frame_contexts = active_frame_->all_contexts();
+        for (uint32_t idx = 0; idx < Frame::LAYERS_COUNT; ++idx) {
+            if (layers & (1u << idx)) {
+                batch.add(perm_frame_contexts[idx], idx);
+                batch.add(frame_contexts[idx], idx);
+            }
+        }
+    };
+    hovered_valid_ = renderer_->pick(hover_point_, changed, fill, hovered_);
+}
+
+uint64_t Scene::prefetch_key() const {
+    uint64_t layers = 0;
+    for (size_t idx = 0; idx < Frame::LAYERS_COUNT; ++idx) {
+        // Heatmaps are computed on render thread
+        if (conf_.enabled_layers[idx] && conf_.heatmap_layers[idx]) {
+            return 0;
+        }
+        layers |= static_cast<uint64_t>(conf_.enabled_layers[idx]) << idx;
+    }
+    // Version in upper bits, so key is never zero
+    return (static_cast<uint64_t>(permanent_version_) + 1) << Frame::LAYERS_COUNT | layers;
+}
+
+void Scene::fill_prefetch_batch(const Frame &frame, uint64_t key, RenderContext::Batch &batch) {
+    EpochDomain::ReadGuard guard(&epoch_);
+    const auto &perm_frame_contexts = snapshot_.load()->permanent->all_contexts();
+    const auto &frame_contexts = frame.all_contexts();
+    for (size_t idx = 0; idx < Frame::LAYERS_COUNT; ++idx) {
+        if (key & (uint64_t{1} << idx)) {
+            batch.add(perm_frame_contexts[idx], static_cast<uint32_t>(idx));
+            batch.add(frame_contexts[idx], static_cast<uint32_t>(idx));
+        }
+    }
+}
+
+void Scene::prefetch_next_frames(int step, uint64_t key) {
+    // Nothing to predict if playback stopped
+    if (step == 0) {
+        return;
+    }
+
+    std::vector<std::shared_ptr<Frame>> frames;
+    {
+        EpochDomain::ReadGuard guard(&epoch_);
+        const auto &timeline = *snapshot_.load()->frames;
+        // Last frame may still get new primitives, so it never prefetched
+        const int last_idx = static_cast<int>(timeline.size()) - 1;
+        for (int k = 1; k <= conf_.prefetch_frames; ++k) {
+            const int idx = cur_frame_idx_ + step * k;
+            if (idx < 0 || idx >= last_idx) {
+                break;
+            }
+            frames.push_back(timeline.share(static_cast<size_t>(idx)));
+        }
+    }
+    renderer_->prefetch_frames(std::move(frames), key);
+}
+
+void Scene::update_active_frame() {
+    // Reset before reading frames, so data arrived during rendering triggers next redraw
+    data_changed_ = false;
+    rendered_frame_idx_ = cur_frame_idx_;
+
+    // Everything loaded by previous update may be deleted from now
+    if (frame_guard_) {
+        frame_guard_->refresh();
+    } else {
+        frame_guard_ = std::make_unique<EpochDomain::ReadGuard>(&epoch_);
+    }
+    const snapshot_t *snapshot = snapshot_.load();
+    if (snapshot->generation != generation_) {
+        // Data cleared
+        generation_ = snapshot->generation;
+        cur_frame_idx_ = 0;
+        frame_stats_.clear();
+        text_index_.reset();
+    }
+    timeline_ = snapshot->frames.get();
+    frame_stats_.update(*timeline_);
+    const int frames_count = get_frames_count();
+    active_frame_ = nullptr;
+    if (cur_frame_idx_ >= 0 && cur_frame_idx_ < frames_count) {
+        active_frame_ = timeline_->at(static_cast<size_t>(cur_frame_idx_));
+    }
+
+    if (conf_.search_index) {
+        index_new_frames();
+    }
+}
+
+void Scene::index_new_frames() {
+    // Frames indexed per job, so reset or shutdown never waits long
+    constexpr uint32_t BATCH_FRAMES = 4096;
+
+    // The last frame may still get data in immediate mode
+    const size_t complete = timeline_->size() > 0 ? timeline_->size() - 1 : 0;
+    if (indexing_ || text_index_.frames_count() >= complete) {
+        return;
+    }
+    indexing_ = true;
+    JobSystem::shared().submit(
+        JobSystem::Priority::BACKGROUND,
+        [this] {
+            auto batch = text_index_.start_batch();
+            for (uint32_t idx = batch.first_frame(); batch.frames_count() < BATCH_FRAMES; ++idx) {
+                // Null for the last frame, it is indexed once complete
+                auto frame = frame_at(static_cast<int>(idx));
+                if (!frame) {
+                    break;
+                }
+                batch.add_frame(*frame);
+            }
+            // Rejected if frames were cleared meanwhile, next job starts over
+            text_index_.commit(std::move(batch));
+            indexing_ = false;
+        },
+        &index_jobs_);
+}
+
+void Scene::queue_software(const Frame *frame, uint32_t layers, SoftwareRenderer &target) {
+    target.clear(glm::vec4{0.0f});
+
+    // Same background and grid as GPU renderer draws
+    RenderContext background;
+    const glm::vec2 area = conf_.grid_dim;
+    background.add_rectangle({0.0f, 0.0f}, area, glm::vec4{glm::vec3{conf_.scene_color}, 1.0f},
+                             true);
+    if (conf_.show_grid) {
+        const glm::vec4 grid_color{glm::vec3{conf_.grid_color}, 1.0f};
+        const glm::vec2 step = area / glm::vec2{conf_.grid_cells};
+        for (int i = 0; i <= conf_.grid_cells.x; ++i) {
+            const float x = step.x * static_cast<float>(i);
+            background.add_polyline({{x, 0.0f}, {x, area.y}}, grid_color);
+        }
+        for (int i = 0; i <= conf_.grid_cells.y; ++i) {
+            const float y = step.y * static_cast<float>(i);
+            background.add_polyline({{0.0f, y}, {area.x, y}}, grid_color);
+        }
+    }
+    target.queue_primitives(background);
+
+    if (!frame) {
+        return;
+    }
+    // Primitives are copied, so snapshot needed only while queueing
+    EpochDomain::ReadGuard guard(&epoch_);
+    const auto &perm_frame_contexts = snapshot_.load()->permanent->all_contexts();
+    const auto &frame_contexts = frame->all_contexts();
+    for (size_t idx = 0; idx < Frame::LAYERS_COUNT; ++idx) {
+        if (layers & (uint32_t{1} << idx)) {
+            target.queue_primitives(perm_frame_contexts[idx]);
+            target.queue_primitives(frame_contexts[idx]);
+        }
+    }
+}
+
+std::unique_ptr<Scene::snapshot_t> Scene::copy_snapshot() {
+    // Only writers replace snapshot, so current one stays alive under writer lock
+    const auto start = std::chrono::steady_clock::now();
+    auto snapshot = std::make_unique<snapshot_t>(*snapshot_.load());
+    copy_ns_ += elapsed_ns(start);
+    return snapshot;
+}
+
+void Scene::publish(std::unique_ptr<snapshot_t> snapshot) {
+    snapshot_.publish(std::move(snapshot));
+    ++published_;
+}
+
+std::unique_lock<std::mutex> Scene::lock_writer() {
+    std::unique_lock<std::mutex> lock(writer_mutex_, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        const auto start = std::chrono::steady_clock::now();
+        lock.lock();
+        ++writer_waits_;
+        writer_wait_ns_ += elapsed_ns(start);
+    }
+    return lock;
+}
+
+Scene::sync_stats_t Scene::sync_stats() const {
+    sync_stats_t stats;
+    stats.published = published_;
+    stats.writer_waits = writer_waits_;
+    stats.writer_wait_ms = static_cast<double>(writer_wait_ns_) * 1e-6;
+    stats.copy_ms = static_cast<double>(copy_ns_) * 1e-6;
+    stats.reclamation = epoch_.stats();
+    return stats;
+}
+
+void Scene::notify_data_changed() {
+    data_changed_ = true;
+    if (data_changed_callback_) {
+        data_changed_callback_();
+    }
+}
+
+const RenderContext::Batch::draw_stats_t &Scene::draw_stats() const {
+    return renderer_->primitives_stats();
+}
+
+GpuTimer *Scene::gpu_timer() {
+    return renderer_ ? &renderer_->gpu_timer() : nullptr;
+}
+
+void Scene::benchmark_circles() {
+    renderer_->benchmark_circles(1000000, 10);
 }
@@ -6,16 +6,25 @@
 
 #include <cgutils/Camera.h>
 #include <cgutils/ResourceManager.h>
-#include <common/Spinlock.h>
+#include <common/JobSystem.h>
+#include <common/Rcu.h>
 #include <viewer/Config.h>
-#include <viewer/FrameEditor.h>
+#include <viewer/Frame.h>
+#include <viewer/FrameSink.h>
+#include <viewer/FrameStatsTimeline.h>
+#include <viewer/FrameTimeline.h>
+#include <viewer/TextIndex.h>
 
 #include <glm/glm.hpp>
 
+#include <atomic>
+#include <functional>
 #include <memory>
 #include <mutex>
 
+class GpuTimer;
 class Renderer;
+class SoftwareRenderer;
 
 /**
  * Represent whole game state.
@@ -25,14 +34,30 @@ class Renderer;
  *  - get new Frame from NetClient
  *  - configurable from UI
  */
-class Scene {
+class Scene : public FrameSink {
  public:
+    /// @param res - may be null for scene drawn only with render_software(), no GL needed then
     explicit Scene(ResourceManager *res, const Config::SceneConf *conf);
-    ~Scene();
+    ~Scene() override;
 
     /// @note: Called from render thread
     void update_and_render(const Camera &cam);
 
+    /// Draw current frame on CPU, heatmap layers drawn as usual primitives
+    /// @note Called from render thread
+    void render_software(SoftwareRenderer &target, const Camera &cam);
+
+    /// Draw frame with enabled layers mask on CPU, target transform should be set by caller
+    /// @note May be called from any thread
+    void render_frame_software(const Frame &frame, uint32_t layers, SoftwareRenderer &target);
+
+    /// Frame by index, null if out of range or frame is the last one, which may be replaced
+    /// @note May be called from any thread
+    std::shared_ptr<Frame> frame_at(int idx);
+
+    /// Incremented on each permanent frame change
+    uint32_t permanent_version() const;
+
     /// Set frame to draw now, index should be in range [0, frames_count)
     /// @note Called from render thread
     void set_frame_index(int idx);
@@ -40,7 +65,7 @@ class Scene {
     /// @note Called from render thread
     int get_frame_index() const;
 
-    /// Total loaded frames count
+    /// Total loaded frames count, grows without waiting for next update_and_render
     /// @note Called from render thread
     int get_frames_count() const;
 
@@ -48,42 +73,175 @@ class Scene {
     /// @note Called from render thread
     const char *get_frame_user_message();
 
+    /// Lines count of current frame message
+    /// @note Called from render thread
+    size_t get_frame_message_lines() const;
+
+    /// Line of current frame message, valid until next update_and_render
+    /// @note Called from render thread
+    Frame::text_range_t get_frame_message_line(size_t idx) const;
+
     /// Called from network listener when next frame is ready
-    void add_frame(std::shared_ptr<Frame> frame);
+    void add_frame(std::shared_ptr<Frame> frame) override;
+
+    /// Frames which message or popups contain all words of query, ascending.
+    /// Frames are indexed in background as they arrive, the last one once next arrives
+    /// @note May be called from any thread
+    std::vector<uint32_t> find_frames(const std::string &query) const;
+
+    /// Frames covered by find_frames() so far
+    /// @note May be called from any thread
+    size_t searchable_frames_count() const;
+
+    /// Statistics of all frames, up to date after last update_and_render
+    /// @note Called from render thread
+    const FrameStatsTimeline &frame_stats() const;
 
-    /// Add data to last appended frame
+    /// Add data to last appended frame, it is indexed once complete
     /// @note Called from network thread
-    void add_frame_data(const Frame &data);
+    void add_frame_data(const Frame &data, bool complete) override;
 
     /// Add primitives to permanent frame
     /// @note Called from network thread
-    void add_permanent_frame_data(const Frame &data);
+    void add_permanent_frame_data(const Frame &data) override;
 
-    /// Show detailed info in tooltip if mouse hover unit
+    /// Show detailed info in tooltip if mouse hover unit, or attributes of hovered primitive.
+    /// Primitive is looked up during next update_and_render, so it is shown a frame later
     /// @note Called from render thread
-    void show_detailed_info(const glm::vec2 &mouse) const;
+    void show_detailed_info(const glm::vec2 &mouse);
 
     /// Remove all frames and clear permanent frame
     /// @note May be called from network thread or render thread
-    void clear_data();
+    void clear_data() override;
 
     /// True if has at least one frame
     /// @note Called from render thread
     bool has_data() const;
 
+    /// Callback invoked after any data change, used to wake up sleeping render loop
+    /// @note Set before network thread started, callback is called from network thread
+    void set_data_changed_callback(std::function<void()> callback);
+
+    /// True if new data arrived or frame index changed since last update_and_render
+    /// @note Called from render thread
+    bool needs_redraw() const;
+
+    /// Drawn elements, draw calls and uploaded vertices for last rendered frame
+    /// @note Called from render thread
+    const RenderContext::Batch::draw_stats_t &draw_stats() const;
+
+    /// GPU time of render passes, null without GPU renderer
+    /// @note Called from render thread
+    GpuTimer *gpu_timer();
+
+    /// Data publication statistics
+    struct sync_stats_t {
+        uint64_t published = 0;
+        /// Writers waited for each other, e.g. clear from UI during network update
+        uint64_t writer_waits = 0;
+        double writer_wait_ms = 0.0;
+        /// Total time spent copying state before publication
+        double copy_ms = 0.0;
+        EpochDomain::stats_t reclamation;
+    };
+
+    /// @note May be called from any thread
+    sync_stats_t sync_stats() const;
+
+    /// Compare circles drawing methods, result written to log
+    /// @note Called from render thread
+    void benchmark_circles();
+
  private:
+    void notify_data_changed();
+
+    /// Pick frame at current index and reset redraw tracking
+    void update_active_frame();
+
+    /// Clear target and queue background, grid and layers of frame
+    void queue_software(const Frame *frame, uint32_t layers, SoftwareRenderer &target);
+
+    /// Key of prefetched frames batches: enabled layers and permanent frame version.
+    /// Zero if current config can't be prefetched
+    uint64_t prefetch_key() const;
+    /// Queue primitives of enabled layers, called from worker thread
+    void fill_prefetch_batch(const Frame &frame, uint64_t key, RenderContext::Batch &batch);
+    /// Index text of complete frames in background, if not indexing already
+    void index_new_frames();
+
+    /// Look up primitive under hover point in enabled layers
+    void pick_hovered();
+
+    /// Request background preparation of next frames in playback direction
+    void prefetch_next_frames(int step, uint64_t key);
+
+    /**
+     * Everything network thread produces, published as a whole. Readers never lock, they see
+     * either old or new snapshot. Frames are appended to timeline in place, so new snapshot
+     * is published only on clear and permanent frame change.
+     */
+    struct snapshot_t {
+        std::shared_ptr<FrameTimeline> frames = std::make_shared<FrameTimeline>();
+        /// Rendered each time before active frame
+        std::shared_ptr<const Frame> permanent = std::make_shared<Frame>();
+        /// Incremented on clear
+        uint32_t generation = 0;
+    };
+
+    /// Copy current snapshot for change, writer lock should be held
+    std::unique_ptr<snapshot_t> copy_snapshot();
+    void publish(std::unique_ptr<snapshot_t> snapshot);
+
+    /// Serializes writers, readers don't use it
+    std::unique_lock<std::mutex> lock_writer();
+
     const Config::SceneConf &conf_;
 
     std::unique_ptr<Renderer> renderer_;
 
-    Spinlock frame_access_lock_;
+    EpochDomain epoch_;
+    RcuCell<snapshot_t> snapshot_;
+    std::mutex writer_mutex_;
 
-    int cur_frame_idx_ = 0;
-    int frames_count_ = 0;
-    std::shared_ptr<Frame> active_frame_ = nullptr;
-    std::vector<std::shared_ptr<Frame>> frames_;
+    /// Render thread read section, refreshed on each update, so frames loaded during update
+    /// stay alive until next one
+    std::unique_ptr<EpochDomain::ReadGuard> frame_guard_;
+    const FrameTimeline *timeline_ = nullptr;
+    uint32_t generation_ = 0;
 
-    /// Permanent frame rendered each time before active_frame
-    /// Use FrameEditor to clear() on clear_data() calls
-    FrameEditor permanent_frame_;
+    int cur_frame_idx_ = 0;
+    const Frame *active_frame_ = nullptr;
+
+    std::atomic<uint64_t> published_{0};
+    std::atomic<uint64_t> writer_waits_{0};
+    std::atomic<uint64_t> writer_wait_ns_{0};
+    std::atomic<uint64_t> copy_ns_{0};
+
+    /// Last frame as it was before latest add_frame_data(), reused for next update once no
+    /// reader holds it, so open frame isn't copied on every immediate mode message
+    std::shared_ptr<Frame> open_spare_;
+    /// Data spare frame lacks
+    std::unique_ptr<Frame> open_spare_delta_;
+
+    std::function<void()> data_changed_callback_;
+    std::atomic<bool> data_changed_{true};
+    /// Incremented on each permanent frame change
+    std::atomic<uint32_t> permanent_version_{0};
+    int rendered_frame_idx_ = -1;
+
+    FrameStatsTimeline frame_stats_;
+    TextIndex text_index_;
+    /// At most one indexing job at a time
+    std::atomic<bool> indexing_{false};
+    JobSystem::Group index_jobs_;
+
+    /// Hover point set by show_detailed_info for the next update
+    bool hover_requested_ = false;
+    glm::vec2 hover_point_{};
+    /// Content of ID buffer, compared to find out if it should be redrawn
+    uint64_t picked_frame_version_ = 0;
+    uint32_t picked_permanent_version_ = 0;
+    uint32_t picked_layers_ = 0;
+    bool hovered_valid_ = false;
+    RenderContext::picked_t hovered_;
 };
@@ -4,7 +4,37 @@
 
 #include "ShaderCollection.h"
 
+#include <common/logger.h>
+
+#include <cstring>
+
+namespace {
+
+/// Geometry shaders are slow on software rasterizers, hardware is left to measurement
+bool geometry_shader_is_slow() {
+    const auto renderer = reinterpret_cast<const char *>(glGetString(GL_RENDERER));
+    if (!renderer) {
+        return false;
+    }
+    for (const char *name : {"llvmpipe", "softpipe", "SWR"}) {
+        if (strstr(renderer, name)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+}  // anonymous namespace
+
 ShaderCollection::ShaderCollection()
     : color_pos("color_pos.vert", "color_pos.frag")
     , circle("circle.vert", "circle.frag", "circle.geom")
-    , color("simple.vert", "uniform_color.frag") {}
+    , circle_instanced("circle_instanced.vert", "circle.frag")
+    , color("simple.vert", "uniform_color.frag")
+    , heatmap("simple.vert", "heatmap.frag")
+    , pick("pick.vert", "pick.frag")
+    , pick_circle("pick_circle.vert", "pick_circle.frag")
+    , prefer_instanced_circles(geometry_shader_is_slow())
+    , instanced_circles(prefer_instanced_circles) {
+    LOG_INFO("Circles drawing method: %s", instanced_circles ? "instancing" : "geometry shader");
+}
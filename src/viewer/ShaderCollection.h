@@ -10,6 +10,18 @@ struct ShaderCollection {
 
     Shader color_pos;
     Shader circle;
+    // Circles expanded from static quad with instancing, no geometry shader involved
+    Shader circle_instanced;
     // Forward pass vertices with uniform-specified color
     Shader color;
+    // Density texture with color mapping
+    Shader heatmap;
+    // Primitive ids for picking, every fragment colored with id of its primitive
+    Shader pick;
+    Shader pick_circle;
+
+    /// Instanced circles preferred for current driver, updated by circles benchmark
+    bool prefer_instanced_circles;
+    /// Draw circles with circle_instanced instead of circle
+    bool instanced_circles;
 };
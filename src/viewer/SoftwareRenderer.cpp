@@ -0,0 +1,499 @@
+//
+// Created by valdemar on 18.10.26.
+//
+
+#include "SoftwareRenderer.h"
+
+#include <common/JobSystem.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define SOFTWARE_RENDERER_AVX2
+#include <immintrin.h>
+#endif
+
+namespace {
+
+constexpr int TILE_SIZE = 64;
+
+using primitive_t = RenderContext::primitive_t;
+
+struct raster_vertex_t {
+    /// Window coordinates, pixel centers are at half integers
+    glm::vec2 pos;
+    glm::vec4 color;
+};
+
+struct raster_circle_t {
+    /// World coordinates, as circle shader computes distance in world space
+    glm::vec2 center;
+    float radius;
+    glm::vec4 color;
+};
+
+struct raster_primitive_t {
+    primitive_t kind;
+    /// First vertex for triangles and lines, circle index otherwise
+    uint32_t first;
+    /// Inclusive pixel bounds clipped to image
+    glm::ivec2 min_px;
+    glm::ivec2 max_px;
+};
+
+/// Fragment color prepared for blending with 8-bit channels
+struct blend_color_t {
+    /// Channels multiplied by alpha, alpha channel blended by itself as GL_SRC_ALPHA does
+    uint16_t premul[4];
+    uint16_t inv_alpha;
+};
+
+uint8_t to_unorm8(float value) {
+    return static_cast<uint8_t>(std::lround(std::min(std::max(value, 0.0f), 1.0f) * 255.0f));
+}
+
+blend_color_t make_blend_color(const glm::vec4 &color) {
+    const uint16_t alpha = to_unorm8(color.a);
+    blend_color_t res;
+    for (int k = 0; k < 3; ++k) {
+        res.premul[k] = static_cast<uint16_t>(to_unorm8(color[k]) * alpha);
+    }
+    res.premul[3] = static_cast<uint16_t>(alpha * alpha);
+    res.inv_alpha = static_cast<uint16_t>(255 - alpha);
+    return res;
+}
+
+/// Exact round(value / 255) for value up to 255 * 255, intermediate fits 16 bits
+inline uint8_t div255(uint32_t value) {
+    value += 128;
+    return static_cast<uint8_t>((value + (value >> 8)) >> 8);
+}
+
+inline void blend_pixel(uint8_t *px, const blend_color_t &color) {
+    for (int k = 0; k < 4; ++k) {
+        px[k] = div255(color.premul[k] + px[k] * color.inv_alpha);
+    }
+}
+
+void blend_span_scalar(uint8_t *px, size_t count, const blend_color_t &color) {
+    for (size_t idx = 0; idx < count; ++idx, px += 4) {
+        blend_pixel(px, color);
+    }
+}
+
+#ifdef SOFTWARE_RENDERER_AVX2
+/// Same formula as blend_pixel() for sixteen 16-bit channels
+__attribute__((target("avx2"))) inline __m256i blend_avx2(__m256i dst, __m256i premul,
+                                                          __m256i inv_alpha) {
+    __m256i value = _mm256_add_epi16(_mm256_mullo_epi16(dst, inv_alpha), premul);
+    value = _mm256_add_epi16(value, _mm256_set1_epi16(128));
+    value = _mm256_add_epi16(value, _mm256_srli_epi16(value, 8));
+    return _mm256_srli_epi16(value, 8);
+}
+
+/// Eight pixels per iteration, bit exact with scalar version
+__attribute__((target("avx2"))) void blend_span_avx2(uint8_t *px, size_t count,
+                                                     const blend_color_t &color) {
+    const auto *p = color.premul;
+    const __m256i premul = _mm256_setr_epi16(p[0], p[1], p[2], p[3], p[0], p[1], p[2], p[3],
+                                             p[0], p[1], p[2], p[3], p[0], p[1], p[2], p[3]);
+    const __m256i inv_alpha = _mm256_set1_epi16(static_cast<int16_t>(color.inv_alpha));
+    const __m256i zero = _mm256_setzero_si256();
+
+    size_t idx = 0;
+    for (; idx + 8 <= count; idx += 8, px += 32) {
+        const __m256i dst = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(px));
+        // Unpack and pack work inside 128-bit lanes, so pixels order is kept
+        const __m256i lo = blend_avx2(_mm256_unpacklo_epi8(dst, zero), premul, inv_alpha);
+        const __m256i hi = blend_avx2(_mm256_unpackhi_epi8(dst, zero), premul, inv_alpha);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(px), _mm256_packus_epi16(lo, hi));
+    }
+    blend_span_scalar(px, count - idx, color);
+}
+#endif
+
+using blend_span_fn_t = void (*)(uint8_t *, size_t, const blend_color_t &);
+
+blend_span_fn_t select_blend_span() {
+#ifdef SOFTWARE_RENDERER_AVX2
+    if (__builtin_cpu_supports("avx2")) {
+        return blend_span_avx2;
+    }
+#endif
+    return blend_span_scalar;
+}
+
+const blend_span_fn_t blend_span_simd = select_blend_span();
+
+void blend_span(uint8_t *px, size_t count, const blend_color_t &color) {
+    if (color.inv_alpha == 255) {
+        // Fully transparent
+        return;
+    }
+    if (color.inv_alpha == 0) {
+        const uint8_t rgba[4] = {div255(color.premul[0]), div255(color.premul[1]),
+                                 div255(color.premul[2]), 255};
+        for (size_t idx = 0; idx < count; ++idx, px += 4) {
+            memcpy(px, rgba, 4);
+        }
+        return;
+    }
+    blend_span_simd(px, count, color);
+}
+
+double cross(glm::dvec2 a, glm::dvec2 b) {
+    return a.x * b.y - a.y * b.x;
+}
+
+}  // anonymous namespace
+
+struct SoftwareRenderer::raster_state_t {
+    glm::ivec2 size;
+    size_t threads;
+    std::vector<uint8_t> pixels;
+
+    // World to window affine transform by columns and its inverse
+    glm::vec2 window_x{};
+    glm::vec2 window_y{};
+    glm::vec2 window_shift{};
+    glm::vec2 world_x{};
+    glm::vec2 world_y{};
+    glm::vec2 world_shift{};
+
+    std::vector<raster_vertex_t> vertices;
+    std::vector<raster_circle_t> circles;
+    std::vector<raster_primitive_t> primitives;
+
+    glm::ivec2 tiles_count;
+    // Indices of primitives touching tile, in queue order
+    std::vector<std::vector<uint32_t>> tile_primitives;
+
+    glm::vec2 window_pos(glm::vec2 world) const {
+        return window_x * world.x + window_y * world.y + window_shift;
+    }
+
+    uint8_t *pixel(int x, int y) {
+        return &pixels[(static_cast<size_t>(y) * size.x + x) * 4];
+    }
+
+    /// Pixels which centers may fall into window area, false if nothing visible
+    bool clip_bounds(glm::vec2 min_pos, glm::vec2 max_pos, raster_primitive_t &prim) const {
+        prim.min_px = {std::max(static_cast<int>(std::floor(min_pos.x)), 0),
+                       std::max(static_cast<int>(std::floor(min_pos.y)), 0)};
+        prim.max_px = {static_cast<int>(std::min(std::floor(max_pos.x), size.x - 1.0f)),
+                       static_cast<int>(std::min(std::floor(max_pos.y), size.y - 1.0f))};
+        return prim.min_px.x <= prim.max_px.x && prim.min_px.y <= prim.max_px.y;
+    }
+
+    void rasterize_tile(glm::ivec2 tile_min, glm::ivec2 tile_max,
+                        const std::vector<uint32_t> &tile_prims) {
+        for (uint32_t idx : tile_prims) {
+            const auto &prim = primitives[idx];
+            const glm::ivec2 min_px{std::max(tile_min.x, prim.min_px.x),
+                                    std::max(tile_min.y, prim.min_px.y)};
+            const glm::ivec2 max_px{std::min(tile_max.x, prim.max_px.x),
+                                    std::min(tile_max.y, prim.max_px.y)};
+            switch (prim.kind) {
+                case primitive_t::TRIANGLE:
+                    draw_triangle(&vertices[prim.first], min_px, max_px);
+                    break;
+                case primitive_t::LINE:
+                    draw_line(&vertices[prim.first], min_px, max_px);
+                    break;
+                case primitive_t::FILLED_CIRCLE:
+                    draw_circle(circles[prim.first], true, min_px, max_px);
+                    break;
+                case primitive_t::THIN_CIRCLE:
+                    draw_circle(circles[prim.first], false, min_px, max_px);
+                    break;
+            }
+        }
+    }
+
+    /// Pixel centers inside triangle, edges shared by two triangles are drawn once
+    void draw_triangle(const raster_vertex_t *v, glm::ivec2 min_px, glm::ivec2 max_px) {
+        int order[3] = {0, 1, 2};
+        glm::dvec2 p[3] = {v[0].pos, v[1].pos, v[2].pos};
+        double area = cross(p[1] - p[0], p[2] - p[0]);
+        if (area == 0.0) {
+            return;
+        }
+        // Counter clockwise in window coordinates, so inside is to the left of each edge
+        if (area < 0.0) {
+            std::swap(p[1], p[2]);
+            std::swap(order[1], order[2]);
+            area = -area;
+        }
+        const glm::vec4 &c0 = v[order[0]].color;
+        const glm::vec4 &c1 = v[order[1]].color;
+        const glm::vec4 &c2 = v[order[2]].color;
+        const bool flat = c0 == c1 && c0 == c2;
+        const blend_color_t flat_color = make_blend_color(c0);
+
+        // Linear color interpolation by barycentric coordinates
+        const glm::dvec2 e1 = p[1] - p[0];
+        const glm::dvec2 e2 = p[2] - p[0];
+        const glm::vec4 dc1 = c1 - c0;
+        const glm::vec4 dc2 = c2 - c0;
+        const glm::vec4 dcdx =
+            static_cast<float>(e2.y / area) * dc1 - static_cast<float>(e1.y / area) * dc2;
+        const glm::vec4 dcdy =
+            static_cast<float>(e1.x / area) * dc2 - static_cast<float>(e2.x / area) * dc1;
+
+        for (int y = min_px.y; y <= max_px.y; ++y) {
+            const double yc = y + 0.5;
+            int lo = min_px.x;
+            int hi = max_px.x + 1;
+            bool empty = false;
+            for (int e = 0; e < 3 && !empty; ++e) {
+                const glm::dvec2 a = p[e];
+                const glm::dvec2 b = p[(e + 1) % 3];
+                if (a.y == b.y) {
+                    // Horizontal edge is inclusive only as top one, going right to left
+                    const double side = (b.x - a.x) * (yc - a.y);
+                    empty = side < 0.0 || (side == 0.0 && b.x > a.x);
+                    continue;
+                }
+                // Same value computed for edge shared with adjacent triangle
+                const glm::dvec2 low = a.y < b.y ? a : b;
+                const glm::dvec2 high = a.y < b.y ? b : a;
+                const double x_cross = low.x + (yc - low.y) * (high.x - low.x) / (high.y - low.y);
+                const auto bound = static_cast<int>(std::ceil(x_cross - 0.5));
+                if (b.y < a.y) {
+                    // Left edge, inclusive
+                    lo = std::max(lo, bound);
+                } else {
+                    hi = std::min(hi, bound);
+                }
+            }
+            if (empty || lo >= hi) {
+                continue;
+            }
+
+            uint8_t *px = pixel(lo, y);
+            if (flat) {
+                blend_span(px, static_cast<size_t>(hi - lo), flat_color);
+                continue;
+            }
+            glm::vec4 color = c0 + dcdx * static_cast<float>(lo + 0.5 - p[0].x) +
+                              dcdy * static_cast<float>(yc - p[0].y);
+            for (int x = lo; x < hi; ++x, px += 4) {
+                blend_pixel(px, make_blend_color(color));
+                color += dcdx;
+            }
+        }
+    }
+
+    /// One pixel per column or row along major axis, last pixel is left for next segment
+    void draw_line(const raster_vertex_t *v, glm::ivec2 min_px, glm::ivec2 max_px) {
+        const glm::vec2 a = v[0].pos;
+        const glm::vec2 d = v[1].pos - a;
+        if (d.x == 0.0f && d.y == 0.0f) {
+            return;
+        }
+        const int major = std::abs(d.x) >= std::abs(d.y) ? 0 : 1;
+        const int minor = 1 - major;
+
+        int first;
+        int last;
+        if (d[major] > 0.0f) {
+            first = static_cast<int>(std::ceil(a[major] - 0.5f));
+            last = static_cast<int>(std::ceil(a[major] + d[major] - 0.5f)) - 1;
+        } else {
+            first = static_cast<int>(std::floor(a[major] + d[major] - 0.5f)) + 1;
+            last = static_cast<int>(std::floor(a[major] - 0.5f));
+        }
+        first = std::max(first, min_px[major]);
+        last = std::min(last, max_px[major]);
+
+        for (int i = first; i <= last; ++i) {
+            const float t = (i + 0.5f - a[major]) / d[major];
+            const auto j = static_cast<int>(std::floor(a[minor] + t * d[minor]));
+            if (j < min_px[minor] || j > max_px[minor]) {
+                continue;
+            }
+            const glm::vec4 color = v[0].color + (v[1].color - v[0].color) * t;
+            blend_pixel(major == 0 ? pixel(i, j) : pixel(j, i), make_blend_color(color));
+        }
+    }
+
+    /// Circle quad with hard edge at radius, thin circles keep only ring as wide as
+    /// fwidth of distance to center
+    void draw_circle(const raster_circle_t &circle, bool filled, glm::ivec2 min_px,
+                     glm::ivec2 max_px) {
+        const blend_color_t color = make_blend_color(circle.color);
+        const float radius2 = circle.radius * circle.radius;
+
+        for (int y = min_px.y; y <= max_px.y; ++y) {
+            glm::vec2 rel = world_x * (min_px.x + 0.5f) + world_y * (y + 0.5f) + world_shift -
+                            circle.center;
+            int run_start = -1;
+            for (int x = min_px.x; x <= max_px.x + 1; ++x, rel += world_x) {
+                bool inside = false;
+                if (x <= max_px.x) {
+                    const float dist2 = glm::dot(rel, rel);
+                    inside = dist2 < radius2;
+                    if (inside && !filled) {
+                        const float dist = std::sqrt(dist2);
+                        const glm::vec2 grad = dist > 0.0f ? rel / dist : glm::vec2{0.0f};
+                        const float fwidth =
+                            std::abs(glm::dot(grad, world_x)) + std::abs(glm::dot(grad, world_y));
+                        inside = dist >= circle.radius - fwidth;
+                    }
+                }
+                if (inside && run_start < 0) {
+                    run_start = x;
+                } else if (!inside && run_start >= 0) {
+                    blend_span(pixel(run_start, y), static_cast<size_t>(x - run_start), color);
+                    run_start = -1;
+                }
+            }
+        }
+    }
+};
+
+SoftwareRenderer::SoftwareRenderer(glm::ivec2 size, size_t threads) {
+    if (size.x <= 0 || size.y <= 0) {
+        throw std::runtime_error("Software renderer image size should be positive");
+    }
+    state_ = std::make_unique<raster_state_t>();
+    state_->size = size;
+    // Caller thread rasterizes too
+    state_->threads = threads > 0 ? threads : JobSystem::shared().threads_count() + 1;
+    state_->pixels.resize(static_cast<size_t>(size.x) * size.y * 4);
+    state_->tiles_count = (size + TILE_SIZE - 1) / TILE_SIZE;
+    state_->tile_primitives.resize(static_cast<size_t>(state_->tiles_count.x) *
+                                   state_->tiles_count.y);
+    set_proj_view(glm::mat4{1.0f});
+}
+
+SoftwareRenderer::~SoftwareRenderer() = default;
+
+glm::ivec2 SoftwareRenderer::size() const {
+    return state_->size;
+}
+
+void SoftwareRenderer::set_proj_view(const glm::mat4 &proj_view) {
+    auto &st = *state_;
+    // Clip space to window coordinates as viewport transform does
+    const glm::vec2 half_size = glm::vec2{st.size} * 0.5f;
+    st.window_x = glm::vec2{proj_view[0][0], proj_view[0][1]} * half_size;
+    st.window_y = glm::vec2{proj_view[1][0], proj_view[1][1]} * half_size;
+    st.window_shift = (glm::vec2{proj_view[3][0], proj_view[3][1]} + 1.0f) * half_size;
+
+    const float det = st.window_x.x * st.window_y.y - st.window_y.x * st.window_x.y;
+    if (det == 0.0f) {
+        throw std::runtime_error("Degenerate software renderer transform");
+    }
+    st.world_x = glm::vec2{st.window_y.y, -st.window_x.y} / det;
+    st.world_y = glm::vec2{-st.window_y.x, st.window_x.x} / det;
+    st.world_shift = -(st.world_x * st.window_shift.x + st.world_y * st.window_shift.y);
+}
+
+void SoftwareRenderer::clear(glm::vec4 color) {
+    const uint8_t rgba[4] = {to_unorm8(color.r), to_unorm8(color.g), to_unorm8(color.b),
+                             to_unorm8(color.a)};
+    auto &pixels = state_->pixels;
+    for (size_t idx = 0; idx < pixels.size(); idx += 4) {
+        memcpy(&pixels[idx], rgba, 4);
+    }
+    state_->vertices.clear();
+    state_->circles.clear();
+    state_->primitives.clear();
+}
+
+void SoftwareRenderer::queue_primitives(const RenderContext &ctx) {
+    auto &st = *state_;
+    ctx.visit_primitives([&st](primitive_t kind, const RenderContext::vertex_t *vertices,
+                               float radius) {
+        raster_primitive_t prim{kind, 0, {}, {}};
+        glm::vec2 min_pos{std::numeric_limits<float>::max()};
+        glm::vec2 max_pos{std::numeric_limits<float>::lowest()};
+        const auto add_bound = [&](glm::vec2 pos) {
+            min_pos = {std::min(min_pos.x, pos.x), std::min(min_pos.y, pos.y)};
+            max_pos = {std::max(max_pos.x, pos.x), std::max(max_pos.y, pos.y)};
+        };
+
+        if (kind == primitive_t::TRIANGLE || kind == primitive_t::LINE) {
+            const size_t count = kind == primitive_t::TRIANGLE ? 3 : 2;
+            prim.first = static_cast<uint32_t>(st.vertices.size());
+            for (size_t k = 0; k < count; ++k) {
+                const glm::vec2 pos = st.window_pos(vertices[k].pos);
+                st.vertices.push_back({pos, vertices[k].color});
+                add_bound(pos);
+            }
+            if (!st.clip_bounds(min_pos, max_pos, prim)) {
+                st.vertices.resize(prim.first);
+                return;
+            }
+        } else {
+            const glm::vec2 center = vertices[0].pos;
+            for (glm::vec2 corner : {glm::vec2{-1.0f, -1.0f}, glm::vec2{1.0f, -1.0f},
+                                     glm::vec2{1.0f, 1.0f}, glm::vec2{-1.0f, 1.0f}}) {
+                add_bound(st.window_pos(center + corner * radius));
+            }
+            if (!st.clip_bounds(min_pos, max_pos, prim)) {
+                return;
+            }
+            prim.first = static_cast<uint32_t>(st.circles.size());
+            st.circles.push_back({center, radius, vertices[0].color});
+        }
+        st.primitives.push_back(prim);
+    });
+}
+
+void SoftwareRenderer::flush() {
+    auto &st = *state_;
+    if (st.primitives.empty()) {
+        return;
+    }
+
+    for (auto &bin : st.tile_primitives) {
+        bin.clear();
+    }
+    for (size_t idx = 0; idx < st.primitives.size(); ++idx) {
+        const auto &prim = st.primitives[idx];
+        for (int ty = prim.min_px.y / TILE_SIZE; ty <= prim.max_px.y / TILE_SIZE; ++ty) {
+            for (int tx = prim.min_px.x / TILE_SIZE; tx <= prim.max_px.x / TILE_SIZE; ++tx) {
+                st.tile_primitives[static_cast<size_t>(ty) * st.tiles_count.x + tx].push_back(
+                    static_cast<uint32_t>(idx));
+            }
+        }
+    }
+
+    // Tiles never overlap, so workers write pixels without synchronization
+    const size_t tiles = st.tile_primitives.size();
+    std::atomic<size_t> next_tile{0};
+    const auto work = [&] {
+        for (size_t tile = next_tile++; tile < tiles; tile = next_tile++) {
+            if (st.tile_primitives[tile].empty()) {
+                continue;
+            }
+            const glm::ivec2 tile_min{static_cast<int>(tile % st.tiles_count.x) * TILE_SIZE,
+                                      static_cast<int>(tile / st.tiles_count.x) * TILE_SIZE};
+            const glm::ivec2 tile_max{std::min(tile_min.x + TILE_SIZE, st.size.x) - 1,
+                                      std::min(tile_min.y + TILE_SIZE, st.size.y) - 1};
+            st.rasterize_tile(tile_min, tile_max, st.tile_primitives[tile]);
+        }
+    };
+    auto &jobs = JobSystem::shared();
+    JobSystem::Group group;
+    for (size_t idx = 1; idx < std::min(st.threads, tiles); ++idx) {
+        jobs.submit(JobSystem::Priority::INTERACTIVE, work, &group);
+    }
+    work();
+    jobs.wait(group);
+
+    st.vertices.clear();
+    st.circles.clear();
+    st.primitives.clear();
+}
+
+const std::vector<uint8_t> &SoftwareRenderer::pixels() const {
+    return state_->pixels;
+}
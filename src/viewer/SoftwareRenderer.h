@@ -0,0 +1,49 @@
+//
+// Created by valdemar on 18.10.26.
+//
+
+#pragma once
+
+#include <viewer/RenderContext.h>
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/**
+ * CPU rasterizer for RenderContext primitives, used where no OpenGL context available.
+ * Follows GPU pipeline of the viewer: pixel center sampling with top-left fill rule, one pixel
+ * wide lines, circles with hard edge and one pixel ring for thin ones, color blending as
+ * GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA. Image is split by tiles rasterized in parallel, each tile
+ * draws primitives in queue order, so result doesn't depend on threads count.
+ */
+class SoftwareRenderer {
+ public:
+    /// @param threads - tiles rasterized in parallel on job system and caller thread,
+    /// zero means all available
+    explicit SoftwareRenderer(glm::ivec2 size, size_t threads = 0);
+    ~SoftwareRenderer();
+
+    glm::ivec2 size() const;
+
+    /// World to clip space transform, expected to be 2D affine as orthographic camera gives
+    void set_proj_view(const glm::mat4 &proj_view);
+
+    /// Fill whole image with color, queued primitives are dropped
+    void clear(glm::vec4 color);
+
+    /// Queue primitives of context, data is copied so context may be changed afterwards
+    void queue_primitives(const RenderContext &ctx);
+
+    /// Rasterize everything queued in order of queueing, queue is empty after this call
+    void flush();
+
+    /// RGBA pixels, rows from bottom to top as glReadPixels returns them
+    const std::vector<uint8_t> &pixels() const;
+
+ private:
+    struct raster_state_t;
+    std::unique_ptr<raster_state_t> state_;
+};
@@ -0,0 +1,190 @@
+//
+// Created by valdemar on 18.10.26.
+//
+
+#include "TextIndex.h"
+
+#include <algorithm>
+#include <cctype>
+
+namespace {
+
+bool is_word_char(unsigned char c) {
+    // Bytes of multibyte UTF-8 sequences are kept inside words
+    return std::isalnum(c) || c == '_' || c >= 0x80;
+}
+
+/// Call fn for each lowercase word of text
+template <typename Fn>
+void for_each_word(const char *text, std::string &word, Fn &&fn) {
+    for (auto p = reinterpret_cast<const unsigned char *>(text);; ++p) {
+        if (*p != '\0' && is_word_char(*p)) {
+            word.push_back(static_cast<char>(*p < 0x80 ? std::tolower(*p) : *p));
+        } else {
+            if (!word.empty()) {
+                fn(word);
+                word.clear();
+            }
+            if (*p == '\0') {
+                break;
+            }
+        }
+    }
+}
+
+/// Decode postings of one word, fn called for each frame in ascending order
+template <typename Fn>
+void for_each_frame(const std::vector<uint8_t> &data, Fn &&fn) {
+    uint32_t frame = 0;
+    uint32_t delta = 0;
+    int shift = 0;
+    bool first = true;
+    for (uint8_t byte : data) {
+        delta |= static_cast<uint32_t>(byte & 0x7F) << shift;
+        if (byte & 0x80) {
+            shift += 7;
+            continue;
+        }
+        frame = first ? delta : frame + delta;
+        first = false;
+        if (!fn(frame)) {
+            return;
+        }
+        delta = 0;
+        shift = 0;
+    }
+}
+
+}  // anonymous namespace
+
+void TextIndex::Batch::add_frame(const Frame &frame) {
+    const uint32_t frame_idx = first_frame_ + frames_count_;
+    std::string word;
+    const auto add_word = [&](const std::string &w) {
+        auto &frames = words_[w];
+        if (frames.empty() || frames.back() != frame_idx) {
+            frames.push_back(frame_idx);
+        }
+    };
+    for_each_word(frame.user_message(), word, add_word);
+    for (const auto &layer : frame.all_popups()) {
+        for (const auto &popup : layer) {
+            for_each_word(popup.text(), word, add_word);
+        }
+    }
+    ++frames_count_;
+}
+
+size_t TextIndex::Batch::frames_count() const {
+    return frames_count_;
+}
+
+uint32_t TextIndex::Batch::first_frame() const {
+    return first_frame_;
+}
+
+void TextIndex::posting_t::append(uint32_t frame) {
+    uint32_t delta = count > 0 ? frame - last : frame;
+    while (delta >= 0x80) {
+        data.push_back(static_cast<uint8_t>(delta | 0x80));
+        delta >>= 7;
+    }
+    data.push_back(static_cast<uint8_t>(delta));
+    last = frame;
+    ++count;
+}
+
+TextIndex::Batch TextIndex::start_batch() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Batch batch;
+    batch.epoch_ = epoch_;
+    batch.first_frame_ = frames_count_;
+    return batch;
+}
+
+bool TextIndex::commit(TextIndex::Batch batch) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (batch.epoch_ != epoch_ || batch.first_frame_ != frames_count_) {
+        return false;
+    }
+    for (const auto &word : batch.words_) {
+        auto &posting = postings_[word.first];
+        const size_t size_before = posting.data.size();
+        for (uint32_t frame : word.second) {
+            posting.append(frame);
+        }
+        bytes_ += posting.data.size() - size_before;
+    }
+    frames_count_ += batch.frames_count_;
+    return true;
+}
+
+void TextIndex::reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    postings_.clear();
+    frames_count_ = 0;
+    bytes_ = 0;
+    ++epoch_;
+}
+
+size_t TextIndex::frames_count() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return frames_count_;
+}
+
+std::vector<uint32_t> TextIndex::search(const std::string &query) const {
+    std::vector<std::string> words;
+    std::string word;
+    for_each_word(query.c_str(), word, [&words](const std::string &w) { words.push_back(w); });
+    std::vector<uint32_t> result;
+    if (words.empty()) {
+        return result;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<const posting_t *> postings;
+    for (const auto &w : words) {
+        auto it = postings_.find(w);
+        if (it == postings_.end()) {
+            return result;
+        }
+        postings.push_back(&it->second);
+    }
+    // Rarest word first, so intersection never grows
+    std::sort(postings.begin(), postings.end(),
+              [](const posting_t *lhs, const posting_t *rhs) { return lhs->count < rhs->count; });
+
+    result.reserve(postings.front()->count);
+    for_each_frame(postings.front()->data, [&result](uint32_t frame) {
+        result.push_back(frame);
+        return true;
+    });
+    std::vector<uint32_t> next;
+    for (size_t i = 1; i < postings.size() && !result.empty(); ++i) {
+        next.clear();
+        size_t pos = 0;
+        for_each_frame(postings[i]->data, [&](uint32_t frame) {
+            while (pos < result.size() && result[pos] < frame) {
+                ++pos;
+            }
+            if (pos == result.size()) {
+                return false;
+            }
+            if (result[pos] == frame) {
+                next.push_back(frame);
+            }
+            return true;
+        });
+        result.swap(next);
+    }
+    return result;
+}
+
+TextIndex::stats_t TextIndex::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_t stats;
+    stats.frames = frames_count_;
+    stats.words = postings_.size();
+    stats.bytes = bytes_;
+    return stats;
+}
@@ -0,0 +1,82 @@
+//
+// Created by valdemar on 18.10.26.
+//
+
+#pragma once
+
+#include <viewer/Frame.h>
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Inverted index of words in frames messages and popups, used to find frames by text.
+ * Frames are added in order, by batches prepared without lock. Each word keeps indices of
+ * frames containing it as delta encoded varints, so index stays small on long recordings.
+ * @note All methods are thread safe
+ */
+class TextIndex {
+ public:
+    /// Words of consecutive frames, filled outside of index lock
+    class Batch {
+     public:
+        /// Append words of next frame
+        void add_frame(const Frame &frame);
+
+        size_t frames_count() const;
+        /// Index of the first frame in batch
+        uint32_t first_frame() const;
+
+     private:
+        friend class TextIndex;
+        uint64_t epoch_ = 0;
+        uint32_t first_frame_ = 0;
+        uint32_t frames_count_ = 0;
+        /// Frames containing word, ascending
+        std::unordered_map<std::string, std::vector<uint32_t>> words_;
+    };
+
+    struct stats_t {
+        size_t frames = 0;
+        size_t words = 0;
+        /// Encoded postings size
+        size_t bytes = 0;
+    };
+
+    /// Empty batch starting at the first frame not indexed yet
+    Batch start_batch() const;
+
+    /// Add batch frames to index
+    /// @return false if index was reset or other batch committed since start_batch()
+    bool commit(Batch batch);
+
+    /// Forget everything, e.g. when frames are cleared
+    void reset();
+
+    /// Frames indexed so far, these are [0, frames_count())
+    size_t frames_count() const;
+
+    /// Frames containing all words of query, ascending. Case insensitive, whole words only
+    std::vector<uint32_t> search(const std::string &query) const;
+
+    stats_t stats() const;
+
+ private:
+    struct posting_t {
+        std::vector<uint8_t> data;
+        uint32_t last = 0;
+        uint32_t count = 0;
+
+        void append(uint32_t frame);
+    };
+
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, posting_t> postings_;
+    uint32_t frames_count_ = 0;
+    /// Incremented on reset
+    uint64_t epoch_ = 0;
+    size_t bytes_ = 0;
+};
@@ -0,0 +1,307 @@
+//
+// Created by valdemar on 18.10.26.
+//
+
+#include "ThumbnailStrip.h"
+#include "Scene.h"
+#include "SoftwareRenderer.h"
+
+#include <cgutils/Camera.h>
+#include <cgutils/opengl.h>
+#include <cgutils/utils.h>
+#include <common/JobSystem.h>
+
+#include <imgui.h>
+
+#include <algorithm>
+#include <mutex>
+#include <unordered_map>
+
+namespace {
+
+constexpr int THUMB_SIZE = 64;
+constexpr float THUMB_SPACING = 4.0f;
+constexpr int ATLAS_SIZE = 1024;
+constexpr int THUMBS_PER_ROW = ATLAS_SIZE / THUMB_SIZE;
+constexpr int ATLAS_SLOTS = THUMBS_PER_ROW * THUMBS_PER_ROW;
+
+/// Coarse to fine generation order: every 2^n-th preview goes before every 2^(n-1)-th
+int refine_level(int k) {
+    if (k == 0) {
+        return 32;
+    }
+    int level = 0;
+    while ((k & 1) == 0) {
+        k >>= 1;
+        ++level;
+    }
+    return level;
+}
+
+}  // anonymous namespace
+
+struct ThumbnailStrip::strip_state_t {
+    struct result_t {
+        int frame_idx;
+        std::weak_ptr<Frame> frame;
+        uint64_t key;
+        std::vector<uint8_t> pixels;
+    };
+
+    /// Uploaded preview, owned by render thread
+    struct entry_t {
+        std::weak_ptr<Frame> frame;
+        uint64_t key = 0;
+        int slot = -1;
+        uint64_t last_used = 0;
+        /// Preview job in flight, cancelled once entry evicted
+        bool queued = false;
+        uint64_t queued_key = 0;
+        JobSystem::CancelToken job;
+    };
+
+    GLuint atlas = 0;
+    std::unordered_map<int, entry_t> entries;
+    std::vector<int> free_slots;
+    uint64_t ui_frame = 0;
+
+    // Whole game area fits into preview
+    glm::mat4 proj_view{1.0f};
+
+    /// All preview jobs, waited on destruction
+    JobSystem::Group jobs;
+    mutable std::mutex mutex;
+    std::vector<result_t> results;
+
+    void release(entry_t &entry) {
+        if (entry.slot >= 0) {
+            free_slots.push_back(entry.slot);
+            entry.slot = -1;
+        }
+        entry.job.cancel();
+        entry.queued = false;
+    }
+
+    /// Free slot, or slot of preview not shown for the longest time
+    int acquire_slot() {
+        if (free_slots.empty()) {
+            auto lru = entries.end();
+            for (auto it = entries.begin(); it != entries.end(); ++it) {
+                // Previews drawn last frame stay
+                if (it->second.slot >= 0 && it->second.last_used + 1 < ui_frame &&
+                    (lru == entries.end() || it->second.last_used < lru->second.last_used)) {
+                    lru = it;
+                }
+            }
+            if (lru == entries.end()) {
+                return -1;
+            }
+            release(lru->second);
+            entries.erase(lru);
+        }
+        const int slot = free_slots.back();
+        free_slots.pop_back();
+        return slot;
+    }
+};
+
+ThumbnailStrip::ThumbnailStrip(const Config *conf) : conf_(conf) {
+    state_ = std::make_unique<strip_state_t>();
+    auto &st = *state_;
+
+    glGenTextures(1, &st.atlas);
+    glBindTexture(GL_TEXTURE_2D, st.atlas);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, ATLAS_SIZE, ATLAS_SIZE, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+                 nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    for (int slot = ATLAS_SLOTS - 1; slot >= 0; --slot) {
+        st.free_slots.push_back(slot);
+    }
+
+    const glm::vec2 area = conf_->scene.grid_dim;
+    auto camera_conf = conf_->camera;
+    camera_conf.start_position = area * 0.5f;
+    camera_conf.start_viewport_size = std::max(area.x, area.y);
+    st.proj_view = Camera{camera_conf, glm::ivec2{THUMB_SIZE}}.proj_view();
+}
+
+ThumbnailStrip::~ThumbnailStrip() {
+    for (auto &item : state_->entries) {
+        item.second.job.cancel();
+    }
+    // Running jobs use scene and results list
+    JobSystem::shared().wait(state_->jobs);
+    glDeleteTextures(1, &state_->atlas);
+}
+
+float ThumbnailStrip::height() {
+    return static_cast<float>(THUMB_SIZE);
+}
+
+int ThumbnailStrip::draw(Scene *scene, float slider_x, float slider_width) {
+    auto &st = *state_;
+    ++st.ui_frame;
+    upload_results();
+
+    // Last frame may still get new primitives, so it's never previewed
+    const int frames_cnt = scene->get_frames_count();
+    const int usable = frames_cnt - 1;
+    std::vector<std::pair<int, std::shared_ptr<Frame>>> missing;
+    for (auto it = st.entries.begin(); it != st.entries.end();) {
+        // Forget samples of previous step which were never uploaded
+        if (usable <= 0 || (it->second.slot < 0 && it->second.last_used + 1 < st.ui_frame)) {
+            st.release(it->second);
+            it = st.entries.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    const int max_count =
+        std::max(static_cast<int>(slider_width / (THUMB_SIZE + THUMB_SPACING)), 1);
+    int step = 1;
+    while (usable > step * max_count) {
+        step *= 2;
+    }
+
+    uint32_t layers = 0;
+    for (size_t idx = 0; idx < Frame::LAYERS_COUNT; ++idx) {
+        layers |= static_cast<uint32_t>(conf_->scene.enabled_layers[idx]) << idx;
+    }
+    // Everything changing preview content except frame itself
+    uint64_t key = scene->permanent_version();
+    key = (key << 1 | conf_->scene.show_grid) << Frame::LAYERS_COUNT | layers;
+
+    const ImVec2 origin = ImGui::GetCursorScreenPos();
+    const ImVec2 thumb_size{THUMB_SIZE, THUMB_SIZE};
+    const int cur_idx = scene->get_frame_index();
+    const float slot_uv = static_cast<float>(THUMB_SIZE) / ATLAS_SIZE;
+    int clicked = -1;
+    for (int k = 0; usable > 0 && k * step < usable; ++k) {
+        const int idx = k * step;
+        auto frame = scene->frame_at(idx);
+        if (!frame) {
+            // Cleared by network thread
+            break;
+        }
+        auto &entry = st.entries[idx];
+        if (entry.frame.lock() != frame) {
+            // Data was cleared and index now belongs to other frame
+            st.release(entry);
+            entry.frame = frame;
+        }
+        if ((entry.slot < 0 || entry.key != key) && !(entry.queued && entry.queued_key == key)) {
+            missing.emplace_back(idx, frame);
+        }
+        entry.last_used = st.ui_frame;
+
+        const float center =
+            slider_x + (static_cast<float>(idx) + 0.5f) / frames_cnt * slider_width;
+        const float x = cg::clamp(center - THUMB_SIZE * 0.5f, slider_x,
+                                  slider_x + slider_width - THUMB_SIZE);
+        ImGui::SetCursorScreenPos({x, origin.y});
+        ImGui::PushID(idx);
+        const bool current = cur_idx >= idx && cur_idx < idx + step;
+        const ImVec4 border = current ? ImGui::GetStyleColorVec4(ImGuiCol_SliderGrabActive)
+                                      : ImVec4{0.0f, 0.0f, 0.0f, 0.0f};
+        if (entry.slot >= 0) {
+            // Rows are stored bottom up
+            const float u = static_cast<float>(entry.slot % THUMBS_PER_ROW) * slot_uv;
+            const float v = static_cast<float>(entry.slot / THUMBS_PER_ROW) * slot_uv;
+            ImGui::Image(reinterpret_cast<ImTextureID>(static_cast<intptr_t>(st.atlas)),
+                         thumb_size, {u, v + slot_uv}, {u + slot_uv, v}, {1, 1, 1, 1}, border);
+        } else {
+            ImGui::Dummy(thumb_size);
+            ImGui::GetWindowDrawList()->AddRectFilled(ImGui::GetItemRectMin(),
+                                                      ImGui::GetItemRectMax(),
+                                                      ImGui::GetColorU32(ImGuiCol_FrameBg));
+        }
+        if (ImGui::IsItemHovered()) {
+            ImGui::SetTooltip("Tick %d", idx + 1);
+            if (ImGui::IsItemClicked()) {
+                clicked = idx;
+            }
+        }
+        ImGui::PopID();
+    }
+    ImGui::SetCursorScreenPos({origin.x, origin.y + THUMB_SIZE});
+
+    std::stable_sort(missing.begin(), missing.end(), [step](const auto &lhs, const auto &rhs) {
+        return refine_level(lhs.first / step) > refine_level(rhs.first / step);
+    });
+    for (auto &item : missing) {
+        queue_preview(scene, item.first, std::move(item.second), layers, key);
+    }
+    return clicked;
+}
+
+bool ThumbnailStrip::has_new_thumbnails() const {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    return !state_->results.empty();
+}
+
+void ThumbnailStrip::upload_results() {
+    auto &st = *state_;
+    std::vector<strip_state_t::result_t> results;
+    {
+        std::lock_guard<std::mutex> lock(st.mutex);
+        results.swap(st.results);
+    }
+    if (results.empty()) {
+        return;
+    }
+
+    glBindTexture(GL_TEXTURE_2D, st.atlas);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    for (auto &result : results) {
+        auto it = st.entries.find(result.frame_idx);
+        const auto frame = result.frame.lock();
+        if (it == st.entries.end() || !frame || it->second.frame.lock() != frame) {
+            // Rendered before data was cleared
+            continue;
+        }
+        auto &entry = it->second;
+        if (entry.queued_key == result.key) {
+            entry.queued = false;
+        }
+        if (entry.slot < 0) {
+            entry.slot = st.acquire_slot();
+            if (entry.slot < 0) {
+                continue;
+            }
+        }
+        entry.key = result.key;
+        glTexSubImage2D(GL_TEXTURE_2D, 0, (entry.slot % THUMBS_PER_ROW) * THUMB_SIZE,
+                        (entry.slot / THUMBS_PER_ROW) * THUMB_SIZE, THUMB_SIZE, THUMB_SIZE,
+                        GL_RGBA, GL_UNSIGNED_BYTE, result.pixels.data());
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void ThumbnailStrip::queue_preview(Scene *scene, int frame_idx, std::shared_ptr<Frame> frame,
+                                   uint32_t layers, uint64_t key) {
+    auto &st = *state_;
+    auto &entry = st.entries[frame_idx];
+    // Preview with outdated settings is not needed anymore
+    entry.job.cancel();
+    entry.job = JobSystem::CancelToken{};
+    entry.queued = true;
+    entry.queued_key = key;
+
+    auto job = [&st, scene, frame_idx, frame, layers, key] {
+        SoftwareRenderer target({THUMB_SIZE, THUMB_SIZE}, 1);
+        target.set_proj_view(st.proj_view);
+        scene->render_frame_software(*frame, layers, target);
+
+        std::lock_guard<std::mutex> lock(st.mutex);
+        st.results.push_back({frame_idx, frame, key, target.pixels()});
+        // Wake up render loop sleeping without input
+        glfwPostEmptyEvent();
+    };
+    JobSystem::shared().submit(JobSystem::Priority::BACKGROUND, std::move(job), &st.jobs,
+                               &entry.job);
+}
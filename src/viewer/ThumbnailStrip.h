@@ -0,0 +1,47 @@
+//
+// Created by valdemar on 18.10.26.
+//
+
+#pragma once
+
+#include <viewer/Config.h>
+
+#include <memory>
+
+class Frame;
+class Scene;
+
+/**
+ * Small previews of sampled frames shown along playback slider.
+ * Previews are rasterized on CPU by background jobs and cached, render thread only uploads
+ * finished ones into texture atlas, so scrubbing never waits for them.
+ * Sampling step is power of two, so previews stay valid while recording grows.
+ */
+class ThumbnailStrip {
+ public:
+    /// @note Created from render thread with current GL context
+    explicit ThumbnailStrip(const Config *conf);
+    ~ThumbnailStrip();
+
+    /// Strip height in pixels
+    static float height();
+
+    /// Draw strip in current ImGui window, previews placed over matching slider positions
+    /// @param slider_x, slider_width - screen span of playback slider
+    /// @return clicked frame index, -1 if nothing clicked
+    /// @note Called from render thread
+    int draw(Scene *scene, float slider_x, float slider_width);
+
+    /// True if background jobs finished previews not shown yet
+    bool has_new_thumbnails() const;
+
+ private:
+    void upload_results();
+    void queue_preview(Scene *scene, int frame_idx, std::shared_ptr<Frame> frame,
+                       uint32_t layers, uint64_t key);
+
+    struct strip_state_t;
+    std::unique_ptr<strip_state_t> state_;
+
+    const Config *conf_;
+};
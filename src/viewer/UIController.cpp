@@ -5,9 +5,13 @@
 #include <cgutils/opengl.h>
 
 #include "UIController.h"
+#include "ThumbnailStrip.h"
 
+#include <common/JobSystem.h>
+#include <common/Profiler.h>
 #include <common/logger.h>
 #include <version.h>
+#include <viewer/GpuTimer.h>
 
 #include <fontawesome.h>
 #include <imgui_impl/imgui_impl_glfw.h>
@@ -15,6 +19,12 @@
 
 #include <glm/gtc/type_ptr.hpp>
 
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
 namespace {
 
 bool key_modifier(const ImGuiIO &io) {
@@ -42,6 +52,17 @@ const float DEFAULT_FONT_SIZE = 13.0f;
 const float FONT_AWESOME_FONT_SIZE = 14.0f;
 
 const char *THEMES_COMBO = "Light\0Grey\0Dark\0";
+const char *CIRCLE_MODES_COMBO = "Auto\0Geometry shader\0Instancing\0";
+
+/// Playback rate at 1x speed
+constexpr double BASE_TICKS_PER_SECOND = 60.0;
+/// Fast forward and backward buttons speed relative to playback speed
+constexpr double FAST_SKIP_MULTIPLIER = 10.0;
+/// Longer stalls are not caught up, e.g. after window was hidden
+constexpr double MAX_PLAYBACK_STEP_SEC = 1.0;
+const std::array<float, 12> PLAYBACK_SPEEDS{
+    {0.25f, 0.5f, 1.0f, 2.0f, 4.0f, 10.0f, 20.0f, 50.0f, 100.0f, 200.0f, 500.0f, 1000.0f}};
+
 void set_style_by_theme_id(int theme_id) {
     switch (theme_id) {
         case 0: ImGui::StyleColorsLight(); break;
@@ -67,17 +88,65 @@ struct UIController::wnd_t {
     bool show_fps_overlay = true;
     bool show_info = true;
     bool show_playback_control = true;
+    bool show_thumbnails = true;
+    bool show_frame_stats = true;
+    bool show_profiler = false;
     bool show_ui_help = false;
     bool show_shortcuts_help = false;
     bool show_metrics = false;
     bool show_mouse_pos_tooltip = false;
 };
 
+struct UIController::message_log_t {
+    ImGuiTextFilter filter;
+    /// Indices of lines passing filter
+    std::vector<uint32_t> matched;
+    /// Message the matched lines computed for
+    const char *text = nullptr;
+    size_t lines = 0;
+    int frame_idx = -1;
+};
+
+struct UIController::search_t {
+    char query[128] = {};
+    /// Matching frames, ascending
+    std::vector<uint32_t> results;
+    /// Indexed frames when results were found, they are refreshed as index grows
+    size_t searched_frames = 0;
+};
+
+struct UIController::stats_plot_t {
+    int metric = FrameStatsTimeline::PRIMITIVES;
+    /// Maximum of frames range per pixel column of slider
+    std::vector<float> buckets;
+};
+
+struct UIController::profiler_view_t {
+    static constexpr size_t FRAMES = 240;
+    static constexpr size_t SAMPLES = 512;
+
+    /// Alive while window is shown, stages are timed only then
+    std::unique_ptr<Profiler::Reader> reader;
+    std::vector<Profiler::sample_t> drained;
+    /// Stage time summed over each of last frames, ring
+    std::array<std::array<float, FRAMES>, Profiler::STAGES_COUNT> frame_ms{};
+    size_t frames = 0;
+    /// Durations of last calls per stage, ring
+    std::array<std::vector<float>, Profiler::STAGES_COUNT> calls_ms;
+    std::array<size_t, Profiler::STAGES_COUNT> calls = {};
+    std::vector<float> sorted;
+};
+
 UIController::UIController(Camera *camera, Config *conf) : camera_(camera), conf_(conf) {
     // Setup ImGui binding
     ImGui_ImplGlfw_InitForOpenGL(glfwGetCurrentContext(), true);
     ImGui_ImplOpenGL3_Init();
     wnd_ = std::make_unique<wnd_t>();
+    message_log_ = std::make_unique<message_log_t>();
+    search_ = std::make_unique<search_t>();
+    stats_plot_ = std::make_unique<stats_plot_t>();
+    profiler_view_ = std::make_unique<profiler_view_t>();
+    thumbnails_ = std::make_unique<ThumbnailStrip>(conf_);
 
     set_style_by_theme_id(conf_->ui.imgui_theme_id);
 
@@ -104,6 +173,8 @@ UIController::UIController(Camera *camera, Config *conf) : camera_(camera), conf
 }
 
 UIController::~UIController() {
+    thumbnails_.reset();
+
     // Cleanup imgui
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
@@ -111,6 +182,15 @@ UIController::~UIController() {
 }
 
 void UIController::next_frame(Scene *scene, NetListener::ConStatus client_status) {
+    // Stages are timed only while somebody looks at them
+    if (!wnd_->show_profiler) {
+        profiler_view_->reader.reset();
+    } else if (!profiler_view_->reader) {
+        profiler_view_->reader = std::make_unique<Profiler::Reader>();
+    }
+    Profiler::Scope ui_build{Profiler::UI_BUILD};
+    gpu_timer_ = scene->gpu_timer();
+
     // Start new frame
     ImGui_ImplOpenGL3_NewFrame();
     ImGui_ImplGlfw_NewFrame();
@@ -132,13 +212,28 @@ void UIController::next_frame(Scene *scene, NetListener::ConStatus client_status
     main_menu_bar();
 
     if (wnd_->show_fps_overlay) {
-        fps_overlay_widget(client_status);
+        fps_overlay_widget(scene, client_status);
     }
     if (wnd_->show_info) {
         info_widget(scene);
     }
     if (wnd_->show_playback_control) {
         playback_control_widget(scene);
+        if (wnd_->show_thumbnails) {
+            timeline_thumbnails_widget(scene);
+        }
+        if (wnd_->show_frame_stats) {
+            // Stacked above thumbnails
+            const auto &style = ImGui::GetStyle();
+            float bottom = ImGui::GetIO().DisplaySize.y - 20 - 2 * style.WindowPadding.y;
+            if (wnd_->show_thumbnails) {
+                bottom -= ThumbnailStrip::height() + 2 * style.WindowPadding.y;
+            }
+            frame_stats_widget(scene, bottom);
+        }
+    }
+    if (wnd_->show_profiler) {
+        profiler_widget(scene);
     }
     if (wnd_->show_style_editor) {
         ImGui::Begin("Style editor", &wnd_->show_style_editor);
@@ -231,8 +326,17 @@ void UIController::next_frame(Scene *scene, NetListener::ConStatus client_status
 }
 
 void UIController::frame_end() {
-    ImGui::Render();
+    {
+        Profiler::Scope ui_build{Profiler::UI_BUILD};
+        ImGui::Render();
+    }
+    if (gpu_timer_) {
+        gpu_timer_->begin(GpuTimer::UI);
+    }
     ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+    if (gpu_timer_) {
+        gpu_timer_->end();
+    }
 }
 
 bool UIController::close_requested() const {
@@ -243,11 +347,31 @@ bool UIController::immediate_mode_enabled() const {
     return immediate_send_mode_;
 }
 
+bool UIController::wants_redraw() const {
+    const auto &io = ImGui::GetIO();
+    // Held mouse buttons and keys act every frame, but don't produce new events
+    for (bool down : io.MouseDown) {
+        if (down) {
+            return true;
+        }
+    }
+    for (bool down : io.KeysDown) {
+        if (down) {
+            return true;
+        }
+    }
+    // Previews finished in background
+    return playing_ || thumbnails_->has_new_thumbnails();
+}
+
 void UIController::main_menu_bar() {
     if (ImGui::BeginMainMenuBar()) {
         if (ImGui::BeginMenu(ICON_FA_EYE " View", true)) {
             ImGui::Checkbox("FPS overlay", &wnd_->show_fps_overlay);
             ImGui::Checkbox("Utility window", &wnd_->show_info);
+            ImGui::Checkbox("Timeline thumbnails", &wnd_->show_thumbnails);
+            ImGui::Checkbox("Frame statistics", &wnd_->show_frame_stats);
+            ImGui::Checkbox("Stage profiler", &wnd_->show_profiler);
             if (developer_mode_) {
                 ImGui::Separator();
                 ImGui::Checkbox("Style editor", &wnd_->show_style_editor);
@@ -265,7 +389,7 @@ void UIController::main_menu_bar() {
     }
 }
 
-void UIController::fps_overlay_widget(NetListener::ConStatus net_status) {
+void UIController::fps_overlay_widget(Scene *scene, NetListener::ConStatus net_status) {
     ImGui::SetNextWindowPos(ImVec2(10, 20));
     const auto flags = ImGuiWindowFlags_NoTitleBar | ImGuiWindowFlags_AlwaysAutoResize |
                        ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoSavedSettings;
@@ -280,6 +404,29 @@ void UIController::fps_overlay_widget(NetListener::ConStatus net_status) {
         ImGui::SameLine();
         ImGui::Text("[%.1f ms]", 1000.0f / ImGui::GetIO().Framerate);
         ImGui::EndGroup();
+        if (developer_mode_) {
+            const auto &stats = scene->draw_stats();
+            ImGui::Text("Elements %zu, draw calls %zu, vertices %.1f KB", stats.elements,
+                        stats.draw_calls, static_cast<double>(stats.vertex_bytes) / 1024.0);
+            // Readers never wait, only writers may contend with each other
+            const auto sync = scene->sync_stats();
+            ImGui::Text("Published %llu, writer waits %llu [%.2f ms], copy %.1f ms",
+                        static_cast<unsigned long long>(sync.published),
+                        static_cast<unsigned long long>(sync.writer_waits), sync.writer_wait_ms,
+                        sync.copy_ms);
+            ImGui::Text("Lock-free reads %llu, retired pending %llu",
+                        static_cast<unsigned long long>(sync.reclamation.read_sections),
+                        static_cast<unsigned long long>(sync.reclamation.pending));
+            static const char *queue_names[] = {"interactive", "prefetch", "background"};
+            const auto jobs = JobSystem::shared().stats();
+            for (size_t idx = 0; idx < jobs.size(); ++idx) {
+                ImGui::Text("Jobs %s: %llu done, %llu cancelled, %llu queued, wait %.2f/%.2f ms",
+                            queue_names[idx], static_cast<unsigned long long>(jobs[idx].executed),
+                            static_cast<unsigned long long>(jobs[idx].cancelled),
+                            static_cast<unsigned long long>(jobs[idx].queued),
+                            jobs[idx].avg_latency_ms, jobs[idx].max_latency_ms);
+            }
+        }
         std::string strstatus;
         ImVec4 color;
         static const float intensity = 1.0;
@@ -307,6 +454,99 @@ void UIController::fps_overlay_widget(NetListener::ConStatus net_status) {
     }
 }
 
+void UIController::profiler_widget(Scene *scene) {
+    using view_t = profiler_view_t;
+    auto &view = *profiler_view_;
+
+    // Everything finished since previous ui frame goes to the new column
+    view.drained.clear();
+    view.reader->drain(view.drained);
+    const size_t column = view.frames++ % view_t::FRAMES;
+    for (auto &stage_ms : view.frame_ms) {
+        stage_ms[column] = 0.0f;
+    }
+    for (const auto &sample : view.drained) {
+        const float ms = static_cast<float>(sample.duration_ns) * 1e-6f;
+        view.frame_ms[sample.stage][column] += ms;
+        auto &calls = view.calls_ms[sample.stage];
+        if (calls.size() < view_t::SAMPLES) {
+            calls.push_back(ms);
+        } else {
+            calls[view.calls[sample.stage] % view_t::SAMPLES] = ms;
+        }
+        ++view.calls[sample.stage];
+    }
+
+    ImGui::SetNextWindowSize({560, 0}, ImGuiCond_FirstUseEver);
+    if (!ImGui::Begin(ICON_FA_TACHOMETER " Stage profiler", &wnd_->show_profiler)) {
+        ImGui::End();
+        return;
+    }
+    ImGui::TextDisabled("Time per frame, percentiles of last %zu calls, ms", view_t::SAMPLES);
+    const float plot_width = ImGui::GetContentRegionAvail().x * 0.5f;
+    const float plot_height = ImGui::GetTextLineHeight() * 2.0f;
+    for (size_t idx = 0; idx < Profiler::STAGES_COUNT; ++idx) {
+        const auto stage = static_cast<Profiler::Stage>(idx);
+        const auto &frame_ms = view.frame_ms[idx];
+        const float max_ms = *std::max_element(frame_ms.begin(), frame_ms.end());
+
+        ImGui::PushID(static_cast<int>(idx));
+        ImGui::PlotHistogram("##frames", frame_ms.data(), static_cast<int>(frame_ms.size()),
+                             static_cast<int>(view.frames % view_t::FRAMES), nullptr, 0.0f,
+                             std::max(max_ms, 1.0f), {plot_width, plot_height});
+        ImGui::PopID();
+        ImGui::SameLine();
+
+        ImGui::BeginGroup();
+        ImGui::Text("%s", Profiler::stage_name(stage));
+        auto &sorted = view.sorted;
+        sorted = view.calls_ms[idx];
+        if (sorted.empty()) {
+            ImGui::TextDisabled("no calls");
+        } else {
+            std::sort(sorted.begin(), sorted.end());
+            const auto percentile = [&sorted](double p) {
+                return sorted[static_cast<size_t>(p * static_cast<double>(sorted.size() - 1))];
+            };
+            ImGui::TextDisabled("p50 %.2f  p95 %.2f  p99 %.2f  max %.2f", percentile(0.5),
+                                percentile(0.95), percentile(0.99), sorted.back());
+        }
+        ImGui::EndGroup();
+    }
+
+    // Smoothed, so bars don't jump every frame
+    ImGui::Separator();
+    const GpuTimer *timer = scene->gpu_timer();
+    if (!timer || timer->measured_frames() == 0) {
+        ImGui::TextDisabled("GPU time is not measured yet");
+    } else {
+        const auto &gpu_ms = timer->smoothed_ms();
+        float total_ms = 0.0f;
+        for (float ms : gpu_ms) {
+            total_ms += ms;
+        }
+        ImGui::Text("GPU %.2f ms per frame", total_ms);
+        char overlay[64];
+        for (size_t idx = 0; idx < gpu_ms.size(); ++idx) {
+            // Hide disabled layers and passes without primitives
+            if (gpu_ms[idx] < 0.001f) {
+                continue;
+            }
+            snprintf(overlay, sizeof(overlay), "%.3f ms", gpu_ms[idx]);
+            ImGui::ProgressBar(gpu_ms[idx] / std::max(total_ms, 1e-3f), {plot_width, 0.0f},
+                               overlay);
+            ImGui::SameLine();
+            ImGui::Text("%s", GpuTimer::section_name(idx).c_str());
+        }
+    }
+
+    const uint64_t dropped = view.reader->dropped();
+    if (dropped > 0) {
+        ImGui::TextDisabled("Dropped %llu samples", static_cast<unsigned long long>(dropped));
+    }
+    ImGui::End();
+}
+
 void UIController::info_widget(Scene *scene) {
     int width, height;
     glfwGetWindowSize(glfwGetCurrentContext(), &width, &height);
@@ -345,6 +585,12 @@ void UIController::info_widget(Scene *scene) {
         if (ImGui::CollapsingHeader("Options", flags)) {
             ImGui::Checkbox("World origin on top left", &conf_->camera.origin_on_top_left);
             ImGui::Checkbox("Draw grid", &conf_->scene.show_grid);
+            ImGui::Checkbox("Simplify zoomed out geometry", &conf_->scene.use_lod);
+            ImGui::Checkbox("Show hovered primitive", &conf_->scene.hover_primitives);
+            ImGui::Combo("Circles", &conf_->scene.circles_render_mode, CIRCLE_MODES_COMBO);
+            if (developer_mode_ && ImGui::Button("Benchmark 1M circles")) {
+                scene->benchmark_circles();
+            }
         }
     }
     if (ImGui::CollapsingHeader(ICON_FA_MAP_O " Layer visibility", flags)) {
@@ -364,11 +610,35 @@ void UIController::info_widget(Scene *scene) {
                 ImGui::SameLine();
             }
         }
+
+        // Heatmap toggles, placed right under corresponding layer buttons
+        static const ImVec4 heatmap_colors[] = {ImVec4(0.5, 0.5, 0.5, 0.4),
+                                                ImVec4(0.95, 0.45, 0.1, 1.0)};
+        static const std::array<const char *, static_cast<size_t>(Frame::LAYERS_COUNT)>
+            heatmap_captions{{"##heatmap0", "##heatmap1", "##heatmap2", "##heatmap3",
+                              "##heatmap4", "##heatmap5", "##heatmap6", "##heatmap7",
+                              "##heatmap8", "##heatmap9"}};
+        const ImVec2 heatmap_button_size{ImGui::GetFrameHeight(), ImGui::GetFrameHeight() * 0.4f};
+        idx = 0;
+        for (bool &heatmap : conf_->scene.heatmap_layers) {
+            if (ImGui::ColorButton(heatmap_captions[idx], heatmap_colors[heatmap],
+                                   ImGuiColorEditFlags_NoTooltip, heatmap_button_size)) {
+                heatmap = !heatmap;
+            }
+            if (ImGui::IsItemHovered()) {
+                ImGui::SetTooltip("Draw layer %zu as density heatmap", idx + 1);
+            }
+            ++idx;
+            if (idx < Frame::LAYERS_COUNT) {
+                ImGui::SameLine();
+            }
+        }
+    }
+    if (ImGui::CollapsingHeader(ICON_FA_SEARCH " Search", flags)) {
+        search_widget(scene);
     }
     if (ImGui::CollapsingHeader(ICON_FA_COMMENT_O " Frame message", flags)) {
-        ImGui::BeginChild("FrameMsg", {0, 0}, true);
-        ImGui::TextWrapped("%s", scene->get_frame_user_message());
-        ImGui::EndChild();
+        message_log_widget(scene);
     }
 
     conf_->ui.info_widget_width = static_cast<int>(ImGui::GetWindowWidth());
@@ -376,6 +646,100 @@ void UIController::info_widget(Scene *scene) {
     ImGui::End();
 }
 
+void UIController::message_log_widget(Scene *scene) {
+    auto &log = *message_log_;
+    const bool filter_changed = log.filter.Draw(ICON_FA_FILTER "##MsgFilter", -1.0f);
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("Show lines containing text, \"a,b\" - any of, \"-a\" - exclude");
+    }
+
+    const size_t lines = scene->get_frame_message_lines();
+    const char *text = scene->get_frame_user_message();
+    const int frame_idx = scene->get_frame_index();
+    // Lines matched once per message change, not on every frame
+    if (log.filter.IsActive() && (filter_changed || log.text != text || log.lines != lines ||
+                                  log.frame_idx != frame_idx)) {
+        log.matched.clear();
+        for (size_t idx = 0; idx < lines; ++idx) {
+            const auto line = scene->get_frame_message_line(idx);
+            if (log.filter.PassFilter(line.begin, line.end)) {
+                log.matched.push_back(static_cast<uint32_t>(idx));
+            }
+        }
+        log.text = text;
+        log.lines = lines;
+        log.frame_idx = frame_idx;
+    }
+
+    const bool filtered = log.filter.IsActive();
+    const size_t shown = filtered ? log.matched.size() : lines;
+    ImGui::BeginChild("FrameMsg", {0, 0}, true, ImGuiWindowFlags_HorizontalScrollbar);
+    // Lines are not wrapped, so all of them have the same height and clipper may skip hidden
+    ImGuiListClipper clipper;
+    clipper.Begin(static_cast<int>(shown));
+    while (clipper.Step()) {
+        for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; ++row) {
+            const size_t idx = filtered ? log.matched[row] : static_cast<size_t>(row);
+            const auto line = scene->get_frame_message_line(idx);
+            ImGui::TextUnformatted(line.begin, line.end);
+        }
+    }
+    ImGui::EndChild();
+}
+
+void UIController::search_widget(Scene *scene) {
+    auto &search = *search_;
+    ImGui::PushItemWidth(-1.0f);
+    const bool query_changed =
+        ImGui::InputText("##FrameSearch", search.query, sizeof(search.query));
+    ImGui::PopItemWidth();
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("Words of frame message or popups, all of them should be present");
+    }
+
+    const size_t indexed = scene->searchable_frames_count();
+    if (query_changed || indexed != search.searched_frames) {
+        search.results = scene->find_frames(search.query);
+        search.searched_frames = indexed;
+    }
+
+    const auto jump = [this, scene](uint32_t frame) {
+        autoplay_scene_ = false;
+        scene->set_frame_index(static_cast<int>(frame));
+    };
+    const auto &results = search.results;
+    const auto cur = static_cast<uint32_t>(std::max(scene->get_frame_index(), 0));
+    const auto next = std::upper_bound(results.begin(), results.end(), cur);
+    const auto prev = std::lower_bound(results.begin(), results.end(), cur);
+    if (ImGui::ArrowButton("##SearchPrev", ImGuiDir_Left) && prev != results.begin()) {
+        jump(*(prev - 1));
+    }
+    ImGui::SameLine();
+    if (ImGui::ArrowButton("##SearchNext", ImGuiDir_Right) && next != results.end()) {
+        jump(*next);
+    }
+    ImGui::SameLine();
+    ImGui::Text("%zu matches, %zu frames indexed", results.size(), indexed);
+
+    if (results.empty()) {
+        return;
+    }
+    ImGui::BeginChild("SearchResults", {0, ImGui::GetTextLineHeightWithSpacing() * 6}, true);
+    ImGuiListClipper clipper;
+    clipper.Begin(static_cast<int>(results.size()));
+    while (clipper.Step()) {
+        for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; ++row) {
+            // Frames are shown 1-based, as in playback slider
+            char label[32];
+            snprintf(label, sizeof(label), "Tick %u", results[row] + 1);
+            if (ImGui::Selectable(label, results[row] == cur)) {
+                jump(results[row]);
+            }
+        }
+    }
+    ImGui::EndChild();
+}
+
 void UIController::playback_control_widget(Scene *scene) {
     static const auto button_size = ImVec2{0, 0};
     static const float buttons_spacing = 5.0f;
@@ -385,6 +749,7 @@ void UIController::playback_control_widget(Scene *scene) {
     ImGui::SetNextWindowSize({width, 30});
     static const auto flags =
         ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoSavedSettings;
+    playing_ = false;
     if (ImGui::Begin("Playback control", &wnd_->show_playback_control, flags)) {
         ImGui::BeginGroup();
 
@@ -408,9 +773,7 @@ void UIController::playback_control_widget(Scene *scene) {
         }
 
         ImGui::Button(ICON_FA_FAST_BACKWARD "##fastprev", button_size);
-        if (ImGui::IsItemActive()) {
-            tick -= conf_->ui.fast_skip_speed;
-        }
+        const bool fast_backward = ImGui::IsItemActive();
         ImGui::SameLine(0.0f, buttons_spacing);
 
         if (ImGui::Button(ICON_FA_BACKWARD "##prev", button_size)) {
@@ -431,12 +794,39 @@ void UIController::playback_control_widget(Scene *scene) {
         ImGui::SameLine(0.0f, buttons_spacing);
 
         ImGui::Button(ICON_FA_FAST_FORWARD "##fastnext", button_size);
-        if (ImGui::IsItemActive()) {
-            tick += conf_->ui.fast_skip_speed;
+        const bool fast_forward = ImGui::IsItemActive();
+        ImGui::SameLine();
+
+        float &speed = conf_->ui.playback_speed;
+        char speed_label[16];
+        snprintf(speed_label, sizeof(speed_label), "%gx", speed);
+        ImGui::PushItemWidth(ImGui::CalcTextSize("1000x").x + ImGui::GetFrameHeight() * 1.5f);
+        if (ImGui::BeginCombo("##speed", speed_label)) {
+            for (float preset : PLAYBACK_SPEEDS) {
+                snprintf(speed_label, sizeof(speed_label), "%gx", preset);
+                if (ImGui::Selectable(speed_label, preset == speed)) {
+                    speed = preset;
+                }
+            }
+            ImGui::EndCombo();
+        }
+        ImGui::PopItemWidth();
+        if (ImGui::IsItemHovered()) {
+            ImGui::SetTooltip("Playback speed, %.0f ticks per second",
+                              speed * BASE_TICKS_PER_SECOND);
         }
         ImGui::SameLine();
 
-        tick += autoplay_scene_;
+        // Frames due by clock, intermediate ones are skipped if rendering is slower
+        const int direction = fast_forward != fast_backward ? (fast_forward ? 1 : -1) : 0;
+        if (direction != 0) {
+            tick += direction * playback_ticks(speed * BASE_TICKS_PER_SECOND *
+                                               FAST_SKIP_MULTIPLIER);
+        } else if (autoplay_scene_) {
+            tick += playback_ticks(speed * BASE_TICKS_PER_SECOND);
+        } else {
+            reset_playback_clock();
+        }
 
         const auto frames_cnt = scene->get_frames_count();
         if (frames_cnt > 0) {
@@ -446,11 +836,14 @@ void UIController::playback_control_widget(Scene *scene) {
                 ImGui::SetKeyboardFocusHere();
             }
             const std::string slider_fmt = "%5d/" + std::to_string(frames_cnt);
+            slider_x_ = ImGui::GetCursorScreenPos().x;
+            slider_width_ = ImGui::GetContentRegionAvail().x;
             if (ImGui::SliderInt("##empty", &tick, 1, frames_cnt, slider_fmt.data(),
                                  ImGuiSliderFlags_AlwaysClamp)) {
                 autoplay_scene_ = false;
             }
             scene->set_frame_index(tick - 1);
+            playing_ = autoplay_scene_ && tick < frames_cnt;
             ImGui::PopItemWidth();
         } else {
             ImGui::Text("Frame list empty");
@@ -461,6 +854,135 @@ void UIController::playback_control_widget(Scene *scene) {
     }
 }
 
+void UIController::timeline_thumbnails_widget(Scene *scene) {
+    if (!scene->has_data() || slider_width_ <= 0.0f) {
+        return;
+    }
+    const auto &io = ImGui::GetIO();
+    const auto &style = ImGui::GetStyle();
+    // Right above playback control
+    const float height = ThumbnailStrip::height() + 2 * style.WindowPadding.y;
+    ImGui::SetNextWindowPos({0, io.DisplaySize.y - 20 - 2 * style.WindowPadding.y - height});
+    ImGui::SetNextWindowSize({io.DisplaySize.x, height});
+    ImGui::SetNextWindowBgAlpha(0.5f);
+    static const auto flags = ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_NoMove |
+                              ImGuiWindowFlags_NoSavedSettings |
+                              ImGuiWindowFlags_NoBringToFrontOnFocus;
+    if (ImGui::Begin("Timeline thumbnails", nullptr, flags)) {
+        const int clicked = thumbnails_->draw(scene, slider_x_, slider_width_);
+        if (clicked >= 0) {
+            autoplay_scene_ = false;
+            scene->set_frame_index(clicked);
+        }
+    }
+    ImGui::End();
+}
+
+void UIController::frame_stats_widget(Scene *scene, float bottom) {
+    const auto &stats = scene->frame_stats();
+    if (stats.size() == 0 || slider_width_ <= 0.0f) {
+        return;
+    }
+    const auto &io = ImGui::GetIO();
+    const auto &style = ImGui::GetStyle();
+    const float plot_height = 2.0f * ImGui::GetFrameHeight();
+    const float height = plot_height + 2 * style.WindowPadding.y;
+    ImGui::SetNextWindowPos({0, bottom - height});
+    ImGui::SetNextWindowSize({io.DisplaySize.x, height});
+    ImGui::SetNextWindowBgAlpha(0.5f);
+    static const auto flags = ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_NoMove |
+                              ImGuiWindowFlags_NoSavedSettings |
+                              ImGuiWindowFlags_NoBringToFrontOnFocus;
+    if (!ImGui::Begin("Frame statistics", nullptr, flags)) {
+        ImGui::End();
+        return;
+    }
+
+    auto &plot = *stats_plot_;
+    // Metric chooser fills space left of slider
+    const float combo_width = slider_x_ - ImGui::GetCursorScreenPos().x - style.ItemSpacing.x;
+    if (combo_width > 0.0f) {
+        ImGui::PushItemWidth(combo_width);
+        ImGui::Combo(
+            "##StatsMetric", &plot.metric,
+            [](void *, int idx, const char **out) {
+                *out = FrameStatsTimeline::metric_name(static_cast<size_t>(idx));
+                return true;
+            },
+            nullptr, static_cast<int>(FrameStatsTimeline::METRICS_COUNT));
+        ImGui::PopItemWidth();
+    }
+    const auto metric = static_cast<size_t>(plot.metric);
+    const float max_value =
+        stats.downsample(metric, static_cast<size_t>(slider_width_), plot.buckets);
+    if (combo_width > 0.0f) {
+        ImGui::Text("max %.6g", max_value);
+    }
+
+    ImGui::SetCursorScreenPos({slider_x_, ImGui::GetWindowPos().y + style.WindowPadding.y});
+    const ImVec2 origin = ImGui::GetCursorScreenPos();
+    ImGui::InvisibleButton("##StatsPlot", {slider_width_, plot_height});
+    auto *draw_list = ImGui::GetWindowDrawList();
+    draw_list->AddRectFilled(origin, {origin.x + slider_width_, origin.y + plot_height},
+                             ImGui::GetColorU32(ImGuiCol_FrameBg));
+
+    // Bars, so a single frame spike is as visible as a long plateau
+    const float bar_width = slider_width_ / static_cast<float>(plot.buckets.size());
+    const ImU32 bar_color = ImGui::GetColorU32(ImGuiCol_PlotHistogram);
+    const float scale = max_value > 0.0f ? plot_height / max_value : 0.0f;
+    for (size_t idx = 0; idx < plot.buckets.size(); ++idx) {
+        const float x = origin.x + static_cast<float>(idx) * bar_width;
+        const float top = origin.y + plot_height - plot.buckets[idx] * scale;
+        draw_list->AddRectFilled({x, top}, {x + std::max(bar_width, 1.0f), origin.y + plot_height},
+                                 bar_color);
+    }
+
+    // Current frame, placed as slider places it
+    const size_t frames_cnt = stats.size();
+    const auto frame_x = [&](size_t frame) {
+        return origin.x + (static_cast<float>(frame) + 0.5f) / frames_cnt * slider_width_;
+    };
+    const auto cur = static_cast<size_t>(std::max(scene->get_frame_index(), 0));
+    if (cur < frames_cnt) {
+        draw_list->AddLine({frame_x(cur), origin.y}, {frame_x(cur), origin.y + plot_height},
+                           ImGui::GetColorU32(ImGuiCol_PlotLinesHovered));
+    }
+
+    if (ImGui::IsItemHovered()) {
+        const float rel = (io.MousePos.x - origin.x) / slider_width_;
+        const auto frame = std::min(static_cast<size_t>(std::max(rel, 0.0f) * frames_cnt),
+                                    frames_cnt - 1);
+        ImGui::SetTooltip("Tick %zu\n%s: %.6g", frame + 1, FrameStatsTimeline::metric_name(metric),
+                          stats.value(metric, frame));
+        if (ImGui::IsItemClicked()) {
+            autoplay_scene_ = false;
+            scene->set_frame_index(static_cast<int>(frame));
+        }
+    }
+    ImGui::End();
+}
+
+int UIController::playback_ticks(double ticks_per_second) {
+    const auto now = std::chrono::steady_clock::now();
+    if (playback_time_ == std::chrono::steady_clock::time_point{}) {
+        // Playback just started, the first tick is shown right away
+        playback_time_ = now;
+        playback_carry_ = 0.0;
+        return 1;
+    }
+    const std::chrono::duration<double> elapsed = now - playback_time_;
+    playback_time_ = now;
+    playback_carry_ += std::min(elapsed.count(), MAX_PLAYBACK_STEP_SEC) * ticks_per_second;
+    const double ticks = std::floor(playback_carry_);
+    playback_carry_ -= ticks;
+    return static_cast<int>(ticks);
+}
+
+void UIController::reset_playback_clock() {
+    playback_time_ = {};
+    playback_carry_ = 0.0;
+}
+
 bool UIController::key_pressed_once(int key_desc) {
     const auto &io = ImGui::GetIO();
     if (io.KeysDown[key_desc]) {
@@ -10,9 +10,12 @@
 #include <net/NetListener.h>
 #include <viewer/Config.h>
 
+#include <chrono>
 #include <memory>
 
+class GpuTimer;
 class Scene;
+class ThumbnailStrip;
 
 /**
  * Class for all ui interaction using ImGui
@@ -32,24 +35,63 @@ class UIController {
 
     bool immediate_mode_enabled() const;
 
+    /// True if ui changes without input events: autoplay, held keys or buttons
+    bool wants_redraw() const;
+
  private:
     void main_menu_bar();
 
-    void fps_overlay_widget(NetListener::ConStatus net_status);
+    void fps_overlay_widget(Scene *scene, NetListener::ConStatus net_status);
     void info_widget(Scene *scene);
+    /// Lines of frame message, only visible ones are laid out
+    void message_log_widget(Scene *scene);
+    /// Text search over all frames, jumps to matching ones
+    void search_widget(Scene *scene);
     void playback_control_widget(Scene *scene);
+    void timeline_thumbnails_widget(Scene *scene);
+    /// Sparkline of chosen frame statistic, aligned with playback slider
+    void frame_stats_widget(Scene *scene, float bottom);
+    /// Rolling time of pipeline stages per frame with percentiles per call, GPU passes time
+    void profiler_widget(Scene *scene);
 
     bool key_pressed_once(int key_desc);
 
+    /// Ticks due since previous call at given rate, so playback doesn't depend on frame rate
+    int playback_ticks(double ticks_per_second);
+    /// Stop playback clock, next playback_ticks() call starts counting anew
+    void reset_playback_clock();
+
     /// Handling flags whenever window should be drawn or not etc.
     struct wnd_t;
     std::unique_ptr<wnd_t> wnd_;
 
+    /// Frame message filter and lines passing it
+    struct message_log_t;
+    std::unique_ptr<message_log_t> message_log_;
+    struct search_t;
+    std::unique_ptr<search_t> search_;
+    struct stats_plot_t;
+    std::unique_ptr<stats_plot_t> stats_plot_;
+    struct profiler_view_t;
+    std::unique_ptr<profiler_view_t> profiler_view_;
+
+    std::unique_ptr<ThumbnailStrip> thumbnails_;
+    /// Screen span of playback slider, previews are aligned with it
+    float slider_x_ = 0.0f;
+    float slider_width_ = 0.0f;
+
     Camera *camera_;
     Config *conf_;
+    /// Of scene passed to last next_frame(), ui pass is measured by it
+    GpuTimer *gpu_timer_ = nullptr;
 
     bool request_exit_ = false;
     bool autoplay_scene_ = true;
+    /// Autoplay enabled and last frame not reached yet
+    bool playing_ = false;
+    /// Playback clock state
+    std::chrono::steady_clock::time_point playback_time_{};
+    double playback_carry_ = 0.0;
     bool developer_mode_ = false;
     bool immediate_send_mode_ = false;
 